@@ -0,0 +1,506 @@
+    #pragma once
+
+    #include <algorithm>
+    #include <array>
+    #include <atomic>
+    #include <cerrno>
+    #include <chrono>
+    #include <condition_variable>
+    #include <cstddef>
+    #include <cstdint>
+    #include <cstring>
+    #include <filesystem>
+    #include <functional>
+    #include <map>
+    #include <memory>
+    #include <mutex>
+    #include <optional>
+    #include <span>
+    #include <string>
+    #include <string_view>
+    #include <thread>
+    #include <unordered_map>
+    #include <utility>
+    #include <vector>
+
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+
+    #include "CacheHash.h"
+    #include "CachePersistence.h"
+
+    // Where and how the DiskTier policy spills evicted entries
+    struct DiskTierOptions {
+        std::string directory;                        // empty = the system temporary directory
+        std::size_t max_bytes = 0;                    // 0 = unbounded; past it the oldest segment is dropped
+        std::size_t segment_bytes = 64 << 20;         // the log moves on to a new file at this size
+        std::size_t write_batch_bytes = 1 << 20;      // appends are buffered and written this many at a time;
+                                                      // past 16 batches behind, evictions are not spilled
+        double compact_below = 0.5;                   // a full segment with a smaller live share is rewritten
+    };
+
+    namespace cache_detail {
+        // What a DiskStore tells its owner about records it lets go of on its own. Called from the
+        // store's thread with no store lock held.
+        struct DiskStoreEvents {
+            std::function<void(std::span<const std::size_t>)> dropped = {};   // hashes of records dropped past max_bytes
+            std::function<void()> failed = {};                                  // turned off, every record forgotten
+        };
+
+        // Log-structured spill store for one cache. Records are appended to the active segment's
+        // buffer and located through an in-memory index; one background thread writes the
+        // buffer out in batches, moves on to a new segment when the active one is full, and
+        // rewrites full segments whose records have mostly been replaced or erased (or drops
+        // the oldest, past max_bytes). Reads copy from the buffer or pread the segment file.
+        //
+        // The index is striped by hash; a stripe lock is taken before the log lock. Segment files
+        // are unlinked as soon as they are created: without the index they mean nothing, so
+        // they go away with the process, even after a crash. A write error turns the store off.
+        template<typename Key>
+        class DiskStore {
+            struct Segment;
+
+        public:
+            // Where a record is: its segment, offset and length
+            struct Location {
+                std::uint64_t offset = 0;
+                std::uint32_t segment = 0;
+                std::uint32_t size = 0;
+
+                friend bool operator==(const Location&, const Location&) = default;
+            };
+
+            struct Record {
+                std::string payload;
+                Location at;   // for take()
+            };
+
+            // What put did: whether it stored the record, and whether an older record for the key
+            // went away, replaced or dropped along with the new one
+            struct Put {
+                bool stored = false;
+                bool superseded = false;
+            };
+
+            explicit DiskStore(const DiskTierOptions& options, DiskStoreEvents events = {})
+                : directory_(options.directory.empty() ? std::filesystem::temp_directory_path().string() : options.directory),
+                  max_bytes_(options.max_bytes),
+                  segment_bytes_(std::max<std::size_t>(options.max_bytes != 0 ? std::min(options.segment_bytes, options.max_bytes / 2)
+                                                                             : options.segment_bytes, 4096)),
+                  batch_bytes_(std::max<std::size_t>(options.write_batch_bytes, 1)),
+                  compact_below_(std::min(options.compact_below, 1.0)),
+                  events_(std::move(events)) {
+                active_ = open_segment();
+                worker_ = std::thread{[this] { run(); }};
+            }
+            DiskStore(const DiskStore&) = delete;
+            DiskStore& operator=(const DiskStore&) = delete;
+
+            ~DiskStore() {
+                {
+                    std::lock_guard lock{log_mutex_};
+                    stopping_ = true;
+                }
+                wake_.notify_one();
+                worker_.join();
+            }
+
+            // Appends payload as key's record, replacing any older one. Drops the record, and any
+            // older one, when the writer has fallen too far behind or the store is off.
+            auto put(const Key& key, std::size_t hash, std::string_view payload) -> Put {
+                thread_local std::string record;
+                record.assign(sizeof(RecordHeader), '\0');
+                CacheCodec<Key>::write(record, key);
+                const RecordHeader header{static_cast<std::uint32_t>(record.size() - sizeof(RecordHeader)),
+                                          static_cast<std::uint32_t>(payload.size())};
+                std::memcpy(record.data(), &header, sizeof(header));
+                record.append(payload);
+
+                auto& stripe = stripe_for(hash);
+                std::lock_guard lock{stripe.mutex};
+                auto [it, inserted] = stripe.index.try_emplace(key);
+                std::lock_guard log{log_mutex_};
+                if (!inserted) retire(it->second);
+                if (failed_.load(std::memory_order_relaxed) || active_->pending.size() >= backlog_batches * batch_bytes_) {
+                    if (!inserted) entries_.fetch_sub(1, std::memory_order_relaxed);
+                    stripe.index.erase(it);
+                    return {false, !inserted};
+                }
+                if (inserted) entries_.fetch_add(1, std::memory_order_relaxed);
+                it->second = append(record);
+                return {true, !inserted};
+            }
+
+            // A copy of key's payload, read without holding any lock
+            template<typename Q>
+            auto find(const Q& key, std::size_t hash) const -> std::optional<Record> {
+                if (entries_.load(std::memory_order_relaxed) == 0 || failed_.load(std::memory_order_relaxed)) return std::nullopt;
+                Record found;
+                std::shared_ptr<Segment> segment;
+                {
+                    auto& stripe = stripe_for(hash);
+                    std::lock_guard lock{stripe.mutex};
+                    const auto it = stripe.index.find(key);
+                    if (it == stripe.index.end()) return std::nullopt;
+                    found.at = it->second;
+                    std::lock_guard log{log_mutex_};
+                    segment = segments_.at(found.at.segment);
+                    if (found.at.offset >= segment->flushed) {
+                        // Still buffered: in the batch being written, or appended since
+                        auto offset = found.at.offset - segment->flushed;
+                        const auto& buffer = offset < segment->writing.size() ? segment->writing : segment->pending;
+                        if (&buffer == &segment->pending) offset -= segment->writing.size();
+                        found.payload.assign(buffer, offset, found.at.size);
+                    }
+                }
+                if (found.payload.empty()) {
+                    found.payload.resize(found.at.size);
+                    if (!read_at(segment->fd, found.payload.data(), found.at.size, found.at.offset)) return std::nullopt;
+                }
+                RecordHeader header;
+                std::memcpy(&header, found.payload.data(), sizeof(header));
+                found.payload.erase(0, sizeof(header) + header.key_size);
+                return found;
+            }
+
+            // Removes key's record if it is still the one find() returned at
+            bool take(const Key& key, std::size_t hash, const Location& at) {
+                auto& stripe = stripe_for(hash);
+                std::lock_guard lock{stripe.mutex};
+                const auto it = stripe.index.find(key);
+                if (it == stripe.index.end() || it->second != at) return false;
+                unindex(stripe, it);
+                return true;
+            }
+
+            template<typename Q>
+            bool erase(const Q& key, std::size_t hash) {
+                if (entries_.load(std::memory_order_relaxed) == 0) return false;
+                auto& stripe = stripe_for(hash);
+                std::lock_guard lock{stripe.mutex};
+                const auto it = stripe.index.find(key);
+                if (it == stripe.index.end()) return false;
+                unindex(stripe, it);
+                return true;
+            }
+
+            // The dead records are reclaimed by compaction
+            void clear() {
+                for (auto& stripe : stripes_) {
+                    std::lock_guard lock{stripe.mutex};
+                    std::lock_guard log{log_mutex_};
+                    for (const auto& [key, at] : stripe.index) retire(at);
+                    entries_.fetch_sub(stripe.index.size(), std::memory_order_relaxed);
+                    stripe.index.clear();
+                }
+            }
+
+            auto entries() const noexcept -> std::size_t { return entries_.load(std::memory_order_relaxed); }
+
+            // Live and dead records, written or still buffered
+            auto bytes() const -> std::size_t {
+                std::lock_guard log{log_mutex_};
+                return total_bytes();
+            }
+
+        private:
+            static constexpr std::size_t stripe_count = 16;
+            static constexpr std::size_t backlog_batches = 16;
+            static constexpr auto flush_interval = std::chrono::milliseconds(50);
+
+            struct RecordHeader {
+                std::uint32_t key_size;
+                std::uint32_t payload_size;
+            };
+
+            // One log file: flushed bytes on disk, then the batch being written, then the appends
+            // since. Only the active segment is appended to.
+            struct Segment {
+                Segment(std::uint32_t id, int fd) noexcept : id(id), fd(fd) {}
+                Segment(const Segment&) = delete;
+                Segment& operator=(const Segment&) = delete;
+                ~Segment() { ::close(fd); }
+
+                auto size() const noexcept -> std::uint64_t { return flushed + writing.size() + pending.size(); }
+
+                const std::uint32_t id;
+                const int fd;
+                std::uint64_t flushed = 0;
+                std::string writing;
+                std::string pending;
+                std::uint64_t live = 0;   // bytes of records the index still points at
+            };
+
+            struct alignas(64) Stripe {
+                std::mutex mutex;
+                std::unordered_map<Key, Location, CacheHash<Key>, std::equal_to<>> index;
+            };
+
+            auto stripe_for(std::size_t hash) const noexcept -> Stripe& {
+                return const_cast<Stripe&>(stripes_[(hash * 0x9e3779b97f4a7c15ULL) >> 60]);
+            }
+
+            // Log lock held
+            auto append(std::string_view record) -> Location {
+                const Location at{active_->size(), active_->id, static_cast<std::uint32_t>(record.size())};
+                active_->pending.append(record);
+                active_->live += record.size();
+                if (active_->pending.size() >= batch_bytes_) wake_.notify_one();
+                return at;
+            }
+
+            // Log lock held: the record at is no longer indexed
+            void retire(const Location& at) { segments_.at(at.segment)->live -= at.size; }
+
+            // Stripe lock held
+            void unindex(Stripe& stripe, typename decltype(Stripe::index)::iterator it) {
+                {
+                    std::lock_guard log{log_mutex_};
+                    retire(it->second);
+                }
+                stripe.index.erase(it);
+                entries_.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            auto total_bytes() const -> std::uint64_t {
+                std::uint64_t total = 0;
+                for (const auto& [id, segment] : segments_) total += segment->size();
+                return total;
+            }
+
+            // Log lock held, or in the constructor
+            auto open_segment() -> std::shared_ptr<Segment> {
+                auto path = (std::filesystem::path(directory_) / "tsc-disk-tier-XXXXXX").string();
+                const int fd = ::mkostemp(path.data(), O_CLOEXEC);
+                if (fd < 0) throw_errno("create a segment in " + directory_);
+                ::unlink(path.c_str());
+                const auto id = next_id_++;
+                auto segment = std::make_shared<Segment>(id, fd);
+                segments_.emplace(id, segment);
+                return segment;
+            }
+
+            static bool write_at(int fd, std::string_view bytes, std::uint64_t offset) noexcept {
+                while (!bytes.empty()) {
+                    const auto written = ::pwrite(fd, bytes.data(), bytes.size(), static_cast<off_t>(offset));
+                    if (written < 0 && errno == EINTR) continue;
+                    if (written <= 0) return false;
+                    bytes.remove_prefix(static_cast<std::size_t>(written));
+                    offset += static_cast<std::uint64_t>(written);
+                }
+                return true;
+            }
+
+            static bool read_at(int fd, char* bytes, std::size_t size, std::uint64_t offset) noexcept {
+                while (size != 0) {
+                    const auto read = ::pread(fd, bytes, size, static_cast<off_t>(offset));
+                    if (read < 0 && errno == EINTR) continue;
+                    if (read <= 0) return false;
+                    bytes += read;
+                    size -= static_cast<std::size_t>(read);
+                    offset += static_cast<std::uint64_t>(read);
+                }
+                return true;
+            }
+
+            void run() {
+                std::unique_lock lock{log_mutex_};
+                while (!stopping_) {
+                    wake_.wait_for(lock, flush_interval, [this] { return stopping_ || active_->pending.size() >= batch_bytes_; });
+                    if (stopping_ || failed_.load(std::memory_order_relaxed)) continue;
+                    lock.unlock();
+                    if (flush()) compact();
+                    lock.lock();
+                }
+            }
+
+            // Writes the active segment's buffer with one pwrite, moving on to a new segment once
+            // it is full. Returns false if the store had to be turned off.
+            bool flush() {
+                std::shared_ptr<Segment> target;
+                try {
+                    std::lock_guard lock{log_mutex_};
+                    if (active_->pending.empty()) return true;
+                    target = active_;
+                    target->writing.swap(target->pending);
+                    if (target->size() >= segment_bytes_) active_ = open_segment();
+                } catch (...) {
+                    return fail();
+                }
+                // Only this thread changes writing and flushed; readers copy writing under the lock
+                if (!write_at(target->fd, target->writing, target->flushed)) return fail();
+                std::lock_guard lock{log_mutex_};
+                target->flushed += target->writing.size();
+                target->writing.clear();
+                if (target != active_) target->writing.shrink_to_fit();
+                return true;
+            }
+
+            bool fail() {
+                failed_.store(true, std::memory_order_relaxed);
+                clear();
+                if (events_.failed) events_.failed();
+                return false;
+            }
+
+            // Rewrites or drops full segments, oldest first, until none qualifies
+            void compact() {
+                for (;;) {
+                    std::shared_ptr<Segment> victim;
+                    bool drop = false;
+                    {
+                        std::lock_guard lock{log_mutex_};
+                        if (stopping_) return;
+                        const auto total = total_bytes();
+                        for (const auto& [id, segment] : segments_) {
+                            if (segment == active_) continue;
+                            drop = max_bytes_ != 0 && total > max_bytes_;
+                            if (drop || static_cast<double>(segment->live) < compact_below_ * static_cast<double>(segment->size())) {
+                                victim = segment;
+                                break;
+                            }
+                        }
+                    }
+                    if (!victim || !rewrite(*victim, drop)) return;
+                }
+            }
+
+            // Walks a full segment through a read-only mapping: records the index still points at
+            // are appended again (or, when dropping, unindexed and reported), then the segment goes away
+            bool rewrite(Segment& segment, bool drop) {
+                if (segment.flushed != 0) {
+                    std::vector<std::size_t> dropped;
+                    void* mapped = ::mmap(nullptr, segment.flushed, PROT_READ, MAP_SHARED, segment.fd, 0);
+                    if (mapped == MAP_FAILED) return fail();
+                    ::madvise(mapped, segment.flushed, MADV_SEQUENTIAL);
+                    std::string_view in(static_cast<const char*>(mapped), segment.flushed);
+                    bool ok = true;
+                    for (std::uint64_t offset = 0; ok && in.size() >= sizeof(RecordHeader);) {
+                        RecordHeader header;
+                        std::memcpy(&header, in.data(), sizeof(header));
+                        const auto size = sizeof(header) + header.key_size + header.payload_size;
+                        auto key_bytes = in.substr(sizeof(header), header.key_size);
+                        const Key key = CacheCodec<Key>::read(key_bytes);
+                        const Location at{offset, segment.id, static_cast<std::uint32_t>(size)};
+                        if (!relocate(key, at, drop ? std::string_view{} : in.substr(0, size)) && drop) {
+                            dropped.push_back(CacheHash<Key>{}(key));
+                        }
+                        in.remove_prefix(size);
+                        offset += size;
+                        if (pending_bytes() >= batch_bytes_) ok = flush();
+                    }
+                    ::munmap(mapped, segment.flushed);
+                    if (!dropped.empty() && events_.dropped) events_.dropped(dropped);
+                    if (!ok) return false;
+                }
+                std::lock_guard lock{log_mutex_};
+                segments_.erase(segment.id);
+                return true;
+            }
+
+            // Returns false if the record is no longer indexed: replaced or erased since, or dropped here
+            bool relocate(const Key& key, const Location& at, std::string_view record) {
+                auto& stripe = stripe_for(CacheHash<Key>{}(key));
+                std::lock_guard lock{stripe.mutex};
+                const auto it = stripe.index.find(key);
+                if (it == stripe.index.end() || it->second != at) return true;
+                if (record.empty()) {
+                    unindex(stripe, it);
+                    return false;
+                }
+                std::lock_guard log{log_mutex_};
+                retire(at);
+                it->second = append(record);
+                return true;
+            }
+
+            auto pending_bytes() const -> std::size_t {
+                std::lock_guard lock{log_mutex_};
+                return active_->pending.size();
+            }
+
+            const std::string directory_;
+            const std::size_t max_bytes_;
+            const std::size_t segment_bytes_;
+            const std::size_t batch_bytes_;
+            const double compact_below_;
+            const DiskStoreEvents events_;
+            std::array<Stripe, stripe_count> stripes_;
+            std::atomic<std::size_t> entries_{0};
+            std::atomic<bool> failed_{false};
+            mutable std::mutex log_mutex_;
+            std::condition_variable wake_;
+            std::map<std::uint32_t, std::shared_ptr<Segment>> segments_;   // by id, so oldest first
+            std::shared_ptr<Segment> active_;
+            std::uint32_t next_id_ = 0;
+            bool stopping_ = false;
+            std::thread worker_;   // last: started once everything else is set up
+        };
+
+        // The keys a shard may have spilled, so that put and loader-less misses of keys it never
+        // spilled skip the DiskStore: a Bloom filter over their hashes, with two bits in one word
+        // per key. It cannot forget one key, so it is emptied once every record it counted is
+        // gone, including those the store drops itself; a shard whose spilled keys never all
+        // leave fills its filter until it passes every key, as if there were none.
+        class SpillFilter {
+        public:
+            // Exclusive shard lock held, before the entry leaves the map (which orders the bits
+            // before a lock-free reader's miss)
+            void add(std::size_t hash) noexcept {
+                words_[word(hash)].fetch_or(bits(hash), std::memory_order_release);
+                ++held_;
+            }
+
+            // Exclusive shard lock held: a record add() counted was taken, erased, replaced or dropped
+            void removed() noexcept {
+                if (held_ != 0 && --held_ == 0) reset();
+            }
+
+            // Exclusive shard lock held, with the store cleared or about to be
+            void reset() noexcept {
+                for (auto& word : words_) word.store(0, std::memory_order_relaxed);
+                held_ = 0;
+            }
+
+            // False only if the key was never spilled since the last reset
+            bool may_hold(std::size_t hash) const noexcept {
+                const auto wanted = bits(hash);
+                return (words_[word(hash)].load(std::memory_order_acquire) & wanted) == wanted;
+            }
+
+        private:
+            static constexpr std::size_t word_count = 256;   // 2 KiB per shard
+
+            // Fibonacci hashing: the top bits are well mixed even for identity hashes, and
+            // unrelated to the low bits of mix_hash that pick the shard
+            static auto spread(std::size_t hash) noexcept -> std::uint64_t { return hash * 0x9e3779b97f4a7c15ull; }
+            static auto word(std::size_t hash) noexcept -> std::size_t { return spread(hash) >> 56; }
+            static auto bits(std::size_t hash) noexcept -> std::uint64_t {
+                const auto spread_hash = spread(hash);
+                return (std::uint64_t{1} << ((spread_hash >> 50) & 63)) | (std::uint64_t{1} << ((spread_hash >> 44) & 63));
+            }
+
+            std::array<std::atomic<std::uint64_t>, word_count> words_{};
+            std::size_t held_ = 0;   // records counted by add() the store may still hold
+        };
+
+        struct NoDiskStore {};
+    }
+
+    // Second-tier policies for ThreadSafeCache, tag types like the other policies. With
+    // DiskTier, entries evicted from memory are spilled to a DiskStore (configured through
+    // CacheOptions::disk), and a miss checks it before calling the loader.
+    struct NoDiskTier {
+        static constexpr bool enabled = false;
+
+        template<typename Key>
+        using Store = cache_detail::NoDiskStore;
+    };
+
+    struct DiskTier {
+        static constexpr bool enabled = true;
+
+        template<typename Key>
+        using Store = cache_detail::DiskStore<Key>;
+    };
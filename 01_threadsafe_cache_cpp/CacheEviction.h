@@ -0,0 +1,394 @@
+    #pragma once
+
+    #include <algorithm>
+    #include <array>
+    #include <atomic>
+    #include <cstddef>
+    #include <cstdint>
+    #include <functional>
+    #include <optional>
+    #include <thread>
+    #include <unordered_map>
+    #include <vector>
+
+    #include "CacheHash.h"
+
+    // Eviction policies for ThreadSafeCache. Each policy is a tag type whose nested State<Key>
+    // lives inside one shard and is only touched under that shard's exclusive lock; entries
+    // refer to it through a stable integer handle, so the map storage is free to move entries.
+    namespace cache_detail {
+        struct Empty {};
+
+        // Finalizer from MurmurHash3, so identity hashes (std::hash<int>) still spread across shards
+        constexpr std::uint64_t mix_hash(std::uint64_t h) noexcept {
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdULL;
+            h ^= h >> 33;
+            h *= 0xc4ceb9fe1a85ec53ULL;
+            h ^= h >> 33;
+            return h;
+        }
+
+        inline constexpr std::uint32_t no_slot = 0xffffffffu;
+
+        // Index-based intrusive lists over a recycled slot pool; a slot keeps a copy of its key
+        // so a chosen victim can be located in the shard map.
+        template<typename Key>
+        class SlotLists {
+        public:
+            struct List {
+                std::uint32_t head = no_slot;
+                std::uint32_t tail = no_slot;
+                std::size_t size = 0;
+            };
+
+            struct Slot {
+                std::optional<Key> key;
+                std::uint32_t prev = no_slot;
+                std::uint32_t next = no_slot;
+                std::uint8_t bits = 0;   // policy-defined: reference bit, frequency, ...
+                std::uint8_t list = 0;   // policy-defined: which queue the slot is linked into
+            };
+
+            auto allocate(const Key& key) -> std::uint32_t {
+                std::uint32_t index;
+                if (!free_.empty()) {
+                    index = free_.back();
+                    free_.pop_back();
+                } else {
+                    index = static_cast<std::uint32_t>(slots_.size());
+                    slots_.emplace_back();
+                }
+                slots_[index] = Slot{};
+                slots_[index].key.emplace(key);
+                return index;
+            }
+
+            void release(std::uint32_t index) {
+                slots_[index].key.reset();
+                free_.push_back(index);
+            }
+
+            // Read-buffer handles may be stale; only live slots are worth promoting
+            bool live(std::uint32_t index) const noexcept {
+                return index < slots_.size() && slots_[index].key.has_value();
+            }
+
+            auto operator[](std::uint32_t index) -> Slot& { return slots_[index]; }
+            auto operator[](std::uint32_t index) const -> const Slot& { return slots_[index]; }
+
+            void push_front(List& list, std::uint32_t index) {
+                auto& slot = slots_[index];
+                slot.prev = no_slot;
+                slot.next = list.head;
+                if (list.head != no_slot) slots_[list.head].prev = index;
+                list.head = index;
+                if (list.tail == no_slot) list.tail = index;
+                ++list.size;
+            }
+
+            void unlink(List& list, std::uint32_t index) {
+                auto& slot = slots_[index];
+                if (slot.prev != no_slot) slots_[slot.prev].next = slot.next; else list.head = slot.next;
+                if (slot.next != no_slot) slots_[slot.next].prev = slot.prev; else list.tail = slot.prev;
+                slot.prev = slot.next = no_slot;
+                --list.size;
+            }
+
+            void clear() {
+                slots_.clear();
+                free_.clear();
+            }
+
+        private:
+            std::vector<Slot> slots_;
+            std::vector<std::uint32_t> free_;
+        };
+
+        // Lossy buffer of read hits. Readers record a handle with a plain relaxed store (no
+        // read-modify-write, no lock upgrade); the shard replays it under its exclusive lock.
+        class ReadBuffer {
+        public:
+            static constexpr std::size_t capacity = 128;
+            static constexpr std::uint32_t drain_interval = 64;
+
+            // Returns true every drain_interval records from this thread, as a hint to try draining
+            bool record(std::uint32_t handle) noexcept {
+                auto& ticket = thread_ticket();
+                slots_[ticket & (capacity - 1)].store(handle + 1, std::memory_order_relaxed);
+                return (++ticket % drain_interval) == 0;
+            }
+
+            template<typename Fn>
+            void drain(Fn&& apply) {
+                for (auto& slot : slots_) {
+                    if (auto recorded = slot.exchange(0, std::memory_order_relaxed); recorded != 0) {
+                        apply(recorded - 1);
+                    }
+                }
+            }
+
+        private:
+            // Threads start at different offsets so concurrent readers rarely overwrite each other
+            static std::uint32_t& thread_ticket() noexcept {
+                thread_local std::uint32_t ticket =
+                    static_cast<std::uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+                return ticket;
+            }
+
+            std::array<std::atomic<std::uint32_t>, capacity> slots_{};
+        };
+    }
+
+    // Unbounded: no per-entry bookkeeping and nothing recorded on reads
+    struct NoEviction {
+        static constexpr bool bounded = false;
+
+        template<typename Key>
+        struct State {
+            using Handle = cache_detail::Empty;
+        };
+    };
+
+    // Least recently used; read hits reach the list through the shard read buffer
+    struct LruEviction {
+        static constexpr bool bounded = true;
+
+        template<typename Key>
+        class State {
+        public:
+            using Handle = std::uint32_t;
+
+            auto on_insert(const Key& key) -> Handle {
+                const auto index = slots_.allocate(key);
+                slots_.push_front(order_, index);
+                return index;
+            }
+
+            void on_access(Handle index) {
+                if (!slots_.live(index) || order_.head == index) return;
+                slots_.unlink(order_, index);
+                slots_.push_front(order_, index);
+            }
+
+            void on_remove(Handle index) {
+                slots_.unlink(order_, index);
+                slots_.release(index);
+            }
+
+            void on_evict(Handle index) { on_remove(index); }
+
+            // Picks the next entry to evict; the caller erases it and then calls on_evict
+            auto victim() -> Handle { return order_.tail; }
+
+            // What victim() would pick, without moving anything
+            auto peek_victim() const -> Handle { return order_.tail; }
+
+            auto key_of(Handle index) const -> const Key& { return *slots_[index].key; }
+
+            void clear() {
+                slots_.clear();
+                order_ = {};
+            }
+
+            void set_capacity(std::size_t) noexcept {}
+
+        private:
+            cache_detail::SlotLists<Key> slots_;
+            typename cache_detail::SlotLists<Key>::List order_;
+        };
+    };
+
+    // CLOCK (second chance): hits set a reference bit, the hand clears it once before evicting
+    struct ClockEviction {
+        static constexpr bool bounded = true;
+
+        template<typename Key>
+        class State {
+        public:
+            using Handle = std::uint32_t;
+
+            auto on_insert(const Key& key) -> Handle {
+                const auto index = slots_.allocate(key);
+                slots_.push_front(ring_, index);
+                return index;
+            }
+
+            void on_access(Handle index) {
+                if (slots_.live(index)) slots_[index].bits = 1;
+            }
+
+            void on_remove(Handle index) {
+                slots_.unlink(ring_, index);
+                slots_.release(index);
+            }
+
+            void on_evict(Handle index) { on_remove(index); }
+
+            // The tail is where the hand points; referenced entries go round once more
+            auto victim() -> Handle {
+                while (slots_[ring_.tail].bits != 0) {
+                    const auto index = ring_.tail;
+                    slots_[index].bits = 0;
+                    slots_.unlink(ring_, index);
+                    slots_.push_front(ring_, index);
+                }
+                return ring_.tail;
+            }
+
+            // The first unreferenced entry from the hand on; if every bit is set, one full turn
+            // clears them and comes back to the tail
+            auto peek_victim() const -> Handle {
+                for (auto index = ring_.tail; index != cache_detail::no_slot; index = slots_[index].prev) {
+                    if (slots_[index].bits == 0) return index;
+                }
+                return ring_.tail;
+            }
+
+            auto key_of(Handle index) const -> const Key& { return *slots_[index].key; }
+
+            void clear() {
+                slots_.clear();
+                ring_ = {};
+            }
+
+            void set_capacity(std::size_t) noexcept {}
+
+        private:
+            cache_detail::SlotLists<Key> slots_;
+            typename cache_detail::SlotLists<Key>::List ring_;
+        };
+    };
+
+    // S3-FIFO (Yang et al., SOSP'23): a small probationary FIFO filters one-hit wonders, a main
+    // FIFO with lazy promotion holds the rest, and a ghost FIFO of evicted key hashes lets
+    // quickly returning keys skip probation.
+    struct S3FifoEviction {
+        static constexpr bool bounded = true;
+
+        template<typename Key>
+        class State {
+        public:
+            using Handle = std::uint32_t;
+
+            auto on_insert(const Key& key) -> Handle {
+                const auto index = slots_.allocate(key);
+                const bool returning = ghost_.contains(CacheHash<Key>{}(key));
+                slots_[index].list = returning ? main_queue : small_queue;
+                slots_.push_front(returning ? main_ : small_, index);
+                return index;
+            }
+
+            void on_access(Handle index) {
+                if (!slots_.live(index)) return;
+                auto& freq = slots_[index].bits;
+                if (freq < max_freq) ++freq;
+            }
+
+            void on_remove(Handle index) {
+                slots_.unlink(slots_[index].list == small_queue ? small_ : main_, index);
+                slots_.release(index);
+            }
+
+            // A key evicted from probation is remembered, so it skips probation if it soon
+            // returns. Done here rather than in victim(), which make_room may pick and then spare;
+            // erased and expired keys are not remembered and come back on probation.
+            void on_evict(Handle index) {
+                if (slots_[index].list == small_queue) ghost_remember(CacheHash<Key>{}(*slots_[index].key));
+                on_remove(index);
+            }
+
+            auto victim() -> Handle {
+                for (;;) {
+                    if (small_.size > 0 && (small_.size >= small_target_ || main_.size == 0)) {
+                        const auto index = small_.tail;
+                        if (slots_[index].bits > 1) {
+                            // Accessed while on probation: promote instead of evicting
+                            slots_.unlink(small_, index);
+                            slots_[index].bits = 0;
+                            slots_[index].list = main_queue;
+                            slots_.push_front(main_, index);
+                            continue;
+                        }
+                        return index;
+                    }
+                    const auto index = main_.tail;
+                    if (slots_[index].bits > 0) {
+                        --slots_[index].bits;
+                        slots_.unlink(main_, index);
+                        slots_.push_front(main_, index);
+                        continue;
+                    }
+                    return index;
+                }
+            }
+
+            // Replays victim() without promoting or decrementing: the probationary tails it would
+            // promote, then the first main entry with no frequency left. Failing that, the entries
+            // promoted on the way (which arrive with none), else the least frequent main entry,
+            // which is where repeated passes over main stop.
+            auto peek_victim() const -> Handle {
+                auto small_size = small_.size;
+                std::size_t promoted = 0;
+                auto first_promoted = cache_detail::no_slot;
+                for (auto index = small_.tail; small_size > 0 && (small_size >= small_target_ || main_.size + promoted == 0);
+                     index = slots_[index].prev) {
+                    if (slots_[index].bits <= 1) return index;
+                    if (promoted++ == 0) first_promoted = index;
+                    --small_size;
+                }
+                auto least = main_.tail;
+                for (auto index = main_.tail; index != cache_detail::no_slot; index = slots_[index].prev) {
+                    if (slots_[index].bits == 0) return index;
+                    if (slots_[index].bits < slots_[least].bits) least = index;
+                }
+                return first_promoted != cache_detail::no_slot ? first_promoted : least;
+            }
+
+            auto key_of(Handle index) const -> const Key& { return *slots_[index].key; }
+
+            void clear() {
+                slots_.clear();
+                small_ = {};
+                main_ = {};
+                ghost_ring_.clear();
+                ghost_.clear();
+                ghost_next_ = 0;
+            }
+
+            // Small queue gets 10% of the shard, the ghost remembers as many keys as main holds
+            void set_capacity(std::size_t capacity) {
+                small_target_ = std::max<std::size_t>(1, capacity / 10);
+                ghost_capacity_ = std::max<std::size_t>(1, capacity - small_target_);
+            }
+
+        private:
+            static constexpr std::uint8_t small_queue = 0;
+            static constexpr std::uint8_t main_queue = 1;
+            static constexpr std::uint8_t max_freq = 3;
+
+            void ghost_remember(std::size_t hash) {
+                if (ghost_ring_.size() < ghost_capacity_) {
+                    ghost_ring_.push_back(hash);
+                } else {
+                    ghost_forget_one(ghost_ring_[ghost_next_]);
+                    ghost_ring_[ghost_next_] = hash;
+                    ghost_next_ = (ghost_next_ + 1) % ghost_capacity_;
+                }
+                ++ghost_[hash];
+            }
+
+            void ghost_forget_one(std::size_t hash) {
+                if (auto it = ghost_.find(hash); it != ghost_.end() && --it->second == 0) ghost_.erase(it);
+            }
+
+            cache_detail::SlotLists<Key> slots_;
+            typename cache_detail::SlotLists<Key>::List small_;
+            typename cache_detail::SlotLists<Key>::List main_;
+            std::size_t small_target_ = 1;
+            std::size_t ghost_capacity_ = 1;
+            std::vector<std::size_t> ghost_ring_;
+            std::size_t ghost_next_ = 0;
+            std::unordered_map<std::size_t, std::uint32_t> ghost_;
+        };
+    };
@@ -0,0 +1,82 @@
+    #pragma once
+
+    #include <condition_variable>
+    #include <coroutine>
+    #include <deque>
+    #include <functional>
+    #include <memory>
+    #include <mutex>
+    #include <thread>
+    #include <utility>
+
+    namespace cache_detail {
+        // One background thread, started on first use, running submitted tasks in order. The
+        // destructor finishes everything already queued before joining, so a task may rely on
+        // its owner outliving it as long as the executor is the owner's last member.
+        class BackgroundExecutor {
+        public:
+            BackgroundExecutor() = default;
+            BackgroundExecutor(const BackgroundExecutor&) = delete;
+            BackgroundExecutor& operator=(const BackgroundExecutor&) = delete;
+
+            ~BackgroundExecutor() {
+                {
+                    std::lock_guard lock{mutex_};
+                    stopping_ = true;
+                }
+                ready_.notify_one();
+                if (worker_.joinable()) worker_.join();
+            }
+
+            void submit(std::function<void()> task) {
+                {
+                    std::lock_guard lock{mutex_};
+                    tasks_.push_back(std::move(task));
+                    if (!worker_.joinable()) worker_ = std::thread{[this] { run(); }};
+                }
+                ready_.notify_one();
+            }
+
+        private:
+            void run() {
+                std::unique_lock lock{mutex_};
+                for (;;) {
+                    ready_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+                    if (tasks_.empty()) return;   // stopping and drained
+                    auto task = std::move(tasks_.front());
+                    tasks_.pop_front();
+                    lock.unlock();
+                    task();
+                    lock.lock();
+                }
+            }
+
+            std::mutex mutex_;
+            std::condition_variable ready_;
+            std::deque<std::function<void()>> tasks_;
+            bool stopping_ = false;
+            std::thread worker_;
+        };
+
+        // Where coroutines parked on a finished load resume: through the caller's scheduler if
+        // one was given, else on a BackgroundExecutor started the first time one is. Never on
+        // the finishing thread, so a waiter that blocks holds up neither the load's leader nor
+        // the leader's caller.
+        class WaiterScheduler {
+        public:
+            using Schedule = std::function<void(std::coroutine_handle<>)>;
+
+            explicit WaiterScheduler(Schedule schedule) : schedule_(std::move(schedule)) {}
+
+            void resume(std::coroutine_handle<> waiter) {
+                if (schedule_) return schedule_(waiter);
+                std::call_once(started_, [this] { executor_ = std::make_unique<BackgroundExecutor>(); });
+                executor_->submit([waiter] { waiter.resume(); });
+            }
+
+        private:
+            Schedule schedule_;
+            std::once_flag started_;
+            std::unique_ptr<BackgroundExecutor> executor_;
+        };
+    }
@@ -0,0 +1,238 @@
+    #pragma once
+
+    #include <algorithm>
+    #include <array>
+    #include <atomic>
+    #include <chrono>
+    #include <cstddef>
+    #include <cstdint>
+    #include <optional>
+    #include <utility>
+    #include <vector>
+
+    #include "CacheEviction.h"
+
+    // Per-entry expiry. An entry expires a fixed time after it was written, or after it was
+    // last read; Expiry{} never expires.
+    struct Expiry {
+        enum class Kind : std::uint8_t { never, after_write, after_access };
+
+        Kind kind = Kind::never;
+        std::chrono::nanoseconds ttl{0};
+
+        static constexpr auto after_write(std::chrono::nanoseconds ttl) noexcept -> Expiry { return {Kind::after_write, ttl}; }
+        static constexpr auto after_access(std::chrono::nanoseconds ttl) noexcept -> Expiry { return {Kind::after_access, ttl}; }
+    };
+
+    // Expiration policies for ThreadSafeCache, tag types in the style of the eviction policies.
+    // The nested State<Key> lives in a shard and is only touched under its exclusive lock; the
+    // Stamp lives in each entry and is read (and, for after-access, refreshed) by lock-free readers.
+    namespace cache_detail {
+        inline constexpr std::uint64_t never_expires = ~std::uint64_t{0};
+
+        inline auto steady_now() noexcept -> std::uint64_t {
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        // Copyable std::atomic with relaxed ordering; copies happen under the shard's writer lock
+        template<typename T>
+        class RelaxedAtomic {
+        public:
+            RelaxedAtomic(T value = {}) noexcept : value_(value) {}
+            RelaxedAtomic(const RelaxedAtomic& other) noexcept : value_(other.load()) {}
+            RelaxedAtomic& operator=(const RelaxedAtomic& other) noexcept {
+                store(other.load());
+                return *this;
+            }
+
+            auto load() const noexcept -> T { return value_.load(std::memory_order_relaxed); }
+            void store(T value) const noexcept { value_.store(value, std::memory_order_relaxed); }
+            auto fetch_or(T bits) const noexcept -> T { return value_.fetch_or(bits, std::memory_order_relaxed); }
+
+        private:
+            mutable std::atomic<T> value_;
+        };
+
+        inline auto saturating_add(std::uint64_t time, std::uint64_t span) noexcept -> std::uint64_t {
+            return span >= never_expires - time ? never_expires : time + span;
+        }
+
+        inline auto to_ns(std::chrono::nanoseconds span) noexcept -> std::uint64_t {
+            return static_cast<std::uint64_t>(std::max<std::int64_t>(span.count(), 0));
+        }
+
+        // How a cached entry may be served at a given time
+        enum class Freshness : std::uint8_t {
+            fresh,         // serve
+            refresh_due,   // serve, and reload in the background
+            stale,         // expired, but a reload failed within the serve-stale window: serve
+            expired,       // treat as a miss
+        };
+
+        // Deadline on the steady clock in nanoseconds. A hit on an after-access entry pushes it
+        // out with a plain store; the wheel notices when the entry's old deadline comes round.
+        // Past refresh_at, the first reader claims a background reload with one fetch_or.
+        struct ExpiryStamp {
+            static constexpr std::uint8_t refreshing = 1;
+            static constexpr std::uint8_t refresh_failed = 2;
+
+            RelaxedAtomic<std::uint64_t> deadline{never_expires};
+            std::uint64_t idle_ttl = 0;                  // non-zero for after-access entries
+            std::uint64_t refresh_at = never_expires;
+            std::uint32_t timer = no_slot;               // wheel slot, no_slot if never expires
+            RelaxedAtomic<std::uint8_t> refresh{0};      // refreshing | refresh_failed
+
+            static auto make(const Expiry& expiry, std::uint64_t now, std::uint64_t refresh_after) noexcept -> ExpiryStamp {
+                ExpiryStamp stamp;
+                if (refresh_after != 0) stamp.refresh_at = saturating_add(now, refresh_after);
+                if (expiry.kind == Expiry::Kind::never) return stamp;
+                const auto ttl = to_ns(expiry.ttl);
+                stamp.deadline.store(saturating_add(now, ttl));
+                if (expiry.kind == Expiry::Kind::after_access) stamp.idle_ttl = ttl;
+                return stamp;
+            }
+
+            bool expired(std::uint64_t now) const noexcept { return deadline.load() <= now; }
+
+            auto freshness(std::uint64_t now, std::uint64_t stale_for) const noexcept -> Freshness {
+                const auto until = deadline.load();
+                if (now < until) return now < refresh_at ? Freshness::fresh : Freshness::refresh_due;
+                if (now < saturating_add(until, stale_for) && (refresh.load() & refresh_failed)) return Freshness::stale;
+                return Freshness::expired;
+            }
+
+            // True for exactly one caller until the reload finishes; plain load first, so readers
+            // of an entry that is already refreshing do no read-modify-write
+            bool claim_refresh() const noexcept {
+                return (refresh.load() & refreshing) == 0 && (refresh.fetch_or(refreshing) & refreshing) == 0;
+            }
+
+            void touch(std::uint64_t now) const noexcept {
+                if (idle_ttl != 0) deadline.store(now + idle_ttl);
+            }
+        };
+
+        // Hierarchical timing wheel (Varghese & Lauck): five levels of 64 buckets whose ticks
+        // grow 64x per level, from ~1ms up to ~13 days per revolution of the top level. Timers
+        // are slots keyed like eviction handles; advance() only visits buckets whose tick has
+        // passed, and cascades timers that are not due yet down to finer levels, so each timer is
+        // touched O(levels) times in total. Nothing runs in the background: the shard calls
+        // advance() from its own writes.
+        template<typename Key>
+        class TimerWheel {
+        public:
+            using Handle = std::uint32_t;
+
+            auto schedule(const Key& key, std::uint64_t deadline) -> Handle {
+                const auto index = slots_.allocate(key);
+                if (due_.size() <= index) {
+                    due_.resize(index + 1);
+                    bucket_of_.resize(index + 1);
+                }
+                place(index, deadline);
+                return index;
+            }
+
+            void reschedule(Handle index, std::uint64_t deadline) {
+                slots_.unlink(buckets_[bucket_of_[index]], index);
+                place(index, deadline);
+            }
+
+            void cancel(Handle index) {
+                slots_.unlink(buckets_[bucket_of_[index]], index);
+                slots_.release(index);
+            }
+
+            // Fires every bucket whose tick lies in (last advance, now]. For each timer that is
+            // due, check(key) returns the entry's current deadline to re-arm it, or nullopt once
+            // the caller has expired the entry; the timer is then released.
+            template<typename Check>
+            void advance(std::uint64_t now, Check&& check) {
+                if (now <= current_) return;
+                const auto previous = std::exchange(current_, now);
+                for (unsigned level = 0; level < levels; ++level) {
+                    const auto from = previous >> shift(level);
+                    const auto to = now >> shift(level);
+                    if (from == to) break;   // coarser levels have not ticked either
+                    const auto ticks = std::min<std::uint64_t>(to - from, buckets_per_level);
+                    for (std::uint64_t tick = 1; tick <= ticks; ++tick) {
+                        fire(level * buckets_per_level + ((from + tick) & (buckets_per_level - 1)), check);
+                    }
+                }
+            }
+
+            void clear() {
+                slots_.clear();
+                buckets_.fill({});
+                due_.clear();
+                bucket_of_.clear();
+            }
+
+        private:
+            using List = typename SlotLists<Key>::List;
+
+            static constexpr unsigned levels = 5;
+            static constexpr std::uint64_t buckets_per_level = 64;
+            static constexpr unsigned base_shift = 20;   // 2^20ns ~ 1ms level-0 tick
+
+            static constexpr auto shift(unsigned level) noexcept -> unsigned { return base_shift + 6 * level; }
+
+            // Finest level whose revolution still reaches the deadline; overdue timers go in the
+            // next level-0 bucket, beyond the top level they park in its furthest bucket
+            void place(Handle index, std::uint64_t deadline) {
+                due_[index] = deadline;
+                auto at = std::max(deadline, current_ + (std::uint64_t{1} << base_shift));
+                unsigned level = 0;
+                while (level + 1 < levels && at - current_ >= (std::uint64_t{1} << shift(level + 1))) ++level;
+                const auto horizon = current_ + (buckets_per_level << shift(level)) - 1;
+                at = std::min(at, horizon);
+                const auto bucket = level * buckets_per_level + ((at >> shift(level)) & (buckets_per_level - 1));
+                bucket_of_[index] = static_cast<std::uint16_t>(bucket);
+                slots_.push_front(buckets_[bucket], index);
+            }
+
+            template<typename Check>
+            void fire(std::size_t bucket, Check& check) {
+                auto index = std::exchange(buckets_[bucket], List{}).head;
+                while (index != no_slot) {
+                    const auto next = slots_[index].next;
+                    if (due_[index] > current_) {
+                        place(index, due_[index]);
+                    } else if (const auto rearm = check(*slots_[index].key)) {
+                        place(index, *rearm);
+                    } else {
+                        slots_.release(index);
+                    }
+                    index = next;
+                }
+            }
+
+            SlotLists<Key> slots_;
+            std::array<List, levels * buckets_per_level> buckets_{};
+            std::vector<std::uint64_t> due_;
+            std::vector<std::uint16_t> bucket_of_;
+            std::uint64_t current_ = 0;
+        };
+    }
+
+    // Entries never expire; no stamp, no clock reads
+    struct NoExpiration {
+        static constexpr bool enabled = false;
+
+        struct Stamp {};
+
+        template<typename Key>
+        struct State {};
+    };
+
+    // Per-entry expire-after-write / expire-after-access, reaped by a per-shard timing wheel
+    // that advances lazily on the shard's writes and loads
+    struct TimerWheelExpiration {
+        static constexpr bool enabled = true;
+
+        using Stamp = cache_detail::ExpiryStamp;
+
+        template<typename Key>
+        using State = cache_detail::TimerWheel<Key>;
+    };
@@ -0,0 +1,42 @@
+    #pragma once
+
+    #include <concepts>
+    #include <cstddef>
+    #include <functional>
+    #include <string>
+    #include <string_view>
+
+    // The hash every ThreadSafeCache component uses for Key: shard selection, the storage
+    // tables, S3-FIFO's ghost queue and the TinyLFU sketch. Defaults to std::hash<Key>;
+    // specialize it to hash a key type differently.
+    //
+    // A specialization that declares is_transparent (as the standard unordered containers expect)
+    // and also accepts other types enables heterogeneous lookup: get, contains, erase and with
+    // then take those types directly, without building a Key. It must hash a probe exactly as it
+    // hashes the Key the probe compares equal to.
+    template<typename Key>
+    struct CacheHash : std::hash<Key> {};
+
+    // Strings hash through their view, so std::string_view and const char* probes need no string
+    template<typename Char, typename Traits, typename Alloc>
+    struct CacheHash<std::basic_string<Char, Traits, Alloc>> {
+        using is_transparent = void;
+
+        auto operator()(std::basic_string_view<Char, Traits> key) const noexcept -> std::size_t {
+            return std::hash<std::basic_string_view<Char, Traits>>{}(key);
+        }
+    };
+
+    namespace cache_detail {
+        // A probe of type Q can find a Key without a Key being built from it. It must still be able
+        // to build one, for the loader on a miss.
+        template<typename Q, typename Key>
+        concept TransparentLookup = !std::same_as<Q, Key> && requires { typename CacheHash<Key>::is_transparent; } &&
+            std::constructible_from<Key, const Q&> && requires(const Q& probe, const Key& key) {
+                { CacheHash<Key>{}(probe) } -> std::convertible_to<std::size_t>;
+                { key == probe } -> std::convertible_to<bool>;
+            };
+
+        template<typename Q, typename Key>
+        concept DirectLookup = std::same_as<Q, Key> || TransparentLookup<Q, Key>;
+    }
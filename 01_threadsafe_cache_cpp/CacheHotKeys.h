@@ -0,0 +1,281 @@
+    #pragma once
+
+    #include <algorithm>
+    #include <array>
+    #include <chrono>
+    #include <cstddef>
+    #include <cstdint>
+    #include <functional>
+    #include <memory>
+    #include <mutex>
+    #include <unordered_map>
+    #include <utility>
+    #include <vector>
+
+    #include "CacheHash.h"
+    #include "CacheStats.h"
+
+    // One of the most accessed keys, as estimated by HotKeys. Space-Saving never underestimates
+    // a count, so both figures are upper bounds, too high by at most error_share of the traffic.
+    template<typename Key>
+    struct HotKey {
+        Key key;
+        double per_second = 0;    // lookups of this key per second, recent ones weighted most
+        double share = 0;         // fraction of all lookups
+        double error_share = 0;   // how much of share may belong to keys it displaced
+    };
+
+    namespace cache_detail {
+        // Sampled heavy-hitter tracking. About one lookup in SampleEvery is copied into a
+        // thread_local buffer of the calling thread, which takes no lock and shares no cache line.
+        // A full buffer is folded into a Space-Saving summary of Counters keys under one mutex,
+        // so the lock is taken once per buffer_size samples. Counts halve every half_life, and
+        // the window the rates are measured over halves with them.
+        template<typename Key, std::size_t Counters, std::uint32_t SampleEvery>
+        class HotKeyTracker {
+        public:
+            static constexpr std::size_t buffer_size = 64;
+            static constexpr auto half_life = std::chrono::seconds(1);
+
+            HotKeyTracker() {
+                heap_.reserve(Counters);
+                where_.reserve(Counters);
+            }
+
+            // Called on every lookup; the first branch is all that most of them pay
+            template<typename Q>
+            void sample(const Q& key) const {
+                thread_local std::uint32_t countdown = 0;
+                if (countdown-- != 0) return;
+                countdown = next_gap();
+                auto& buffer = local_buffer();
+                buffer.keys.emplace_back(key);
+                if (buffer.keys.size() < buffer_size) return;
+                std::lock_guard lock{inbox_->mutex};
+                fold(buffer.keys);
+            }
+
+            // The k keys with the highest estimated counts, hottest first. Counts the calling
+            // thread's samples so far; other threads' only once their buffer fills or they exit.
+            auto top(std::size_t k) const -> std::vector<HotKey<Key>> {
+                if (auto* buffer = find_local_buffer()) buffer->hand_over();
+                std::lock_guard lock{inbox_->mutex};
+                fold();
+
+                std::vector<const Counter*> order;
+                order.reserve(heap_.size());
+                for (const auto& counter : heap_) {
+                    if (counter.count != 0) order.push_back(&counter);
+                }
+                k = std::min(k, order.size());
+                std::partial_sort(order.begin(), order.begin() + static_cast<std::ptrdiff_t>(k), order.end(),
+                                  [](const Counter* a, const Counter* b) { return a->count > b->count; });
+
+                const auto seconds = std::max(1e-9, static_cast<double>(stats_clock() - window_start_) / 1e9);
+                const auto total = static_cast<double>(std::max<std::uint64_t>(total_, 1));
+                std::vector<HotKey<Key>> hot;
+                hot.reserve(k);
+                for (std::size_t i = 0; i < k; ++i) {
+                    const auto count = static_cast<double>(order[i]->count);
+                    hot.push_back({order[i]->key, count * SampleEvery / seconds, count / total,
+                                   static_cast<double>(order[i]->error) / total});
+                }
+                return hot;
+            }
+
+        private:
+            static_assert(Counters > 0 && SampleEvery > 0, "HotKeys needs at least one counter and sample");
+
+            struct Counter {
+                Key key;
+                std::uint64_t count = 0;
+                std::uint64_t error = 0;   // count the key inherited when it took the slot
+            };
+
+            // Where threads leave the samples of buffers they give up before they are full: at
+            // thread exit, or when the thread's slots are needed for other trackers. Its mutex
+            // guards the summary too. Buffers share ownership, so a tracker may die before them.
+            struct Inbox {
+                std::mutex mutex;
+                std::vector<Key> keys;
+            };
+
+            struct LocalBuffer {
+                std::shared_ptr<Inbox> inbox;
+                std::vector<Key> keys;
+
+                LocalBuffer() = default;
+                LocalBuffer(const LocalBuffer&) = delete;
+                LocalBuffer& operator=(const LocalBuffer&) = delete;
+
+                ~LocalBuffer() {
+                    try {
+                        hand_over();
+                    } catch (...) {   // out of memory: the samples are dropped
+                    }
+                }
+
+                void hand_over() {
+                    if (inbox && !keys.empty()) {
+                        std::lock_guard lock{inbox->mutex};
+                        inbox->keys.insert(inbox->keys.end(), std::make_move_iterator(keys.begin()), std::make_move_iterator(keys.end()));
+                    }
+                    keys.clear();
+                }
+            };
+
+            // A thread's buffers, one per tracker it samples for, up to local_slots trackers of
+            // this type; beyond that the oldest is handed over to make room
+            static constexpr std::size_t local_slots = 4;
+
+            struct LocalBuffers {
+                std::array<LocalBuffer, local_slots> slots;
+                std::size_t next = 0;
+            };
+
+            static auto local_buffers() noexcept -> LocalBuffers& {
+                thread_local LocalBuffers buffers;
+                return buffers;
+            }
+
+            auto find_local_buffer() const noexcept -> LocalBuffer* {
+                for (auto& buffer : local_buffers().slots) {
+                    if (buffer.inbox == inbox_) return &buffer;
+                }
+                return nullptr;
+            }
+
+            auto local_buffer() const -> LocalBuffer& {
+                if (auto* buffer = find_local_buffer()) return *buffer;
+                auto& buffers = local_buffers();
+                auto& buffer = buffers.slots[buffers.next++ % local_slots];
+                buffer.hand_over();
+                buffer.inbox = inbox_;
+                buffer.keys.reserve(buffer_size);
+                return buffer;
+            }
+
+            // Lookups skipped before the next sample, so sampling intervals are uniform in
+            // [1, 2 * SampleEvery - 1]: a mean of SampleEvery that does not lock onto lookup
+            // patterns repeating with a fixed period
+            static auto next_gap() noexcept -> std::uint32_t {
+                thread_local std::uint32_t state = 0x9e3779b9u ^ stripe_seed();
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+                return SampleEvery == 1 ? 0 : state % (2 * SampleEvery - 1);
+            }
+
+            // Inbox lock held; folds what threads handed over
+            void fold() const {
+                decay(stats_clock());
+                for (auto& key : inbox_->keys) offer(std::move(key));
+                inbox_->keys.clear();
+            }
+
+            // Inbox lock held; folds a full buffer as well, leaving it empty
+            void fold(std::vector<Key>& keys) const {
+                fold();
+                for (auto& key : keys) offer(std::move(key));
+                keys.clear();
+            }
+
+            // Space-Saving: a tracked key counts up; a new one replaces the minimum counter and
+            // inherits its count as error. heap_ is a min-heap on count, where_ its index.
+            void offer(Key&& key) const {
+                ++total_;
+                if (auto it = where_.find(key); it != where_.end()) {
+                    ++heap_[it->second].count;
+                    sift_down(it->second);
+                    return;
+                }
+                if (heap_.size() < Counters) {
+                    where_.emplace(key, heap_.size());
+                    heap_.push_back({std::move(key), 1, 0});
+                    sift_up(heap_.size() - 1);
+                    return;
+                }
+                auto& least = heap_.front();
+                where_.erase(least.key);
+                where_.emplace(key, 0);
+                least.key = std::move(key);
+                least.error = least.count;
+                ++least.count;
+                sift_down(0);
+            }
+
+            // Halving keeps the heap order, and moving the window start halfway to now keeps
+            // count / window, so rates stay comparable across a halving
+            void decay(std::uint64_t now) const {
+                if (window_start_ == 0) window_start_ = last_halving_ = now;
+                const auto period = static_cast<std::uint64_t>(std::chrono::nanoseconds(half_life).count());
+                if (now - last_halving_ >= 64 * period) last_halving_ = now - 64 * period;   // all counts reach 0 by then
+                while (now - last_halving_ >= period) {
+                    for (auto& counter : heap_) {
+                        counter.count /= 2;
+                        counter.error /= 2;
+                    }
+                    total_ /= 2;
+                    window_start_ += (now - window_start_) / 2;
+                    last_halving_ += period;
+                }
+            }
+
+            void sift_up(std::size_t i) const {
+                while (i > 0) {
+                    const auto parent = (i - 1) / 2;
+                    if (heap_[parent].count <= heap_[i].count) return;
+                    swap_at(i, parent);
+                    i = parent;
+                }
+            }
+
+            void sift_down(std::size_t i) const {
+                for (;;) {
+                    auto least = i;
+                    for (auto child = 2 * i + 1; child <= 2 * i + 2 && child < heap_.size(); ++child) {
+                        if (heap_[child].count < heap_[least].count) least = child;
+                    }
+                    if (least == i) return;
+                    swap_at(i, least);
+                    i = least;
+                }
+            }
+
+            void swap_at(std::size_t a, std::size_t b) const {
+                std::swap(heap_[a], heap_[b]);
+                where_[heap_[a].key] = a;
+                where_[heap_[b].key] = b;
+            }
+
+            const std::shared_ptr<Inbox> inbox_ = std::make_shared<Inbox>();
+            // Guarded by inbox_->mutex
+            mutable std::vector<Counter> heap_;
+            mutable std::unordered_map<Key, std::size_t, CacheHash<Key>, std::equal_to<>> where_;
+            mutable std::uint64_t total_ = 0;
+            mutable std::uint64_t window_start_ = 0;   // ns; 0 until the first sample
+            mutable std::uint64_t last_halving_ = 0;
+        };
+
+        struct NoHotKeyTracker {
+            template<typename Q>
+            void sample(const Q&) const noexcept {}
+        };
+    }
+
+    // Hot-key policies for ThreadSafeCache, tag types like the other policies
+    struct NoHotKeys {
+        static constexpr bool enabled = false;
+
+        template<typename Key>
+        using Tracker = cache_detail::NoHotKeyTracker;
+    };
+
+    // Tracks the Counters most accessed keys from about one lookup in SampleEvery
+    template<std::size_t Counters = 64, std::uint32_t SampleEvery = 16>
+    struct HotKeys {
+        static constexpr bool enabled = true;
+
+        template<typename Key>
+        using Tracker = cache_detail::HotKeyTracker<Key, Counters, SampleEvery>;
+    };
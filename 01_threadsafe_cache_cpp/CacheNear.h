@@ -0,0 +1,117 @@
+    #pragma once
+
+    #include <atomic>
+    #include <bit>
+    #include <cstddef>
+    #include <cstdint>
+    #include <memory>
+    #include <optional>
+    #include <utility>
+
+    #include "CacheEviction.h"
+
+    // Near-cache policies for ThreadSafeCache, tag types like the other policies. With
+    // NearCache<Slots>, every thread keeps a small 2-way set-associative table of recent get()
+    // hits in front of the shards. A hit there takes no lock and writes nothing shared; it is
+    // checked against the shard's write version, which put, erase and clear bump.
+    namespace cache_detail {
+        // Tells apart the caches that share one thread's table; never reused
+        inline auto next_near_owner() noexcept -> std::uint64_t {
+            static std::atomic<std::uint64_t> next{1};
+            return next.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // A shard's write version, on its own cache line: near hits load it, so it must not
+        // share a line with the shard lock that every other reader writes to
+        struct alignas(64) NearVersion {
+            std::atomic<std::uint64_t> value{0};
+
+            auto load() const noexcept -> std::uint64_t { return value.load(std::memory_order_acquire); }
+
+            // Exclusive lock held, after the write: a reader that sees the new version sees the write
+            void bump() noexcept { value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+        };
+
+        struct NoNearVersion {
+            auto load() const noexcept -> std::uint64_t { return 0; }
+            void bump() noexcept {}
+        };
+
+        // One thread's near cache for every cache of one type. A slot holds a copy of the value,
+        // the cache it came from, the shard version read before the value was, and the time it
+        // stops being servable (expiry or refresh-ahead). It serves until that shard is written;
+        // every resync_every-th hit on a slot falls through to the shard instead, so the
+        // eviction policy still sees the key as hot.
+        template<typename Key, typename Stored, std::size_t Slots>
+        class NearTable {
+        public:
+            static constexpr std::uint32_t resync_every = 64;
+
+            template<typename Q>
+            auto find(std::uint64_t owner, const Q& key, std::size_t hash, std::uint64_t version, std::uint64_t now) noexcept -> const Stored* {
+                const auto set = set_of(hash);
+                for (std::size_t way = 0; way < 2; ++way) {
+                    auto& slot = slots_[set * 2 + way];
+                    if (slot.owner != owner || slot.version != version || !(slot.entry->first == key)) continue;
+                    if (now >= slot.until || ++slot.hits == resync_every) return nullptr;
+                    recent_[set] = static_cast<std::uint8_t>(way);
+                    return &slot.entry->second;
+                }
+                return nullptr;
+            }
+
+            // Replaces key's slot, or else the way of its set used less recently
+            template<typename Q>
+            void fill(std::uint64_t owner, const Q& key, std::size_t hash, std::uint64_t version, std::uint64_t until, const Stored& value) {
+                const auto set = set_of(hash);
+                std::size_t way = recent_[set] ^ 1u;
+                if (slots_[set * 2].owner == owner && slots_[set * 2].entry->first == key) way = 0;
+                if (slots_[set * 2 + 1].owner == owner && slots_[set * 2 + 1].entry->first == key) way = 1;
+                auto& slot = slots_[set * 2 + way];
+                slot.owner = 0;   // empty while the copy is made, in case it throws
+                slot.entry.emplace(Key(key), value);
+                slot.owner = owner;
+                slot.version = version;
+                slot.until = until;
+                slot.hits = 0;
+                recent_[set] = static_cast<std::uint8_t>(way);
+            }
+
+        private:
+            static_assert(Slots >= 2 && std::has_single_bit(Slots), "NearCache slots must be a power of two");
+            static constexpr std::size_t sets = Slots / 2;
+
+            struct Slot {
+                std::uint64_t owner = 0;   // 0 = empty
+                std::uint64_t version = 0;
+                std::uint64_t until = 0;
+                std::uint32_t hits = 0;
+                std::optional<std::pair<Key, Stored>> entry;
+            };
+
+            // The high half of the mixed hash, so the set is independent of the shard
+            static auto set_of(std::size_t hash) noexcept -> std::size_t { return (mix_hash(hash) >> 32) & (sets - 1); }
+
+            std::unique_ptr<Slot[]> slots_ = std::make_unique<Slot[]>(Slots);
+            std::unique_ptr<std::uint8_t[]> recent_ = std::make_unique<std::uint8_t[]>(sets);
+        };
+
+        struct NoNearTable {};
+    }
+
+    struct NoNearCache {
+        static constexpr bool enabled = false;
+
+        using Version = cache_detail::NoNearVersion;
+        template<typename Key, typename Stored>
+        using Table = cache_detail::NoNearTable;
+    };
+
+    template<std::size_t Slots = 256>
+    struct NearCache {
+        static constexpr bool enabled = true;
+
+        using Version = cache_detail::NearVersion;
+        template<typename Key, typename Stored>
+        using Table = cache_detail::NearTable<Key, Stored, Slots>;
+    };
@@ -0,0 +1,289 @@
+    #pragma once
+
+    #include <algorithm>
+    #include <atomic>
+    #include <bit>
+    #include <charconv>
+    #include <cstddef>
+    #include <cstdint>
+    #include <fstream>
+    #include <mutex>
+    #include <new>
+    #include <shared_mutex>
+    #include <string>
+    #include <thread>
+    #include <utility>
+    #include <vector>
+    #include <sched.h>
+
+    #include "CacheEviction.h"
+    #include "CachePool.h"
+    #include "CacheStorage.h"
+
+    namespace cache_detail {
+        inline constexpr std::size_t unbound_node = ~std::size_t{0};
+
+        // The node NumaTopology::bind_current_thread put this thread on, if any
+        inline auto bound_numa_node() noexcept -> std::size_t& {
+            thread_local std::size_t node = unbound_node;
+            return node;
+        }
+
+        // A sysfs list such as "0-3,8,10-11"; empty if the text is
+        inline auto parse_id_list(const std::string& text) -> std::vector<unsigned> {
+            std::vector<unsigned> ids;
+            const char* at = text.data();
+            const char* const end = text.data() + text.size();
+            while (at < end) {
+                unsigned first = 0;
+                auto parsed = std::from_chars(at, end, first);
+                if (parsed.ec != std::errc{}) {
+                    ++at;
+                    continue;
+                }
+                unsigned last = first;
+                if (parsed.ptr < end && *parsed.ptr == '-') parsed = std::from_chars(parsed.ptr + 1, end, last);
+                for (auto id = first; id <= last && last - first < 65536; ++id) ids.push_back(id);
+                at = parsed.ptr;
+            }
+            return ids;
+        }
+
+        inline auto read_first_line(const std::string& path) -> std::string {
+            std::ifstream in(path);
+            std::string line;
+            std::getline(in, line);
+            return line;
+        }
+    }
+
+    // The NUMA nodes a cache spreads its shards over: for each, the kernel's node id its memory is
+    // bound to and the CPUs that count as on it. Usually detect()ed; synthetic() lays out more
+    // nodes than the host has, to exercise NUMA mode on smaller machines.
+    class NumaTopology {
+    public:
+        struct Node {
+            unsigned memory_node = 0;
+            std::vector<unsigned> cpus;
+        };
+
+        NumaTopology() = default;   // empty: ThreadSafeCache detects the host's
+
+        explicit NumaTopology(std::vector<Node> nodes) : nodes_(std::move(nodes)) {
+            for (std::size_t node = 0; node < nodes_.size(); ++node) {
+                for (auto cpu : nodes_[node].cpus) {
+                    if (cpu >= cpu_node_.size()) cpu_node_.resize(cpu + 1, 0);
+                    cpu_node_[cpu] = static_cast<std::uint16_t>(node);
+                }
+            }
+        }
+
+        // The online nodes that have CPUs, from /sys/devices/system/node (no libnuma). Memory-only
+        // nodes run no threads and get no shards. Without NUMA information, one node with every CPU.
+        static auto detect() -> NumaTopology {
+            const std::string root = "/sys/devices/system/node/";
+            std::vector<Node> nodes;
+            for (auto id : cache_detail::parse_id_list(cache_detail::read_first_line(root + "online"))) {
+                auto cpus = cache_detail::parse_id_list(cache_detail::read_first_line(root + "node" + std::to_string(id) + "/cpulist"));
+                if (!cpus.empty()) nodes.push_back({id, std::move(cpus)});
+            }
+            if (nodes.empty()) {
+                Node all;
+                for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu) all.cpus.push_back(cpu);
+                nodes.push_back(std::move(all));
+            }
+            return NumaTopology(std::move(nodes));
+        }
+
+        // count nodes cut from the host's CPUs in order, each with the memory of its first CPU's
+        // node. With fewer CPUs than nodes, nodes share CPUs; threads then need bind_current_thread.
+        static auto synthetic(std::size_t count) -> NumaTopology {
+            std::vector<std::pair<unsigned, unsigned>> cpus;   // (cpu, memory node)
+            for (const auto& node : detect().nodes_) {
+                for (auto cpu : node.cpus) cpus.emplace_back(cpu, node.memory_node);
+            }
+            std::vector<Node> nodes(std::max<std::size_t>(count, 1));
+            for (std::size_t node = 0; node < nodes.size(); ++node) {
+                const auto begin = node * cpus.size() / nodes.size();
+                const auto end = std::max(begin + 1, (node + 1) * cpus.size() / nodes.size());
+                for (auto i = begin; i < end; ++i) nodes[node].cpus.push_back(cpus[i % cpus.size()].first);
+                nodes[node].memory_node = cpus[begin % cpus.size()].second;
+            }
+            return NumaTopology(std::move(nodes));
+        }
+
+        auto size() const noexcept -> std::size_t { return nodes_.size(); }
+        bool empty() const noexcept { return nodes_.empty(); }
+        auto nodes() const noexcept -> const std::vector<Node>& { return nodes_; }
+
+        // The node the calling thread was bound to, or else the one its current CPU is on
+        auto current_node() const noexcept -> std::size_t {
+            if (const auto bound = cache_detail::bound_numa_node(); bound != cache_detail::unbound_node) {
+                return bound < nodes_.size() ? bound : bound % nodes_.size();
+            }
+            const auto cpu = sched_getcpu();
+            return cpu >= 0 && static_cast<std::size_t>(cpu) < cpu_node_.size() ? cpu_node_[cpu] : 0;
+        }
+
+        // Pins the calling thread to node's CPUs, as numactl --cpunodebind would, and makes it
+        // count as on node for every cache whatever CPU it runs on. False if the affinity was
+        // refused; the thread still counts as on node.
+        bool bind_current_thread(std::size_t node) const {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (auto cpu : nodes_.at(node).cpus) {
+                if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+            }
+            cache_detail::bound_numa_node() = node;
+            return sched_setaffinity(0, sizeof(set), &set) == 0;
+        }
+
+    private:
+        std::vector<Node> nodes_;
+        std::vector<std::uint16_t> cpu_node_;   // node index by CPU id
+    };
+
+    namespace cache_detail {
+        // One run of Ts per topology node, each on its own pages bound to that node's memory and
+        // constructed there, so the first touch is local too. A run holds a power of two of Ts:
+        // element (node, i) is at index node * per_node() + i, found with a shift and a mask.
+        template<typename T>
+        class NodeArray {
+        public:
+            NodeArray(const NumaTopology& topology, std::size_t per_node)
+                : shift_(static_cast<unsigned>(std::countr_zero(std::bit_ceil(std::max<std::size_t>(per_node, 1))))),
+                  nodes_(topology.size()),
+                  stride_(round_to_pages((std::size_t{1} << shift_) * sizeof(T))),
+                  base_(static_cast<std::byte*>(map_pages(stride_ * nodes_))) {
+                static_assert(alignof(T) <= 4096, "NodeArray elements are placed on page boundaries");
+                for (std::size_t node = 0; node < nodes_; ++node) {
+                    bind_pages(base_ + node * stride_, stride_, topology.nodes()[node].memory_node);
+                }
+                std::size_t built = 0;
+                try {
+                    for (; built < size(); ++built) new (address(built)) T();
+                } catch (...) {
+                    while (built > 0) (*this)[--built].~T();
+                    unmap_pages(base_, stride_ * nodes_);
+                    throw;
+                }
+            }
+
+            NodeArray(NodeArray&& other) noexcept
+                : shift_(other.shift_), nodes_(std::exchange(other.nodes_, 0)), stride_(other.stride_), base_(std::exchange(other.base_, nullptr)) {}
+
+            NodeArray& operator=(NodeArray&&) = delete;
+
+            ~NodeArray() {
+                if (!base_) return;
+                for (auto i = size(); i > 0; --i) (*this)[i - 1].~T();
+                unmap_pages(base_, stride_ * nodes_);
+            }
+
+            T& operator[](std::size_t index) const noexcept { return *std::launder(reinterpret_cast<T*>(address(index))); }
+            T& at(std::size_t node, std::size_t i) const noexcept { return (*this)[(node << shift_) | i]; }
+
+            auto size() const noexcept -> std::size_t { return nodes_ << shift_; }
+            auto per_node() const noexcept -> std::size_t { return std::size_t{1} << shift_; }
+            auto node_count() const noexcept -> std::size_t { return nodes_; }
+            auto node_of(std::size_t index) const noexcept -> std::size_t { return index >> shift_; }
+
+        private:
+            auto address(std::size_t index) const noexcept -> std::byte* {
+                return base_ + (index >> shift_) * stride_ + (index & (per_node() - 1)) * sizeof(T);
+            }
+
+            unsigned shift_;
+            std::size_t nodes_;
+            std::size_t stride_;
+            std::byte* base_;
+        };
+
+        // One node's copies of entries it read from one other node's shard, all taken at one
+        // write version of that shard (the one NearCache checks). A replica that is behind the
+        // shard is only refilled after hot_after lookups found it so, which keeps shards that are
+        // written about as often as they are read from being copied at all. At most Slots copies,
+        // on the reading node's memory; every resync_every-th hit per thread goes to the shard
+        // instead, so its eviction policy still sees the key as hot.
+        template<typename Key, typename Stored, std::size_t Slots>
+        class ShardReplica {
+        public:
+            static constexpr std::uint32_t hot_after = 16;
+            static constexpr std::uint32_t resync_every = 64;
+
+            void bind(unsigned memory_node) noexcept { pool_.bind(memory_node); }
+
+            // fn(value) with the copy of key taken at version, if there is one servable at now
+            template<typename Q, typename Fn>
+            bool read(const Q& key, std::size_t hash, std::uint64_t version, std::uint64_t now, Fn&& fn) const {
+                if (version_.load(std::memory_order_relaxed) != version) return false;
+                std::shared_lock lock{mutex_};
+                const auto* copy = map_.find(key, hash);
+                if (!copy || version_.load(std::memory_order_relaxed) != version || now >= copy->until) return false;
+                if (++resync_count() % resync_every == 0) return false;
+                fn(copy->value);
+                return true;
+            }
+
+            // Whether a shard hit read at version should be copied here
+            bool wants(std::uint64_t version) noexcept {
+                return version_.load(std::memory_order_relaxed) == version ||
+                       heat_.fetch_add(1, std::memory_order_relaxed) + 1 >= hot_after;
+            }
+
+            // Shard read guard held; a copy taken at an older version than the replica's is dropped
+            template<typename Q>
+            void fill(const Q& key, std::size_t hash, std::uint64_t version, std::uint64_t until, const Stored& value) {
+                std::lock_guard lock{mutex_};
+                const auto current = version_.load(std::memory_order_relaxed);
+                if (version < current) return;
+                if (version != current) {
+                    map_.clear();
+                    version_.store(version, std::memory_order_relaxed);
+                    heat_.store(0, std::memory_order_relaxed);
+                }
+                if (map_.size() >= Slots || map_.find(key, hash)) return;
+                map_.try_emplace(Key(key), hash, Copy{value, until});
+            }
+
+        private:
+            struct Copy {
+                Stored value;
+                std::uint64_t until;   // as a near copy: the entry's deadline or refresh time
+            };
+
+            static auto resync_count() noexcept -> std::uint32_t& {
+                thread_local std::uint32_t count = 0;
+                return count;
+            }
+
+            mutable std::shared_mutex mutex_;
+            std::atomic<std::uint64_t> version_{0};   // written under the exclusive lock
+            std::atomic<std::uint32_t> heat_{0};
+            SlabPool pool_;   // before the map, which frees into it
+            NodeStorage::Table<Key, Copy, PoolAllocator<std::byte>> map_{PoolAllocator<std::byte>(&pool_)};
+        };
+
+        struct NoShardReplica {};
+    }
+
+    // NUMA policies for ThreadSafeCache, tag types like the other policies
+    struct NoNuma {
+        static constexpr bool enabled = false;
+        static constexpr bool replicated = false;
+
+        template<typename Key, typename Stored>
+        using Replica = cache_detail::NoShardReplica;
+    };
+
+    // Splits the shards into one group per node of CacheOptions::numa, each group on its node's
+    // memory; a key's hash picks its home node as well as its shard there. With ReplicaSlots,
+    // every node also keeps read replicas of up to that many entries of each other node's shards.
+    template<std::size_t ReplicaSlots = 0>
+    struct NumaShards {
+        static constexpr bool enabled = true;
+        static constexpr bool replicated = ReplicaSlots > 0;
+
+        template<typename Key, typename Stored>
+        using Replica = cache_detail::ShardReplica<Key, Stored, ReplicaSlots>;
+    };
@@ -0,0 +1,218 @@
+    #pragma once
+
+    #include <cerrno>
+    #include <chrono>
+    #include <concepts>
+    #include <cstddef>
+    #include <cstdint>
+    #include <cstring>
+    #include <stdexcept>
+    #include <string>
+    #include <string_view>
+    #include <system_error>
+    #include <type_traits>
+    #include <utility>
+
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+
+    // Serializer hook for ThreadSafeCache::save()/load(). Specialize for your key or value type:
+    //
+    //   template<> struct CacheCodec<User> {
+    //       static void write(std::string& out, const User& user);   // append bytes to out
+    //       static auto read(std::string_view& in) -> User;          // consume bytes from the front of in
+    //   };
+    //
+    // read() must throw if in is too short. Trivially copyable types (other than pointers) and
+    // std::string are built in.
+    template<typename T>
+    struct CacheCodec;
+
+    namespace cache_detail {
+        // Keys and values copied byte for byte; a snapshot of them is fixed-size records
+        template<typename T>
+        concept RawCodable = std::is_trivially_copyable_v<T> && !std::is_pointer_v<T>;
+
+        [[noreturn]] inline void truncated_snapshot() {
+            throw std::runtime_error("ThreadSafeCache: truncated snapshot");
+        }
+
+        inline void append_bytes(std::string& out, const void* bytes, std::size_t size) {
+            out.append(static_cast<const char*>(bytes), size);
+        }
+
+        inline void take_bytes(std::string_view& in, void* bytes, std::size_t size) {
+            if (in.size() < size) truncated_snapshot();
+            std::memcpy(bytes, in.data(), size);
+            in.remove_prefix(size);
+        }
+    }
+
+    template<cache_detail::RawCodable T>
+    struct CacheCodec<T> {
+        static void write(std::string& out, const T& value) { cache_detail::append_bytes(out, &value, sizeof(T)); }
+        static auto read(std::string_view& in) -> T {
+            T value;
+            cache_detail::take_bytes(in, &value, sizeof(T));
+            return value;
+        }
+    };
+
+    template<>
+    struct CacheCodec<std::string> {
+        static void write(std::string& out, const std::string& value) {
+            const std::uint64_t size = value.size();
+            cache_detail::append_bytes(out, &size, sizeof(size));
+            out.append(value);
+        }
+        static auto read(std::string_view& in) -> std::string {
+            std::uint64_t size = 0;
+            cache_detail::take_bytes(in, &size, sizeof(size));
+            if (in.size() < size) cache_detail::truncated_snapshot();
+            std::string value(in.substr(0, size));
+            in.remove_prefix(size);
+            return value;
+        }
+    };
+
+    template<typename T>
+    concept Serializable = requires(std::string& out, const T& value, std::string_view& in) {
+        CacheCodec<T>::write(out, value);
+        { CacheCodec<T>::read(in) } -> std::convertible_to<T>;
+    };
+
+    namespace cache_detail {
+        // File layout: this header, then `entries` records of key, value and, with has_expiry,
+        // the remaining TTL and idle TTL in ns (never_expires / 0 when the entry does not expire).
+        // Native byte order; the byte_order field rejects a file from the other endianness.
+        struct SnapshotHeader {
+            static constexpr char expected_magic[8] = {'T', 'S', 'C', 'S', 'N', 'A', 'P', '1'};
+            static constexpr std::uint32_t native_order = 0x01020304;
+
+            char magic[8] = {};
+            std::uint32_t byte_order = native_order;
+            std::uint32_t has_expiry = 0;
+            std::uint32_t key_size = 0;     // sizeof(Key) for raw keys, 0 for codec-encoded ones
+            std::uint32_t value_size = 0;   // likewise for values
+            std::uint64_t entries = 0;
+            std::int64_t saved_at = 0;      // system_clock ns, to age the TTLs on load
+
+            template<typename Key, typename Value>
+            static auto describe(bool has_expiry) noexcept -> SnapshotHeader {
+                SnapshotHeader header;
+                std::memcpy(header.magic, expected_magic, sizeof(magic));
+                header.has_expiry = has_expiry;
+                if constexpr (RawCodable<Key>) header.key_size = sizeof(Key);
+                if constexpr (RawCodable<Value>) header.value_size = sizeof(Value);
+                return header;
+            }
+
+            // Throws unless this header was written for the same key and value encodings
+            void check(const SnapshotHeader& expected) const {
+                if (std::memcmp(magic, expected_magic, sizeof(magic)) != 0 || byte_order != native_order) {
+                    throw std::runtime_error("ThreadSafeCache: not a snapshot file");
+                }
+                if (key_size != expected.key_size || value_size != expected.value_size) {
+                    throw std::runtime_error("ThreadSafeCache: snapshot was saved with other key or value types");
+                }
+            }
+        };
+
+        inline auto system_now() noexcept -> std::int64_t {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+
+        [[noreturn]] inline void throw_errno(const std::string& what) {
+            throw std::system_error(errno, std::generic_category(), "ThreadSafeCache: " + what);
+        }
+
+        // Writes path.tmp and renames it over path on commit(), so a reader never sees a
+        // half-written snapshot; without a commit the temporary file is removed
+        class SnapshotWriter {
+        public:
+            explicit SnapshotWriter(std::string path) : path_(std::move(path)), temporary_(path_ + ".tmp") {
+                fd_ = ::open(temporary_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+                if (fd_ < 0) throw_errno("open " + temporary_);
+                const SnapshotHeader placeholder{};
+                append(std::string_view(reinterpret_cast<const char*>(&placeholder), sizeof(placeholder)));
+            }
+            SnapshotWriter(const SnapshotWriter&) = delete;
+            SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+            ~SnapshotWriter() {
+                if (fd_ < 0) return;
+                ::close(fd_);
+                ::unlink(temporary_.c_str());
+            }
+
+            void append(std::string_view bytes) {
+                while (!bytes.empty()) {
+                    const auto written = ::write(fd_, bytes.data(), bytes.size());
+                    if (written < 0 && errno == EINTR) continue;
+                    if (written < 0) throw_errno("write " + temporary_);
+                    bytes.remove_prefix(static_cast<std::size_t>(written));
+                }
+            }
+
+            void commit(const SnapshotHeader& header) {
+                if (::pwrite(fd_, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) throw_errno("write " + temporary_);
+                if (::fsync(fd_) != 0) throw_errno("fsync " + temporary_);
+                const int fd = std::exchange(fd_, -1);
+                if (::close(fd) != 0) {
+                    ::unlink(temporary_.c_str());
+                    throw_errno("close " + temporary_);
+                }
+                if (::rename(temporary_.c_str(), path_.c_str()) != 0) {
+                    const int error = errno;
+                    ::unlink(temporary_.c_str());
+                    errno = error;
+                    throw_errno("rename " + temporary_);
+                }
+            }
+
+        private:
+            std::string path_;
+            std::string temporary_;
+            int fd_ = -1;
+        };
+
+        // Read-only mapping of a whole snapshot file; pages are faulted in as load() walks it
+        class MappedSnapshot {
+        public:
+            explicit MappedSnapshot(const std::string& path) {
+                const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+                if (fd < 0) throw_errno("open " + path);
+                struct stat info {};
+                if (::fstat(fd, &info) != 0) {
+                    const int error = errno;
+                    ::close(fd);
+                    errno = error;
+                    throw_errno("stat " + path);
+                }
+                size_ = static_cast<std::size_t>(info.st_size);
+                if (size_ != 0) {
+                    data_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (data_ == MAP_FAILED) {
+                        const int error = errno;
+                        ::close(fd);
+                        errno = error;
+                        throw_errno("mmap " + path);
+                    }
+                    ::madvise(data_, size_, MADV_SEQUENTIAL);
+                }
+                ::close(fd);   // the mapping keeps the file open
+            }
+            MappedSnapshot(const MappedSnapshot&) = delete;
+            MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+            ~MappedSnapshot() {
+                if (size_ != 0) ::munmap(data_, size_);
+            }
+
+            auto bytes() const noexcept -> std::string_view { return {static_cast<const char*>(data_), size_}; }
+
+        private:
+            void* data_ = nullptr;
+            std::size_t size_ = 0;
+        };
+    }
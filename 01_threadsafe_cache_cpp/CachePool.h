@@ -0,0 +1,214 @@
+    #pragma once
+
+    #include <algorithm>
+    #include <array>
+    #include <atomic>
+    #include <cstddef>
+    #include <cstdint>
+    #include <limits>
+    #include <new>
+    #include <vector>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+
+    // Heap held by a ThreadSafeCache's tables, summed over its shards (PoolAllocator only).
+    // Key and value types that allocate on their own (std::string, ...) are not included.
+    struct CacheMemory {
+        std::size_t node_bytes = 0;       // entry nodes in use, rounded up to their size class
+        std::size_t table_bytes = 0;      // bucket arrays and other allocations too big to pool
+        std::size_t reserved_bytes = 0;   // slabs plus table_bytes: what the tables hold from the heap
+
+        auto free_bytes() const noexcept -> std::size_t { return reserved_bytes - table_bytes - node_bytes; }
+    };
+
+    namespace cache_detail {
+        inline auto page_size() noexcept -> std::size_t {
+            static const auto size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+            return size;
+        }
+
+        inline auto round_to_pages(std::size_t bytes) noexcept -> std::size_t {
+            return (bytes + page_size() - 1) / page_size() * page_size();
+        }
+
+        // Fresh anonymous pages, untouched, so a binding set before the first write decides
+        // where they are placed
+        inline auto map_pages(std::size_t bytes) -> void* {
+            void* pages = mmap(nullptr, round_to_pages(bytes), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (pages == MAP_FAILED) throw std::bad_alloc{};
+            return pages;
+        }
+
+        inline void unmap_pages(void* pages, std::size_t bytes) noexcept { munmap(pages, round_to_pages(bytes)); }
+
+        // Prefers memory_node for pages not yet touched, through the raw mbind syscall (no
+        // libnuma). Preferred rather than bound: a full node falls back to the others instead of
+        // failing. Where the kernel refuses the call, placement stays first-touch.
+        inline void bind_pages(void* pages, std::size_t bytes, unsigned memory_node) noexcept {
+            constexpr int mpol_preferred = 1;   // MPOL_PREFERRED in <linux/mempolicy.h>
+            constexpr std::size_t mask_bits = 1024;
+            if (memory_node >= mask_bits) return;
+            std::array<unsigned long, mask_bits / (8 * sizeof(unsigned long))> mask{};
+            mask[memory_node / (8 * sizeof(unsigned long))] = 1UL << (memory_node % (8 * sizeof(unsigned long)));
+            syscall(SYS_mbind, pages, round_to_pages(bytes), mpol_preferred, mask.data(), mask_bits + 1, 0);
+        }
+
+        // One shard's allocator state. Single objects up to max_block bytes come from a free list
+        // per 16-byte size class, carved out of 64 KiB slabs; arrays and larger objects go to
+        // operator new. Freed nodes go back on their list, so churn never reaches the global heap,
+        // and slabs are only returned when the pool is destroyed. Not thread-safe: the shard's
+        // exclusive lock serialises every call. The counters are atomics only so that memory()
+        // may sum them without the lock.
+        class SlabPool {
+        public:
+            static constexpr std::size_t granule = 16;
+            static constexpr std::size_t max_block = 512;
+            static constexpr std::size_t slab_bytes = 64 * 1024;
+
+            SlabPool() = default;
+            SlabPool(const SlabPool&) = delete;
+            SlabPool& operator=(const SlabPool&) = delete;
+            ~SlabPool() {
+                for (auto* slab : slabs_) {
+                    if (bound()) {
+                        unmap_pages(slab, slab_bytes);
+                    } else {
+                        ::operator delete(slab, std::align_val_t{granule});
+                    }
+                }
+            }
+
+            // Places slabs, and blocks of a page or more, on a NUMA node's memory. Only before
+            // the first allocation; false, and no effect, after it.
+            bool bind(unsigned memory_node) noexcept {
+                if (!slabs_.empty() || table_bytes_.load(std::memory_order_relaxed) != 0) return false;
+                node_ = memory_node;
+                return true;
+            }
+
+            auto allocate(std::size_t bytes, std::size_t align, bool single) -> void* {
+                if (!pooled(bytes, align, single)) {
+                    auto* block = on_node(bytes) ? map_on_node(bytes)
+                                                 : ::operator new(bytes, std::align_val_t{std::max(align, alignof(std::max_align_t))});
+                    add(table_bytes_, bytes);
+                    return block;
+                }
+                const auto size_class = class_of(bytes);
+                const auto block_bytes = (size_class + 1) * granule;
+                void* block = free_[size_class];
+                if (block) {
+                    free_[size_class] = static_cast<FreeBlock*>(block)->next;
+                } else {
+                    if (static_cast<std::size_t>(end_ - cursor_) < block_bytes) refill();
+                    block = cursor_;
+                    cursor_ += block_bytes;
+                }
+                add(node_bytes_, block_bytes);
+                return block;
+            }
+
+            void deallocate(void* block, std::size_t bytes, std::size_t align, bool single) noexcept {
+                if (!pooled(bytes, align, single)) {
+                    if (on_node(bytes)) {
+                        unmap_pages(block, bytes);
+                    } else {
+                        ::operator delete(block, std::align_val_t{std::max(align, alignof(std::max_align_t))});
+                    }
+                    add(table_bytes_, 0 - bytes);
+                    return;
+                }
+                const auto size_class = class_of(bytes);
+                free_[size_class] = new (block) FreeBlock{free_[size_class]};
+                add(node_bytes_, 0 - (size_class + 1) * granule);
+            }
+
+            void add_to(CacheMemory& memory) const noexcept {
+                const auto tables = table_bytes_.load(std::memory_order_relaxed);
+                memory.node_bytes += node_bytes_.load(std::memory_order_relaxed);
+                memory.table_bytes += tables;
+                memory.reserved_bytes += slab_total_.load(std::memory_order_relaxed) + tables;
+            }
+
+        private:
+            struct FreeBlock {
+                FreeBlock* next;
+            };
+
+            static constexpr bool pooled(std::size_t bytes, std::size_t align, bool single) noexcept {
+                return single && bytes <= max_block && align <= granule;
+            }
+
+            static constexpr auto class_of(std::size_t bytes) noexcept -> std::size_t {
+                return bytes == 0 ? 0 : (bytes - 1) / granule;
+            }
+
+            // Single writer under the shard lock: a plain load and store, no read-modify-write
+            static void add(std::atomic<std::size_t>& counter, std::size_t delta) noexcept {
+                counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+            }
+
+            static constexpr unsigned unbound = ~0u;
+
+            bool bound() const noexcept { return node_ != unbound; }
+
+            // Smaller blocks share pages with malloc's other allocations, wherever those are
+            bool on_node(std::size_t bytes) const noexcept { return bound() && bytes >= page_size(); }
+
+            auto map_on_node(std::size_t bytes) const -> void* {
+                auto* pages = map_pages(bytes);
+                bind_pages(pages, bytes, node_);
+                return pages;
+            }
+
+            // The rest of the current slab is abandoned; it is under one max_block
+            void refill() {
+                slabs_.reserve(slabs_.size() + 1);
+                auto* slab = static_cast<std::byte*>(bound() ? map_on_node(slab_bytes) : ::operator new(slab_bytes, std::align_val_t{granule}));
+                slabs_.push_back(slab);
+                cursor_ = slab;
+                end_ = slab + slab_bytes;
+                add(slab_total_, slab_bytes);
+            }
+
+            std::array<FreeBlock*, max_block / granule> free_{};
+            std::byte* cursor_ = nullptr;
+            std::byte* end_ = nullptr;
+            std::vector<std::byte*> slabs_;
+            unsigned node_ = unbound;
+            std::atomic<std::size_t> node_bytes_{0};
+            std::atomic<std::size_t> table_bytes_{0};
+            std::atomic<std::size_t> slab_total_{0};
+        };
+    }
+
+    // The bundled allocator for ThreadSafeCache's Allocator parameter: the cache gives each shard
+    // its own SlabPool (resource_type) and builds the shard table's allocator from it, so entry
+    // nodes are recycled within the shard. Only for storage that allocates under the shard lock.
+    template<typename T>
+    class PoolAllocator {
+    public:
+        using value_type = T;
+        using resource_type = cache_detail::SlabPool;
+
+        explicit PoolAllocator(resource_type* pool) noexcept : pool_(pool) {}
+
+        template<typename U>
+        PoolAllocator(const PoolAllocator<U>& other) noexcept : pool_(other.pool_) {}
+
+        auto allocate(std::size_t n) -> T* {
+            if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) throw std::bad_array_new_length{};
+            return static_cast<T*>(pool_->allocate(n * sizeof(T), alignof(T), n == 1));
+        }
+
+        void deallocate(T* pointer, std::size_t n) noexcept { pool_->deallocate(pointer, n * sizeof(T), alignof(T), n == 1); }
+
+        template<typename U>
+        bool operator==(const PoolAllocator<U>& other) const noexcept { return pool_ == other.pool_; }
+
+    private:
+        template<typename>
+        friend class PoolAllocator;
+
+        resource_type* pool_;
+    };
@@ -0,0 +1,142 @@
+    #pragma once
+
+    #include <atomic>
+    #include <cstddef>
+    #include <cstdint>
+    #include <functional>
+    #include <optional>
+    #include <thread>
+    #include <utility>
+    #include <vector>
+
+    // Why an entry left the cache's memory, as reported to a removal listener
+    enum class RemovalCause : std::uint8_t {
+        erased,     // erase() or clear()
+        replaced,   // put(), a load or a refresh stored a new value over it
+        evicted,    // made room under max_entries or max_weight (spilled, with a disk tier)
+        expired,    // its TTL ran out
+    };
+
+    namespace cache_detail {
+        // Vyukov's unbounded MPSC queue. push() is one exchange plus one store, from any thread;
+        // pop() belongs to a single consumer. The tail is always a node whose value was taken.
+        template<typename T>
+        class MpscQueue {
+            struct Node {
+                std::atomic<Node*> next{nullptr};
+                std::optional<T> value;
+            };
+
+        public:
+            MpscQueue() = default;
+            MpscQueue(const MpscQueue&) = delete;
+            MpscQueue& operator=(const MpscQueue&) = delete;
+            ~MpscQueue() {
+                while (pop()) {
+                }
+                if (tail_ != &stub_) delete tail_;
+            }
+
+            void push(T value) {
+                auto* node = new Node;
+                node->value.emplace(std::move(value));
+                auto* previous = head_.exchange(node, std::memory_order_acq_rel);
+                // Until this store a consumer sees the queue end at previous
+                previous->next.store(node, std::memory_order_seq_cst);
+            }
+
+            auto pop() -> std::optional<T> {
+                auto* next = tail_->next.load(std::memory_order_acquire);
+                if (!next) return std::nullopt;
+                std::optional<T> value{std::move(*next->value)};   // pushed nodes always hold one
+                next->value.reset();
+                if (tail_ != &stub_) delete tail_;
+                tail_ = next;
+                return value;
+            }
+
+            bool empty() const noexcept { return tail_->next.load(std::memory_order_seq_cst) == nullptr; }
+
+        private:
+            Node stub_;
+            std::atomic<Node*> head_{&stub_};
+            Node* tail_ = &stub_;   // consumer only
+        };
+
+        // Hands removed entries to the listener on a dedicated thread. Writers push a copy of the
+        // entry while they hold the shard lock and only wake the thread if it is asleep; the
+        // thread takes up to batch_size events at a time and runs the listener with no lock
+        // held. The destructor delivers what is still queued before joining.
+        template<typename Key, typename Traits>
+        class RemovalDispatcher {
+        public:
+            using Listener = std::function<void(const Key&, const typename Traits::View&, RemovalCause)>;
+
+            explicit RemovalDispatcher(Listener listener) : listener_(std::move(listener)) {
+                worker_ = std::thread{[this] { run(); }};
+            }
+            RemovalDispatcher(const RemovalDispatcher&) = delete;
+            RemovalDispatcher& operator=(const RemovalDispatcher&) = delete;
+
+            ~RemovalDispatcher() {
+                stopping_.store(true, std::memory_order_seq_cst);
+                wake();
+                worker_.join();
+            }
+
+            void push(const Key& key, const typename Traits::Stored& value, RemovalCause cause) {
+                queue_.push(Event{key, value, cause});
+                if (idle_.load(std::memory_order_seq_cst)) wake();
+            }
+
+        private:
+            static constexpr std::size_t batch_size = 256;
+
+            struct Event {
+                Key key;
+                typename Traits::Stored value;
+                RemovalCause cause;
+            };
+
+            void wake() {
+                if (idle_.exchange(false, std::memory_order_seq_cst)) idle_.notify_one();
+            }
+
+            void run() {
+                std::vector<Event> batch;
+                batch.reserve(batch_size);
+                for (;;) {
+                    while (batch.size() < batch_size) {
+                        auto event = queue_.pop();
+                        if (!event) break;
+                        batch.push_back(std::move(*event));
+                    }
+                    if (!batch.empty()) {
+                        for (const auto& event : batch) {
+                            try {
+                                listener_(event.key, Traits::view(event.value), event.cause);
+                            } catch (...) {
+                                // A listener's error has nowhere to go; the next event still runs
+                            }
+                        }
+                        batch.clear();
+                        continue;
+                    }
+                    if (stopping_.load(std::memory_order_seq_cst)) return;
+                    // Announce the sleep, then look again: a push either sees idle_ or is seen here
+                    idle_.store(true, std::memory_order_seq_cst);
+                    if (!queue_.empty() || stopping_.load(std::memory_order_seq_cst)) {
+                        idle_.store(false, std::memory_order_relaxed);
+                        continue;
+                    }
+                    idle_.wait(true, std::memory_order_seq_cst);
+                }
+            }
+
+            Listener listener_;
+            MpscQueue<Event> queue_;
+            std::atomic<bool> idle_{false};
+            std::atomic<bool> stopping_{false};
+            std::thread worker_;   // last: started once everything else is set up
+        };
+    }
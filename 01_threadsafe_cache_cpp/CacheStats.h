@@ -0,0 +1,260 @@
+    #pragma once
+
+    #include <algorithm>
+    #include <array>
+    #include <atomic>
+    #include <bit>
+    #include <chrono>
+    #include <cstddef>
+    #include <cstdint>
+    #include <memory>
+    #include <thread>
+    #include <utility>
+
+    // Latency distribution in HDR-style log-linear buckets: exact below 32ns, then 16 buckets per
+    // power of two, so a value is reported within 1/16 (~6%) of itself, up to 2^40ns (~18 min).
+    struct LatencySnapshot {
+        static constexpr unsigned sub_bits = 4;
+        static constexpr std::uint64_t sub_buckets = std::uint64_t{1} << sub_bits;
+        static constexpr unsigned max_bits = 40;
+        static constexpr std::uint64_t max_value = (std::uint64_t{1} << max_bits) - 1;   // larger values are clamped
+
+        static constexpr auto index_of(std::uint64_t ns) noexcept -> std::size_t {
+            ns = std::min(ns, max_value);
+            if (ns < 2 * sub_buckets) return static_cast<std::size_t>(ns);
+            const auto shift = static_cast<unsigned>(std::bit_width(ns)) - sub_bits - 1;   // ns >> shift in [16, 32)
+            return static_cast<std::size_t>((shift + 1) * sub_buckets + ((ns >> shift) - sub_buckets));
+        }
+
+        // Smallest value that lands in bucket index
+        static constexpr auto lowest_of(std::size_t index) noexcept -> std::uint64_t {
+            if (index < 2 * sub_buckets) return index;
+            const auto shift = index / sub_buckets - 1;
+            return (index % sub_buckets + sub_buckets) << shift;
+        }
+
+        static constexpr std::size_t bucket_count = (max_bits - sub_bits + 1) * sub_buckets;
+
+        std::uint64_t count = 0;
+        std::uint64_t total_ns = 0;
+        std::array<std::uint64_t, bucket_count> buckets{};
+
+        auto mean() const noexcept -> std::chrono::nanoseconds {
+            return std::chrono::nanoseconds(count == 0 ? 0 : total_ns / count);
+        }
+
+        // Highest value equivalent to the q-quantile's bucket, as HdrHistogram reports it
+        auto percentile(double q) const noexcept -> std::chrono::nanoseconds {
+            if (count == 0) return std::chrono::nanoseconds(0);
+            const auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(q * static_cast<double>(count) + 0.5));
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i < bucket_count; ++i) {
+                seen += buckets[i];
+                if (seen >= rank) return std::chrono::nanoseconds(highest_of(i));
+            }
+            return std::chrono::nanoseconds(max_value);
+        }
+
+        auto max() const noexcept -> std::chrono::nanoseconds {
+            for (auto i = bucket_count; i-- > 0;) {
+                if (buckets[i] != 0) return std::chrono::nanoseconds(highest_of(i));
+            }
+            return std::chrono::nanoseconds(0);
+        }
+
+    private:
+        static constexpr auto highest_of(std::size_t index) noexcept -> std::uint64_t {
+            return index + 1 < bucket_count ? lowest_of(index + 1) - 1 : max_value;
+        }
+    };
+
+    static_assert(LatencySnapshot::index_of(LatencySnapshot::max_value) + 1 == LatencySnapshot::bucket_count);
+
+    // Totals since the cache was built. Counters are summed from per-thread stripes and per-shard
+    // cells without stopping writers, so a snapshot taken under load is not a single instant.
+    struct CacheStatsSnapshot {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        std::uint64_t loads = 0;             // keys loaded successfully
+        std::uint64_t load_failures = 0;     // keys whose load threw
+        std::uint64_t evictions = 0;         // removed to stay within max_entries / max_weight
+        std::uint64_t expirations = 0;       // reaped by the timing wheel
+        std::uint64_t coalesced_waits = 0;   // misses that waited for another caller's load
+        LatencySnapshot get_latency;         // sampled, see CacheStats
+        LatencySnapshot load_latency;        // one sample per loader call
+
+        auto hit_ratio() const noexcept -> double {
+            const auto lookups = hits + misses;
+            return lookups == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(lookups);
+        }
+    };
+
+    namespace cache_detail {
+        inline auto stats_clock() noexcept -> std::uint64_t {
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        class LatencyHistogram {
+        public:
+            void record(std::uint64_t ns) noexcept {
+                buckets_[LatencySnapshot::index_of(ns)].fetch_add(1, std::memory_order_relaxed);
+                total_.fetch_add(ns, std::memory_order_relaxed);
+            }
+
+            void add_to(LatencySnapshot& snapshot) const noexcept {
+                for (std::size_t i = 0; i < LatencySnapshot::bucket_count; ++i) {
+                    const auto n = buckets_[i].load(std::memory_order_relaxed);
+                    snapshot.buckets[i] += n;
+                    snapshot.count += n;
+                }
+                snapshot.total_ns += total_.load(std::memory_order_relaxed);
+            }
+
+        private:
+            std::array<std::atomic<std::uint64_t>, LatencySnapshot::bucket_count> buckets_{};
+            std::atomic<std::uint64_t> total_{0};
+        };
+
+        // One thread's share of the counters. Threads are spread round-robin over the stripes,
+        // so up to stripe-count threads each write their own cache lines.
+        struct alignas(64) StatsStripe {
+            std::atomic<std::uint64_t> hits{0};
+            std::atomic<std::uint64_t> misses{0};
+            std::atomic<std::uint64_t> loads{0};
+            std::atomic<std::uint64_t> load_failures{0};
+            std::atomic<std::uint64_t> coalesced_waits{0};
+            LatencyHistogram get_latency;
+            LatencyHistogram load_latency;
+        };
+
+        inline auto stripe_seed() noexcept -> std::uint32_t {
+            static std::atomic<std::uint32_t> next{0};
+            thread_local const std::uint32_t seed = next.fetch_add(1, std::memory_order_relaxed);
+            return seed;
+        }
+
+        inline void bump(std::atomic<std::uint64_t>& counter, std::uint64_t n = 1) noexcept {
+            counter.fetch_add(n, std::memory_order_relaxed);
+        }
+
+        // Records into a histogram on stop() or when it goes out of scope; inactive when not sampled
+        class Stopwatch {
+        public:
+            Stopwatch() = default;
+            explicit Stopwatch(LatencyHistogram* into) noexcept : into_(into), start_(stats_clock()) {}
+            Stopwatch(Stopwatch&& other) noexcept : into_(std::exchange(other.into_, nullptr)), start_(other.start_) {}
+            Stopwatch& operator=(Stopwatch&&) = delete;
+            ~Stopwatch() { stop(); }
+
+            void stop() noexcept {
+                if (into_) std::exchange(into_, nullptr)->record(stats_clock() - start_);
+            }
+
+        private:
+            LatencyHistogram* into_ = nullptr;
+            std::uint64_t start_ = 0;
+        };
+
+        class StatsRecorder {
+        public:
+            // Every get_sample_period-th get() on a thread is timed; the clock reads cost more
+            // than the rest of a hit
+            static constexpr std::uint32_t get_sample_period = 16;
+
+            StatsRecorder()
+                : stripe_count_(std::bit_ceil(std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, 64))),
+                  stripes_(std::make_unique<StatsStripe[]>(stripe_count_)) {}
+
+            void hit(std::uint64_t keys = 1) const noexcept { bump(stripe().hits, keys); }
+            void miss(std::uint64_t keys = 1) const noexcept { bump(stripe().misses, keys); }
+            void coalesced() const noexcept { bump(stripe().coalesced_waits); }
+            void loaded(std::uint64_t keys = 1) const noexcept { bump(stripe().loads, keys); }
+            void load_failed(std::uint64_t keys = 1) const noexcept { bump(stripe().load_failures, keys); }
+
+            auto time_get() const noexcept -> Stopwatch {
+                thread_local std::uint32_t countdown = 0;
+                if (countdown-- != 0) return {};
+                countdown = get_sample_period - 1;
+                return Stopwatch{&stripe().get_latency};
+            }
+
+            auto time_load() const noexcept -> Stopwatch { return Stopwatch{&stripe().load_latency}; }
+
+            void add_to(CacheStatsSnapshot& snapshot) const noexcept {
+                for (std::size_t i = 0; i < stripe_count_; ++i) {
+                    const auto& stripe = stripes_[i];
+                    snapshot.hits += stripe.hits.load(std::memory_order_relaxed);
+                    snapshot.misses += stripe.misses.load(std::memory_order_relaxed);
+                    snapshot.loads += stripe.loads.load(std::memory_order_relaxed);
+                    snapshot.load_failures += stripe.load_failures.load(std::memory_order_relaxed);
+                    snapshot.coalesced_waits += stripe.coalesced_waits.load(std::memory_order_relaxed);
+                    stripe.get_latency.add_to(snapshot.get_latency);
+                    stripe.load_latency.add_to(snapshot.load_latency);
+                }
+            }
+
+        private:
+            auto stripe() const noexcept -> StatsStripe& { return stripes_[stripe_seed() & (stripe_count_ - 1)]; }
+
+            std::size_t stripe_count_;
+            std::unique_ptr<StatsStripe[]> stripes_;
+        };
+
+        // Written only under the shard's exclusive lock, so a plain store suffices; read by snapshots
+        struct ShardStats {
+            std::atomic<std::uint64_t> evictions{0};
+            std::atomic<std::uint64_t> expirations{0};
+
+            void evicted() noexcept { increment(evictions); }
+            void expired() noexcept { increment(expirations); }
+
+            void add_to(CacheStatsSnapshot& snapshot) const noexcept {
+                snapshot.evictions += evictions.load(std::memory_order_relaxed);
+                snapshot.expirations += expirations.load(std::memory_order_relaxed);
+            }
+
+        private:
+            static void increment(std::atomic<std::uint64_t>& counter) noexcept {
+                counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+        };
+
+        // Stand-ins with the same calls, all empty: with NoStats every call site compiles away
+        struct NoStopwatch {
+            void stop() noexcept {}
+        };
+
+        struct NoRecorder {
+            void hit(std::uint64_t = 1) const noexcept {}
+            void miss(std::uint64_t = 1) const noexcept {}
+            void coalesced() const noexcept {}
+            void loaded(std::uint64_t = 1) const noexcept {}
+            void load_failed(std::uint64_t = 1) const noexcept {}
+            auto time_get() const noexcept -> NoStopwatch { return {}; }
+            auto time_load() const noexcept -> NoStopwatch { return {}; }
+        };
+
+        struct NoShardStats {
+            void evicted() noexcept {}
+            void expired() noexcept {}
+        };
+    }
+
+    // Statistics policies for ThreadSafeCache, tag types like the eviction and expiration
+    // policies. Recorder is a cache member, ShardCounters lives in each shard.
+    struct NoStats {
+        static constexpr bool enabled = false;
+
+        using Recorder = cache_detail::NoRecorder;
+        using ShardCounters = cache_detail::NoShardStats;
+    };
+
+    // Hit/miss/load counters striped per thread, eviction counters per shard, and latency
+    // histograms for get() (sampled 1 in 16 per thread) and for every loader call
+    struct CacheStats {
+        static constexpr bool enabled = true;
+
+        using Recorder = cache_detail::StatsRecorder;
+        using ShardCounters = cache_detail::ShardStats;
+    };
@@ -0,0 +1,462 @@
+    #pragma once
+
+    #include <algorithm>
+    #include <atomic>
+    #include <bit>
+    #include <concepts>
+    #include <cstddef>
+    #include <cstdint>
+    #include <functional>
+    #include <memory>
+    #include <new>
+    #include <stdexcept>
+    #include <unordered_map>
+    #include <utility>
+    #include <vector>
+
+    #include "CacheHash.h"
+    #include "EpochReclamation.h"
+
+    // Storage backends for one ThreadSafeCache shard. Each backend is a tag type whose nested
+    // Table<Key, Mapped> maps keys to entries; the caller hashes the key once and passes the
+    // hash down. Pointers returned by find/try_emplace are only valid until the next mutation.
+    // Backends with lock_free_reads allow find() concurrently with the (serialised) writers.
+    // Backends that are allocator_aware take the cache's Allocator as Table's third argument,
+    // rebind it to their nodes and only allocate under the shard's exclusive lock; the others
+    // accept only std::allocator<std::byte>.
+
+    // Node-based std::unordered_map: stable addresses, one allocation per entry
+    struct NodeStorage {
+        static constexpr bool lock_free_reads = false;
+        static constexpr bool allocator_aware = true;
+
+        template<typename Key, typename Mapped, typename Alloc = std::allocator<std::byte>>
+        class Table {
+            using NodeAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<std::pair<const Key, Mapped>>;
+
+        public:
+            Table() = default;
+            explicit Table(const Alloc& alloc) : map_(0, CacheHash<Key>{}, std::equal_to<>{}, NodeAlloc(alloc)) {}
+
+            template<typename Q>
+            auto find(const Q& key, std::size_t) -> Mapped* {
+                auto it = map_.find(key);
+                return it == map_.end() ? nullptr : &it->second;
+            }
+
+            template<typename Q>
+            auto find(const Q& key, std::size_t) const -> const Mapped* {
+                auto it = map_.find(key);
+                return it == map_.end() ? nullptr : &it->second;
+            }
+
+            auto try_emplace(const Key& key, std::size_t, Mapped&& mapped) -> std::pair<Mapped*, bool> {
+                auto [it, inserted] = map_.try_emplace(key, std::move(mapped));
+                return {&it->second, inserted};
+            }
+
+            // Replaces the mapped value of a present key
+            auto assign(const Key& key, std::size_t hash, Mapped&& mapped) -> Mapped* {
+                auto* current = find(key, hash);
+                *current = std::move(mapped);
+                return current;
+            }
+
+            template<typename Q>
+            bool erase(const Q& key, std::size_t) {
+                auto it = map_.find(key);
+                if (it == map_.end()) return false;
+                map_.erase(it);
+                return true;
+            }
+
+            void clear() { map_.clear(); }
+
+            auto size() const noexcept -> std::size_t { return map_.size(); }
+
+            template<typename Fn>
+            void for_each(Fn&& fn) const {
+                for (const auto& [key, mapped] : map_) fn(key, mapped);
+            }
+
+        private:
+            std::unordered_map<Key, Mapped, CacheHash<Key>, std::equal_to<>, NodeAlloc> map_;
+        };
+    };
+
+    // Open addressing with Robin Hood probing and backward-shift deletion. Keys and entries
+    // live inline in one flat array next to a byte of probe distance per slot, so a lookup
+    // touches one or two cache lines and never chases a node pointer. Growth doubles at 7/8
+    // load; a run of more than 254 colliding hashes is rejected with std::length_error.
+    struct FlatStorage {
+        static constexpr bool lock_free_reads = false;
+        static constexpr bool allocator_aware = false;   // two flat arrays per table, nothing to pool
+
+        template<typename Key, typename Mapped, typename Alloc = std::allocator<std::byte>>
+        class Table {
+            static_assert(std::same_as<Alloc, std::allocator<std::byte>>, "FlatStorage takes no allocator");
+
+        public:
+            Table() = default;
+            Table(const Table&) = delete;
+            Table& operator=(const Table&) = delete;
+            ~Table() { destroy_all(); }
+
+            template<typename Q>
+            auto find(const Q& key, std::size_t hash) -> Mapped* {
+                const auto index = locate(key, hash);
+                return index == npos ? nullptr : &slots_[index].value.second;
+            }
+
+            template<typename Q>
+            auto find(const Q& key, std::size_t hash) const -> const Mapped* {
+                return const_cast<Table*>(this)->find(key, hash);
+            }
+
+            auto try_emplace(const Key& key, std::size_t hash, Mapped&& mapped) -> std::pair<Mapped*, bool> {
+                if (auto index = locate(key, hash); index != npos) return {&slots_[index].value.second, false};
+                if (size_ + 1 > capacity_ - capacity_ / 8) grow();
+
+                // Robin Hood: the incoming element takes over any slot whose occupant is closer to home
+                Element carry{key, std::move(mapped)};
+                auto index = home(hash);
+                std::uint8_t distance = 1;
+                std::size_t placed = npos;
+                for (;;) {
+                    if (distance_[index] == 0) {
+                        std::construct_at(&slots_[index].value, std::move(carry));
+                        distance_[index] = distance;
+                        if (placed == npos) placed = index;
+                        break;
+                    }
+                    if (distance_[index] < distance) {
+                        std::swap(carry, slots_[index].value);
+                        std::swap(distance, distance_[index]);
+                        if (placed == npos) placed = index;
+                    }
+                    index = (index + 1) & mask_;
+                    if (++distance == max_distance) {
+                        // Pathological clustering: rehash bigger and retry with the displaced element
+                        grow();
+                        insert_displaced(std::move(carry));
+                        return {find(key, hash), true};
+                    }
+                }
+                ++size_;
+                return {&slots_[placed].value.second, true};
+            }
+
+            auto assign(const Key& key, std::size_t hash, Mapped&& mapped) -> Mapped* {
+                auto* current = find(key, hash);
+                *current = std::move(mapped);
+                return current;
+            }
+
+            template<typename Q>
+            bool erase(const Q& key, std::size_t hash) {
+                auto index = locate(key, hash);
+                if (index == npos) return false;
+                std::destroy_at(&slots_[index].value);
+                // Backward shift: pull the following run one step closer to home, no tombstones
+                for (auto next = (index + 1) & mask_; distance_[next] > 1; next = (next + 1) & mask_) {
+                    std::construct_at(&slots_[index].value, std::move(slots_[next].value));
+                    std::destroy_at(&slots_[next].value);
+                    distance_[index] = static_cast<std::uint8_t>(distance_[next] - 1);
+                    index = next;
+                }
+                distance_[index] = 0;
+                --size_;
+                return true;
+            }
+
+            void clear() {
+                for (std::size_t i = 0; i < capacity_; ++i) {
+                    if (distance_[i] != 0) std::destroy_at(&slots_[i].value);
+                    distance_[i] = 0;
+                }
+                size_ = 0;
+            }
+
+            auto size() const noexcept -> std::size_t { return size_; }
+
+            template<typename Fn>
+            void for_each(Fn&& fn) const {
+                for (std::size_t i = 0; i < capacity_; ++i) {
+                    if (distance_[i] != 0) fn(slots_[i].value.first, slots_[i].value.second);
+                }
+            }
+
+        private:
+            using Element = std::pair<Key, Mapped>;
+
+            // Raw storage: only slots with a non-zero distance hold a live Element
+            union Slot {
+                Slot() noexcept {}
+                ~Slot() {}
+                Element value;
+            };
+
+            static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+            static constexpr std::uint8_t max_distance = 0xff;
+            static constexpr std::size_t min_capacity = 16;
+
+            // Fibonacci hashing: the high bits of hash * 2^64/phi pick the home slot
+            auto home(std::size_t hash) const noexcept -> std::size_t {
+                return static_cast<std::size_t>((hash * 0x9e3779b97f4a7c15ULL) >> shift_);
+            }
+
+            template<typename Q>
+            auto locate(const Q& key, std::size_t hash) const -> std::size_t {
+                if (capacity_ == 0) return npos;
+                auto index = home(hash);
+                // An occupant nearer its home than we are to ours ends the search
+                for (std::uint8_t distance = 1; distance_[index] >= distance; ++distance) {
+                    if (distance_[index] == distance && slots_[index].value.first == key) return index;
+                    index = (index + 1) & mask_;
+                }
+                return npos;
+            }
+
+            void insert_displaced(Element&& element) {
+                const auto hash = CacheHash<Key>{}(element.first);
+                auto index = home(hash);
+                std::uint8_t distance = 1;
+                for (;; index = (index + 1) & mask_) {
+                    if (distance_[index] == 0) {
+                        std::construct_at(&slots_[index].value, std::move(element));
+                        distance_[index] = distance;
+                        ++size_;
+                        return;
+                    }
+                    if (distance_[index] < distance) {
+                        std::swap(element, slots_[index].value);
+                        std::swap(distance, distance_[index]);
+                    }
+                    if (++distance == max_distance) throw std::length_error("FlatStorage: probe run too long, degenerate hash?");
+                }
+            }
+
+            void grow() {
+                const auto old_capacity = capacity_;
+                auto old_slots = std::move(slots_);
+                auto old_distance = std::move(distance_);
+
+                capacity_ = std::max(min_capacity, old_capacity * 2);
+                mask_ = capacity_ - 1;
+                shift_ = 64 - std::countr_zero(capacity_);
+                slots_ = std::make_unique<Slot[]>(capacity_);
+                distance_ = std::make_unique<std::uint8_t[]>(capacity_);   // value-initialised: all empty
+                size_ = 0;
+
+                for (std::size_t i = 0; i < old_capacity; ++i) {
+                    if (old_distance[i] == 0) continue;
+                    insert_displaced(std::move(old_slots[i].value));
+                    std::destroy_at(&old_slots[i].value);
+                }
+            }
+
+            void destroy_all() {
+                for (std::size_t i = 0; i < capacity_; ++i) {
+                    if (distance_[i] != 0) std::destroy_at(&slots_[i].value);
+                }
+            }
+
+            std::unique_ptr<Slot[]> slots_;
+            std::unique_ptr<std::uint8_t[]> distance_;
+            std::size_t capacity_ = 0;
+            std::size_t mask_ = 0;
+            unsigned shift_ = 64;
+            std::size_t size_ = 0;
+        };
+    };
+
+    // Chained hash table whose readers take no lock and perform no read-modify-write. Nodes are
+    // immutable once published: writers (already serialised by the shard lock) link new nodes
+    // with release stores, replace rather than mutate on assign, and retire unlinked nodes and
+    // bucket arrays through epoch-based reclamation. Readers must hold a cache_detail::EpochGuard
+    // across find() and for as long as they use the returned pointer. Growth re-links the same
+    // nodes into a fresh bucket array, so a reader's updates to the atomics of an entry it holds
+    // survive the resize. Every chain ends in a marker naming its table and bucket; a reader that
+    // a re-link diverts into the new table ends on a marker it did not start from and looks
+    // again, so it never misses a key that was not being written.
+    struct ConcurrentStorage {
+        static constexpr bool lock_free_reads = true;
+        static constexpr bool allocator_aware = false;   // nodes are freed by whichever thread reclaims them
+
+        template<typename Key, typename Mapped, typename Alloc = std::allocator<std::byte>>
+        class Table {
+            static_assert(std::same_as<Alloc, std::allocator<std::byte>>, "ConcurrentStorage takes no allocator");
+
+        public:
+            Table() : buckets_(new Buckets(min_buckets)) {}
+            Table(const Table&) = delete;
+            Table& operator=(const Table&) = delete;
+
+            ~Table() {
+                auto* buckets = buckets_.load(std::memory_order_relaxed);
+                free_nodes(*buckets);
+                delete buckets;
+            }
+
+            template<typename Q>
+            auto find(const Q& key, std::size_t hash) const -> const Mapped* {
+                for (;;) {
+                    const auto* buckets = buckets_.load(std::memory_order_acquire);
+                    const auto index = buckets->index(hash);
+                    auto* node = buckets->heads[index].load(std::memory_order_acquire);
+                    for (; !is_end(node); node = node->next.load(std::memory_order_acquire)) {
+                        if (node->hash == hash && node->key == key) return &node->mapped;
+                    }
+                    if (node == buckets->end(index)) return nullptr;
+                }
+            }
+
+            // Writer side only. Callers must not write through the pointer while readers can
+            // see it, other than to std::atomic members of Mapped.
+            template<typename Q>
+            auto find(const Q& key, std::size_t hash) -> Mapped* {
+                return const_cast<Mapped*>(std::as_const(*this).find(key, hash));
+            }
+
+            auto try_emplace(const Key& key, std::size_t hash, Mapped&& mapped) -> std::pair<Mapped*, bool> {
+                if (auto* present = find(key, hash)) return {present, false};
+                if (size_ >= max_load * buckets_.load(std::memory_order_relaxed)->count) grow();
+                auto& head = buckets_.load(std::memory_order_relaxed)->head(hash);
+                auto* node = new Node{hash, head.load(std::memory_order_relaxed), key, std::move(mapped)};
+                head.store(node, std::memory_order_release);
+                ++size_;
+                return {&node->mapped, true};
+            }
+
+            // Publishes a replacement node in place of the old one, which is retired
+            auto assign(const Key& key, std::size_t hash, Mapped&& mapped) -> Mapped* {
+                auto* link = link_to(key, hash);
+                auto* old = link->load(std::memory_order_relaxed);
+                auto* node = new Node{hash, old->next.load(std::memory_order_relaxed), key, std::move(mapped)};
+                link->store(node, std::memory_order_release);
+                retired_.retire(old);
+                return &node->mapped;
+            }
+
+            template<typename Q>
+            bool erase(const Q& key, std::size_t hash) {
+                auto* link = link_to(key, hash);
+                if (!link) return false;
+                auto* node = link->load(std::memory_order_relaxed);
+                link->store(node->next.load(std::memory_order_relaxed), std::memory_order_release);
+                retired_.retire(node);
+                --size_;
+                return true;
+            }
+
+            void clear() {
+                auto* old = buckets_.exchange(new Buckets(min_buckets), std::memory_order_acq_rel);
+                retired_.retire(new Generation{old});
+                retired_.collect();
+                size_ = 0;
+            }
+
+            auto size() const noexcept -> std::size_t { return size_; }
+
+            template<typename Fn>
+            void for_each(Fn&& fn) const {
+                const auto* buckets = buckets_.load(std::memory_order_acquire);
+                for (std::size_t i = 0; i < buckets->count; ++i) {
+                    for (auto* node = buckets->heads[i].load(std::memory_order_acquire); !is_end(node);
+                         node = node->next.load(std::memory_order_acquire)) {
+                        fn(node->key, node->mapped);
+                    }
+                }
+            }
+
+        private:
+            struct Node {
+                std::size_t hash;
+                std::atomic<Node*> next;
+                Key key;
+                Mapped mapped;
+            };
+
+            struct Buckets {
+                explicit Buckets(std::size_t n) : count(n), heads(std::make_unique<std::atomic<Node*>[]>(n)) {
+                    for (std::size_t i = 0; i < n; ++i) heads[i].store(end(i), std::memory_order_relaxed);
+                }
+
+                // Fibonacci hashing, as in FlatStorage, so shard bits do not bias the bucket
+                auto index(std::size_t hash) const noexcept -> std::size_t {
+                    return (hash * 0x9e3779b97f4a7c15ULL) >> (64 - std::countr_zero(count));
+                }
+
+                auto head(std::size_t hash) const noexcept -> std::atomic<Node*>& { return heads[index(hash)]; }
+
+                // Bucket i's end-of-chain marker: count + i is distinct across the power-of-two
+                // sizes a table grows through, and the low bit tells it from a node
+                auto end(std::size_t i) const noexcept -> Node* {
+                    return reinterpret_cast<Node*>(((count + i) << 1) | 1);
+                }
+
+                std::size_t count;
+                std::unique_ptr<std::atomic<Node*>[]> heads;
+            };
+
+            static bool is_end(const Node* node) noexcept { return reinterpret_cast<std::uintptr_t>(node) & 1; }
+
+            // A whole superseded bucket array with its nodes, retired as one item
+            struct Generation {
+                Buckets* buckets;
+                ~Generation() {
+                    if (!buckets) return;
+                    free_nodes(*buckets);
+                    delete buckets;
+                }
+            };
+
+            static constexpr std::size_t min_buckets = 16;
+            static constexpr std::size_t max_load = 2;
+
+            // The atomic that points at the node for key (a bucket head or a predecessor's next)
+            template<typename Q>
+            auto link_to(const Q& key, std::size_t hash) -> std::atomic<Node*>* {
+                auto* link = &buckets_.load(std::memory_order_relaxed)->head(hash);
+                for (auto* node = link->load(std::memory_order_relaxed); !is_end(node); node = link->load(std::memory_order_relaxed)) {
+                    if (node->hash == hash && node->key == key) return link;
+                    link = &node->next;
+                }
+                return nullptr;
+            }
+
+            // Moves every node onto the front of its chain in a fresh array. The old array keeps
+            // its heads, so readers still reach each moved node; its next now leads into the new
+            // table, whose end markers send them back to look again.
+            void grow() {
+                auto* old = buckets_.load(std::memory_order_relaxed);
+                auto* grown = new Buckets(old->count * 2);
+                for (std::size_t i = 0; i < old->count; ++i) {
+                    for (auto* node = old->heads[i].load(std::memory_order_relaxed); !is_end(node);) {
+                        auto* next = node->next.load(std::memory_order_relaxed);
+                        auto& head = grown->head(node->hash);
+                        node->next.store(head.load(std::memory_order_relaxed), std::memory_order_release);
+                        head.store(node, std::memory_order_relaxed);
+                        node = next;
+                    }
+                }
+                buckets_.store(grown, std::memory_order_release);
+                retired_.retire(old);   // the array alone: its nodes live on in the new one
+                retired_.collect();
+            }
+
+            static void free_nodes(Buckets& buckets) {
+                for (std::size_t i = 0; i < buckets.count; ++i) {
+                    for (auto* node = buckets.heads[i].load(std::memory_order_relaxed); !is_end(node);) {
+                        auto* next = node->next.load(std::memory_order_relaxed);
+                        delete node;
+                        node = next;
+                    }
+                }
+            }
+
+            std::atomic<Buckets*> buckets_;
+            std::size_t size_ = 0;
+            cache_detail::RetireList retired_;
+        };
+    };
@@ -0,0 +1,128 @@
+    #pragma once
+
+    #include <coroutine>
+    #include <exception>
+    #include <optional>
+    #include <semaphore>
+    #include <type_traits>
+    #include <utility>
+
+    namespace cache_detail {
+        // Where a finished task keeps its result until it is taken
+        template<typename T>
+        struct TaskResult {
+            std::optional<T> value;
+
+            template<typename U = T>
+            void return_value(U&& result) { value.emplace(std::forward<U>(result)); }
+            auto take() -> T { return std::move(*value); }
+        };
+
+        template<>
+        struct TaskResult<void> {
+            void return_void() noexcept {}
+            void take() noexcept {}
+        };
+    }
+
+    // Lazy coroutine task for ThreadSafeCache's async API: get_async() returns one, and an async
+    // loader is any callable returning one. Nothing runs until the task is co_awaited; when it
+    // finishes, its awaiter resumes on whatever thread finished it (symmetric transfer, so long
+    // chains of awaits do not grow the stack).
+    template<typename T>
+    class CacheTask {
+    public:
+        struct promise_type : cache_detail::TaskResult<T> {
+            std::exception_ptr error;
+            std::coroutine_handle<> continuation = std::noop_coroutine();
+
+            auto get_return_object() noexcept -> CacheTask {
+                return CacheTask{std::coroutine_handle<promise_type>::from_promise(*this)};
+            }
+            auto initial_suspend() noexcept -> std::suspend_always { return {}; }
+            auto final_suspend() noexcept {
+                struct Resume {
+                    bool await_ready() noexcept { return false; }
+                    auto await_suspend(std::coroutine_handle<promise_type> self) noexcept -> std::coroutine_handle<> {
+                        return self.promise().continuation;
+                    }
+                    void await_resume() noexcept {}
+                };
+                return Resume{};
+            }
+            void unhandled_exception() noexcept { error = std::current_exception(); }
+        };
+
+        CacheTask(CacheTask&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+        CacheTask& operator=(CacheTask other) noexcept {
+            std::swap(handle_, other.handle_);
+            return *this;
+        }
+        ~CacheTask() {
+            if (handle_) handle_.destroy();
+        }
+
+        // Awaiting an rvalue task starts it; the result is moved out
+        auto operator co_await() && noexcept {
+            struct Awaiter {
+                std::coroutine_handle<promise_type> task;
+
+                bool await_ready() noexcept { return false; }
+                auto await_suspend(std::coroutine_handle<> awaiting) noexcept -> std::coroutine_handle<> {
+                    task.promise().continuation = awaiting;
+                    return task;
+                }
+                auto await_resume() -> T {
+                    if (task.promise().error) std::rethrow_exception(task.promise().error);
+                    return task.promise().take();
+                }
+            };
+            return Awaiter{handle_};
+        }
+
+    private:
+        explicit CacheTask(std::coroutine_handle<promise_type> handle) noexcept : handle_(handle) {}
+
+        std::coroutine_handle<promise_type> handle_;
+    };
+
+    namespace cache_detail {
+        // Eagerly started coroutine that nobody awaits; its frame frees itself when it finishes
+        struct Detached {
+            struct promise_type {
+                auto get_return_object() noexcept -> Detached { return {}; }
+                auto initial_suspend() noexcept -> std::suspend_never { return {}; }
+                auto final_suspend() noexcept -> std::suspend_never { return {}; }
+                void return_void() noexcept {}
+                void unhandled_exception() noexcept { std::terminate(); }
+            };
+        };
+
+        // Parameters by value: the frame must not refer to anything in a caller that may be gone
+        template<typename T>
+        auto run_and_signal(CacheTask<T> task, TaskResult<T>* result, std::exception_ptr* error,
+                            std::binary_semaphore* done) -> Detached {
+            try {
+                if constexpr (std::is_void_v<T>) {
+                    co_await std::move(task);
+                } else {
+                    result->return_value(co_await std::move(task));
+                }
+            } catch (...) {
+                *error = std::current_exception();
+            }
+            done->release();
+        }
+    }
+
+    // Runs a task to completion, blocking the calling thread; the bridge from async to sync code
+    template<typename T>
+    auto sync_wait(CacheTask<T> task) -> T {
+        cache_detail::TaskResult<T> result;
+        std::exception_ptr error;
+        std::binary_semaphore done{0};
+        cache_detail::run_and_signal(std::move(task), &result, &error, &done);
+        done.acquire();
+        if (error) std::rethrow_exception(error);
+        return result.take();
+    }
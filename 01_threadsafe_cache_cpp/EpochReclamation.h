@@ -0,0 +1,150 @@
+    #pragma once
+
+    #include <atomic>
+    #include <cstdint>
+    #include <vector>
+
+    // Epoch-based reclamation (Fraser, "Practical lock-freedom") for the lock-free read path.
+    // Readers pin the current epoch with a store to their own cache line and a fence; writers
+    // retire unlinked memory and free it once every pinned reader has moved two epochs on.
+    namespace cache_detail {
+        class EpochDomain {
+        public:
+            static constexpr std::uint64_t idle = ~std::uint64_t{0};
+
+            // One per thread, on its own cache line; only the owning thread writes epoch/depth
+            struct alignas(64) Record {
+                std::atomic<std::uint64_t> epoch{idle};
+                std::atomic<bool> in_use{false};
+                Record* next = nullptr;
+                unsigned depth = 0;
+            };
+
+            static EpochDomain& instance() {
+                static EpochDomain domain;
+                return domain;
+            }
+
+            static Record& local() {
+                thread_local Registration registration{instance()};
+                return *registration.record;
+            }
+
+            // No read-modify-write: a plain store plus a fence that orders it before the reads
+            void pin(Record& record) noexcept {
+                if (record.depth++ != 0) return;
+                record.epoch.store(global_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            }
+
+            void unpin(Record& record) noexcept {
+                if (--record.depth != 0) return;
+                record.epoch.store(idle, std::memory_order_release);
+            }
+
+            auto current() const noexcept -> std::uint64_t { return global_.load(std::memory_order_acquire); }
+
+            // Advances the global epoch if every pinned reader has observed the current one
+            auto try_advance() noexcept -> std::uint64_t {
+                auto epoch = global_.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                for (auto* record = records_.load(std::memory_order_acquire); record; record = record->next) {
+                    // Acquire: a thread that exited pinned nothing since, but its last reads must
+                    // still happen before whatever this advance lets the caller free
+                    if (!record->in_use.load(std::memory_order_acquire)) continue;
+                    const auto pinned = record->epoch.load(std::memory_order_acquire);
+                    if (pinned != idle && pinned != epoch) return epoch;
+                }
+                global_.compare_exchange_strong(epoch, epoch + 1, std::memory_order_acq_rel);
+                return global_.load(std::memory_order_acquire);
+            }
+
+        private:
+            // Claims a free record or links a new one; records are recycled, never freed
+            struct Registration {
+                explicit Registration(EpochDomain& domain) {
+                    for (auto* candidate = domain.records_.load(std::memory_order_acquire); candidate; candidate = candidate->next) {
+                        bool expected = false;
+                        if (candidate->in_use.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+                            record = candidate;
+                            return;
+                        }
+                    }
+                    record = new Record;
+                    record->in_use.store(true, std::memory_order_relaxed);
+                    auto* head = domain.records_.load(std::memory_order_relaxed);
+                    do {
+                        record->next = head;
+                    } while (!domain.records_.compare_exchange_weak(head, record, std::memory_order_release, std::memory_order_relaxed));
+                }
+
+                ~Registration() {
+                    record->epoch.store(idle, std::memory_order_release);
+                    record->in_use.store(false, std::memory_order_release);
+                }
+
+                Record* record = nullptr;
+            };
+
+            std::atomic<std::uint64_t> global_{0};
+            std::atomic<Record*> records_{nullptr};
+        };
+
+        // RAII read-side critical section; memory read inside stays valid until it ends
+        class EpochGuard {
+        public:
+            EpochGuard() noexcept : record_(EpochDomain::local()) { EpochDomain::instance().pin(record_); }
+            ~EpochGuard() { EpochDomain::instance().unpin(record_); }
+            EpochGuard(const EpochGuard&) = delete;
+            EpochGuard& operator=(const EpochGuard&) = delete;
+
+        private:
+            EpochDomain::Record& record_;
+        };
+
+        // Writer-side list of unlinked memory awaiting a grace period. Not thread-safe: each
+        // owner (a shard table) only touches it under its own writer lock.
+        class RetireList {
+        public:
+            RetireList() = default;
+            RetireList(const RetireList&) = delete;
+            RetireList& operator=(const RetireList&) = delete;
+            ~RetireList() { free_all(); }
+
+            // The fence pairs with pin()'s: the unlink is visible to any reader that pins after the
+            // epoch is read, so a reader that can still reach pointer pinned no later than its tag
+            template<typename T>
+            void retire(T* pointer) {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                pending_.push_back({pointer, [](void* p) { delete static_cast<T*>(p); }, EpochDomain::instance().current()});
+                if (pending_.size() % collect_interval == 0) collect();
+            }
+
+            // Frees everything retired at least two epochs ago
+            void collect() {
+                const auto epoch = EpochDomain::instance().try_advance();
+                std::size_t kept = 0;
+                for (auto& item : pending_) {
+                    if (item.epoch + 2 <= epoch) item.deleter(item.pointer); else pending_[kept++] = item;
+                }
+                pending_.resize(kept);
+            }
+
+            // Only safe once no reader can reach this owner any more (owner destruction)
+            void free_all() {
+                for (auto& item : pending_) item.deleter(item.pointer);
+                pending_.clear();
+            }
+
+        private:
+            static constexpr std::size_t collect_interval = 64;
+
+            struct Retired {
+                void* pointer;
+                void (*deleter)(void*);
+                std::uint64_t epoch;
+            };
+
+            std::vector<Retired> pending_;
+        };
+    }
@@ -1,75 +1,1976 @@
     #pragma once
 
     #include <unordered_map>
+    #include <algorithm>
     #include <mutex>
+    #include <shared_mutex>
     #include <optional>
     #include <functional>
     #include <concepts>
+    #include <atomic>
+    #include <bit>
+    #include <cstddef>
+    #include <cstdint>
+    #include <memory>
+    #include <thread>
+    #include <condition_variable>
+    #include <exception>
+    #include <type_traits>
+    #include <span>
+    #include <vector>
+    #include <ranges>
+    #include <stdexcept>
+    #include <tuple>
+    #include <coroutine>
+    #include <utility>
+
+    #include "CacheDiskTier.h"
+    #include "CacheEviction.h"
+    #include "CacheExecutor.h"
+    #include "CacheExpiry.h"
+    #include "CacheHash.h"
+    #include "CacheHotKeys.h"
+    #include "CacheNear.h"
+    #include "CacheNuma.h"
+    #include "CachePersistence.h"
+    #include "CachePool.h"
+    #include "CacheRemoval.h"
+    #include "CacheStats.h"
+    #include "CacheStorage.h"
+    #include "CacheTask.h"
+    #include "TinyLfu.h"
 
     // C++23 concepts for better type safety
     template<typename K>
-    concept Hashable = requires(K k) { std::hash<K>{}(k); };
+    concept Hashable = requires(const K& k) { { CacheHash<K>{}(k) } -> std::convertible_to<std::size_t>; };
 
     template<typename F, typename K, typename V>
     concept LoaderFunction = std::invocable<F, K> && std::convertible_to<std::invoke_result_t<F, K>, V>;
 
-    template<Hashable Key, typename Value>
+    // LoaderFn of a cache that is only ever put() into: misses stay misses, and without a disk
+    // tier to restore from the shards keep no single-flight state
+    struct NoLoader {
+        constexpr NoLoader(std::nullptr_t = nullptr) noexcept {}
+    };
+
+    namespace cache_detail {
+        // Key and value types read off a loader with exactly one call signature (a function
+        // pointer, or a class with a non-template operator()), for the deduction guides
+        template<typename F>
+        struct LoaderSignature : LoaderSignature<decltype(&F::operator())> {};
+
+        template<typename R, typename A>
+        struct LoaderSignature<R (*)(A)> {
+            using Key = std::remove_cvref_t<A>;
+            using Value = std::remove_cvref_t<R>;
+        };
+
+        template<typename R, typename A>
+        struct LoaderSignature<R (*)(A) noexcept> : LoaderSignature<R (*)(A)> {};
+        template<typename R, typename C, typename A>
+        struct LoaderSignature<R (C::*)(A)> : LoaderSignature<R (*)(A)> {};
+        template<typename R, typename C, typename A>
+        struct LoaderSignature<R (C::*)(A) const> : LoaderSignature<R (*)(A)> {};
+        template<typename R, typename C, typename A>
+        struct LoaderSignature<R (C::*)(A) noexcept> : LoaderSignature<R (*)(A)> {};
+        template<typename R, typename C, typename A>
+        struct LoaderSignature<R (C::*)(A) const noexcept> : LoaderSignature<R (*)(A)> {};
+
+        // What a shard keeps for its Allocator: the allocator's resource_type, if it has one
+        template<typename Allocator>
+        struct PoolResource {
+            using type = Empty;
+        };
+
+        template<typename Allocator>
+            requires requires { typename Allocator::resource_type; }
+        struct PoolResource<Allocator> {
+            using type = typename Allocator::resource_type;
+        };
+
+        template<typename F>
+        concept DeducibleLoader = requires { typename LoaderSignature<F>::Key; typename LoaderSignature<F>::Value; };
+    }
+
+    // Value marker: ThreadSafeCache<Key, SharedValue<T>> stores entries as shared immutable
+    // handles, so get() hands out a std::shared_ptr<const T> instead of copying T.
+    template<typename T>
+    struct SharedValue {};
+
+    namespace cache_detail {
+        // Fixed instead of std::hardware_destructive_interference_size, which is ABI-unstable
+        inline constexpr std::size_t cache_line_size = 64;
+
+        inline std::size_t default_shard_count() noexcept {
+            const auto cores = std::max(1u, std::thread::hardware_concurrency());
+            return std::bit_ceil(static_cast<std::size_t>(cores) * 4);
+        }
+
+        // How a cache Value is stored, produced by a loader and handed back from get()
+        template<typename V>
+        struct ValueTraits {
+            using Stored = V;
+            using Loaded = V;
+            using View = V;
+            using Result = std::optional<V>;
+
+            static auto wrap(auto&& value) -> Stored { return Stored(std::forward<decltype(value)>(value)); }
+            static auto view(const Stored& stored) noexcept -> const View& { return stored; }
+            static auto result(const Stored& stored) -> Result { return stored; }
+            static auto miss() noexcept -> Result { return std::nullopt; }
+
+            template<typename U>
+            static constexpr bool storable = std::convertible_to<std::decay_t<U>, V>;
+        };
+
+        template<typename T>
+        struct ValueTraits<SharedValue<T>> {
+            using Stored = std::shared_ptr<const T>;
+            using Loaded = T;
+            using View = T;
+            using Result = Stored;   // empty on a miss
+
+            // An empty handle would be a present entry with nothing to view, so put and put_all reject it
+            static auto wrap(auto&& value) -> Stored {
+                if constexpr (std::convertible_to<std::decay_t<decltype(value)>, Stored>) {
+                    Stored stored(std::forward<decltype(value)>(value));
+                    if (!stored) throw std::invalid_argument("ThreadSafeCache: cannot store an empty SharedValue handle");
+                    return stored;
+                } else {
+                    return std::make_shared<const T>(std::forward<decltype(value)>(value));
+                }
+            }
+            static auto view(const Stored& stored) noexcept -> const View& { return *stored; }
+            static auto result(const Stored& stored) noexcept -> Result { return stored; }
+            static auto miss() noexcept -> Result { return nullptr; }
+
+            template<typename U>
+            static constexpr bool storable =
+                std::convertible_to<std::decay_t<U>, T> || std::convertible_to<std::decay_t<U>, Stored>;
+        };
+
+        // The (key, value) pair-like element type of a put_all range
+        template<typename R>
+        using range_pair_t = std::remove_cvref_t<std::ranges::range_reference_t<R>>;
+
+        // One in-progress loader call; concurrent misses on the same key wait here for its result.
+        // Threads block in wait(); coroutines park with co_await and are handed to the cache's
+        // WaiterScheduler when the load finishes.
+        template<typename Value>
+        class LoadFlight {
+        public:
+            explicit LoadFlight(WaiterScheduler& waiters) noexcept : waiters_(waiters) {}
+
+            void wait() {
+                std::unique_lock lock{mutex_};
+                ready_.wait(lock, [this] { return done_; });
+            }
+
+            // After wait() or co_await: the value, or the load's error rethrown
+            auto result() const -> const Value& {
+                if (error_) std::rethrow_exception(error_);
+                return *value_;
+            }
+
+            auto operator co_await() noexcept {
+                struct Awaiter {
+                    LoadFlight& flight;
+
+                    bool await_ready() noexcept {
+                        std::lock_guard lock{flight.mutex_};
+                        return flight.done_;
+                    }
+                    // false resumes at once: the load finished in between
+                    bool await_suspend(std::coroutine_handle<> waiter) {
+                        std::lock_guard lock{flight.mutex_};
+                        if (flight.done_) return false;
+                        flight.parked_.push_back(waiter);
+                        return true;
+                    }
+                    void await_resume() noexcept {}
+                };
+                return Awaiter{*this};
+            }
+
+            void complete(const Value& value) {
+                finish([&] { value_.emplace(value); });
+            }
+
+            void fail(std::exception_ptr error) {
+                finish([&] { error_ = std::move(error); });
+            }
+
+            // Ends a loader-less restore that found no spilled copy: waiters get a miss
+            void complete_missing() {
+                finish([] {});
+            }
+
+            // After wait() or co_await: whether complete_missing() ended the flight
+            bool missing() const noexcept { return !value_ && !error_; }
+
+            // Guarded by the owning shard's lock: set when erase/clear races the load
+            bool invalidated = false;
+
+        private:
+            void finish(auto&& set) {
+                std::vector<std::coroutine_handle<>> parked;
+                {
+                    std::lock_guard lock{mutex_};
+                    set();
+                    done_ = true;
+                    parked.swap(parked_);
+                }
+                ready_.notify_all();
+                for (auto waiter : parked) waiters_.resume(waiter);
+            }
+
+            WaiterScheduler& waiters_;
+            std::mutex mutex_;
+            std::condition_variable ready_;
+            bool done_ = false;
+            std::optional<Value> value_;
+            std::exception_ptr error_;
+            std::vector<std::coroutine_handle<>> parked_;
+        };
+    }
+
+    // Runtime knobs, designated-initializer friendly: {.shards = 16, .max_entries = 100'000}
+    struct CacheOptions {
+        std::size_t shards = cache_detail::default_shard_count();  // rounded up to a power of two (per node with NumaShards), at most max_entries
+        std::size_t max_entries = 0;                               // 0 = unbounded; split evenly across shards; needs a bounded Eviction policy
+        std::size_t max_weight = 0;                                // 0 = no weight budget; total of the weigher's weights, split like max_entries; needs a bounded Eviction policy
+        Expiry expiry = {};                                        // for loaded values and plain put(); ignored by NoExpiration
+        // Stale-while-revalidate, both need an Expiration policy. From refresh_after past its write
+        // an entry is still served while one background reload replaces it; if reloads fail, an
+        // expired value keeps being served for serve_stale_for. Zero turns either off.
+        std::chrono::nanoseconds refresh_after{0};
+        std::chrono::nanoseconds serve_stale_for{0};
+        DiskTierOptions disk = {};                                 // for DiskTier; ignored by NoDiskTier
+        NumaTopology numa = {};                                    // for NumaShards; empty = detected from sysfs; ignored by NoNuma
+        // Resumes get_async() callers parked on a load another caller leads, e.g. by posting to a
+        // thread pool; empty = one thread owned by the cache. Never run on the loading thread.
+        std::function<void(std::coroutine_handle<>)> scheduler = {};
+    };
+
+    // Features that would otherwise be switched on at run time, fixed at compile time instead so
+    // a cache that never uses them carries none of their state or checks. The default keeps all.
+    struct CacheFeatures {
+        bool weigher = true;            // a Weigher and CacheOptions::max_weight
+        bool removal_listener = true;   // set_removal_listener()
+        bool batch_loader = true;       // a BatchLoader for get_all() misses
+        bool async_loader = true;       // an AsyncLoader for get_async() misses
+        bool shared_reads = true;       // readers share the shard lock (std::shared_mutex); off, a plain
+                                        // std::mutex, cheaper to take when uncontended
+        bool sharded = true;            // CacheOptions::shards stripes; off, one shard and no hash mixing
+
+        static constexpr auto none() noexcept -> CacheFeatures {
+            return {.weigher = false, .removal_listener = false, .batch_loader = false, .async_loader = false,
+                    .shared_reads = false, .sharded = false};
+        }
+    };
+
+    // Lock-striped cache: each key is homed on one of N independently locked shards.
+    // Eviction selects the policy applied once a shard reaches its share of max_entries;
+    // Storage selects the per-shard table (NodeStorage or the open-addressing FlatStorage);
+    // Expiration selects whether entries carry a TTL (TimerWheelExpiration) or live forever;
+    // Stats selects whether hits, loads and latencies are counted (CacheStats) or not at all;
+    // Tier selects whether evicted entries are dropped or spilled to local disk (DiskTier);
+    // Near selects whether each thread keeps a small lock-free copy of its hot hits (NearCache);
+    // Hot selects whether a sample of lookups feeds a top-K of the most accessed keys (HotKeys);
+    // Features turns off the runtime-configured features a cache does not need (CacheFeatures);
+    // LoaderFn is the loader's type: std::function by default, or the callable itself, stored inline;
+    // Allocator allocates the shard tables' nodes (PoolAllocator recycles them within each shard);
+    // Numa selects whether the shards are grouped per NUMA node, on that node's memory (NumaShards).
+    template<Hashable Key, typename Value, typename Eviction = NoEviction, typename Storage = NodeStorage,
+             typename Expiration = NoExpiration, typename Stats = NoStats, typename Tier = NoDiskTier,
+             typename Near = NoNearCache, typename Hot = NoHotKeys, CacheFeatures Features = CacheFeatures{},
+             typename LoaderFn = std::function<typename cache_detail::ValueTraits<Value>::Loaded(const Key&)>,
+             typename Allocator = std::allocator<std::byte>, typename Numa = NoNuma>
     class ThreadSafeCache {
+        using Traits = cache_detail::ValueTraits<Value>;
+        using Stored = typename Traits::Stored;
+        using Spill = typename Tier::template Store<Key>;
+        using Removals = cache_detail::RemovalDispatcher<Key, Traits>;
+        using Replica = typename Numa::template Replica<Key, Stored>;
+
+        // An allocator with a resource_type gets one resource per shard to allocate from
+        static constexpr bool pooled = requires { typename Allocator::resource_type; };
+
+        static_assert(Storage::allocator_aware || std::same_as<Allocator, std::allocator<std::byte>>,
+                      "Only an allocator-aware Storage (NodeStorage) takes an Allocator");
+
+        static constexpr bool erased_loader = std::same_as<LoaderFn, std::function<typename Traits::Loaded(const Key&)>>;
+        // Misses go through single-flight loads: from a loader, or restoring a spilled entry
+        static constexpr bool flights = !std::same_as<LoaderFn, NoLoader> || Tier::enabled;
+
+        static_assert(!Tier::enabled || (Serializable<Key> && Serializable<typename Traits::View>),
+                      "DiskTier needs a CacheCodec for the key and value types");
+        static_assert(Features.sharded || !Numa::enabled, "NumaShards needs CacheFeatures::sharded");
+
+        // A hit only reads the table: nothing to count, sample, record, refresh or copy
+        static constexpr bool plain_hits = !Stats::enabled && !Hot::enabled && !Eviction::bounded && !Expiration::enabled &&
+                                           !Near::enabled && !Numa::replicated;
+
     public:
-        using Loader = std::function<Value(const Key&)>;
+        // std::optional<Value>, or std::shared_ptr<const T> for SharedValue<T>
+        using Result = typename Traits::Result;
+        // The type-erased loader, LoaderFn's default. Any other LoaderFn is called directly, so a
+        // miss pays no indirect call and the loader may be inlined into get(); a cache built
+        // from a callable with one signature deduces Key, Value and LoaderFn from it.
+        using Loader = std::function<typename Traits::Loaded(const Key&)>;
+        // Fetches many keys in one round-trip; returns one value per key, in the same order
+        using BatchLoader = std::function<std::vector<typename Traits::Loaded>(std::span<const Key>)>;
+        using AsyncLoader = std::function<CacheTask<typename Traits::Loaded>(const Key&)>;
+        // An entry's share of CacheOptions::max_weight, e.g. its size in bytes. Called under the
+        // shard's lock on every insert and removal, so it must be cheap and return the same
+        // weight for the same entry. Without one every entry weighs 1.
+        using Weigher = std::function<std::size_t(const Key&, const typename Traits::View&)>;
+        // The batch loader and weigher parameters; Empty with their CacheFeatures switch off, so
+        // passing one does not compile
+        using BatchLoaderArg = std::conditional_t<Features.batch_loader, BatchLoader, cache_detail::Empty>;
+        using WeigherArg = std::conditional_t<Features.weigher, Weigher, cache_detail::Empty>;
+        // Sees each entry that leaves memory and why; runs on the cache's own listener thread
+        using RemovalListener = typename Removals::Listener;
 
         // C++23 simplified constructor with perfect forwarding
-        explicit ThreadSafeCache(auto&& loader = nullptr)
-            requires LoaderFunction<std::decay_t<decltype(loader)>, Key, Value> || std::same_as<std::decay_t<decltype(loader)>, std::nullptr_t>
-            : loader_(std::forward<decltype(loader)>(loader)) {}
+        explicit ThreadSafeCache(auto&& loader = nullptr, CacheOptions options = {}, WeigherArg weigher = {})
+            requires erased_loader && (LoaderFunction<std::decay_t<decltype(loader)>, Key, typename Traits::Loaded> ||
+                                       std::same_as<std::decay_t<decltype(loader)>, std::nullptr_t>)
+            : ThreadSafeCache(std::forward<decltype(loader)>(loader), BatchLoaderArg{}, options, std::move(weigher)) {}
+
+        explicit ThreadSafeCache(LoaderFn loader, CacheOptions options = {}, WeigherArg weigher = {})
+            requires (!erased_loader) && (LoaderFunction<LoaderFn&, const Key&, typename Traits::Loaded> || std::same_as<LoaderFn, NoLoader>)
+            : ThreadSafeCache(std::move(loader), BatchLoaderArg{}, options, std::move(weigher)) {}
+
+        // An async loader returns a CacheTask, so get_async() misses hold no thread while the
+        // backend works. get() and background refreshes still block a thread on it (sync_wait).
+        explicit ThreadSafeCache(AsyncLoader loader, CacheOptions options = {}, WeigherArg weigher = {})
+            requires erased_loader && (Features.async_loader)
+            : ThreadSafeCache(blocking(loader), BatchLoaderArg{}, options, std::move(weigher)) {
+            async_loader_ = std::move(loader);
+        }
+
+        // With a batch loader, get_all() fetches all of its misses in one call. Without a
+        // single-key loader, get() misses go through the batch loader one key at a time.
+        ThreadSafeCache(LoaderFn loader, BatchLoaderArg batch_loader, CacheOptions options = {}, WeigherArg weigher = {})
+            : numa_(numa_topology(options.numa)),
+              shard_count_(shard_total(options)),
+              shards_(make_shards()),
+              replicas_(make_replicas()),
+              loader_(std::move(loader)),
+              batch_loader_(std::move(batch_loader)),
+              waiters_(std::make_unique<cache_detail::WaiterScheduler>(std::move(options.scheduler))) {
+            if constexpr (erased_loader && Features.batch_loader) {
+                if (!loader_ && batch_loader_) {
+                    loader_ = [batch = batch_loader_](const Key& key) {
+                        auto values = batch(std::span<const Key>(&key, 1));
+                        if (values.size() != 1) throw std::length_error("ThreadSafeCache: batch loader returned the wrong number of values");
+                        return std::move(values.front());
+                    };
+                }
+            }
+            if constexpr (Expiration::enabled) {
+                expiry_ = options.expiry;
+                const auto refresh_after = has_loader() ? cache_detail::to_ns(options.refresh_after) : 0;
+                for (std::size_t i = 0; i < shard_count_; ++i) {
+                    shards_[i].refresh_after = refresh_after;
+                    shards_[i].stale_for = cache_detail::to_ns(options.serve_stale_for);
+                }
+                // A hit on a stale entry retries the load in the background too
+                if (has_loader() && (refresh_after != 0 || options.serve_stale_for.count() > 0)) {
+                    refresher_ = std::make_unique<cache_detail::BackgroundExecutor>();
+                }
+            }
+            if constexpr (Near::enabled) near_owner_ = cache_detail::next_near_owner();
+            if constexpr (Numa::enabled) {
+                // Before any entry is stored: a pool only binds while it is empty
+                for (std::size_t i = 0; i < shard_count_; ++i) {
+                    if constexpr (requires { shards_[i].pool.bind(0u); }) shards_[i].pool.bind(numa_.nodes()[shards_.node_of(i)].memory_node);
+                }
+                if constexpr (Numa::replicated) {
+                    for (std::size_t node = 0; node < numa_.size(); ++node) {
+                        for (std::size_t i = 0; i < shard_count_; ++i) replicas_.at(node, i).bind(numa_.nodes()[node].memory_node);
+                    }
+                }
+            }
+            if constexpr (Tier::enabled) {
+                // Records the store lets go of itself are counted off the filters, or clear them
+                tier_ = std::make_unique<Spill>(options.disk, cache_detail::DiskStoreEvents{
+                    .dropped = [this](std::span<const std::size_t> hashes) {
+                        for (const auto hash : hashes) {
+                            auto& shard = shard_for(hash);
+                            std::lock_guard lock{shard.mutex};
+                            shard.spilled.removed();
+                        }
+                    },
+                    .failed = [this] {
+                        for (std::size_t i = 0; i < shard_count_; ++i) {
+                            std::lock_guard lock{shards_[i].mutex};
+                            shards_[i].spilled.reset();
+                        }
+                    }});
+                for (std::size_t i = 0; i < shard_count_; ++i) shards_[i].tier = tier_.get();
+            }
+            // Shard i's part of a total: the remainder goes one each to the first shards, so the
+            // parts add up to the total. A weight budget under the shard count still gives each
+            // shard 1, since 0 would mean no budget.
+            const auto share = [&](std::size_t total, std::size_t i) -> std::size_t {
+                if (total == 0) return 0;
+                return std::max<std::size_t>(1, total / shard_count_ + (i < total % shard_count_ ? 1 : 0));
+            };
+            if constexpr (!Eviction::bounded) {
+                // NoEviction never evicts, so a bound would silently not hold
+                if (options.max_entries != 0 || options.max_weight != 0) {
+                    throw std::invalid_argument("ThreadSafeCache: max_entries or max_weight needs a bounded Eviction policy");
+                }
+            }
+            if constexpr (!Features.weigher) {
+                if (options.max_weight != 0) {
+                    throw std::invalid_argument("ThreadSafeCache: max_weight needs CacheFeatures::weigher");
+                }
+            }
+            for (std::size_t i = 0; i < shard_count_; ++i) {
+                if constexpr (Features.weigher) {
+                    shards_[i].weigher = weigher;
+                    shards_[i].weight_budget = share(options.max_weight, i);
+                }
+                if (options.max_entries != 0) shards_[i].set_capacity(share(options.max_entries, i));
+            }
+        }
+
+        // Background refreshes and the disk tier's callbacks hold on to this cache, so it stays put
+        ThreadSafeCache(const ThreadSafeCache&) = delete;
+        ThreadSafeCache& operator=(const ThreadSafeCache&) = delete;
+
+        ~ThreadSafeCache() {
+            if constexpr (Expiration::enabled) refresher_.reset();
+        }
 
         // Simplified get with C++23 auto and proper scoping
-        auto get(const Key& key) -> std::optional<Value> {
-            // Try to find in cache first
+        auto get(const Key& key) -> Result { return get<Key>(key); }
+
+        // get, with, contains and erase also take a probe that CacheHash<Key> hashes transparently
+        // (std::string_view or a string literal for std::string keys). It is looked up as is and
+        // turned into a Key only to load.
+        template<typename Q>
+            requires cache_detail::DirectLookup<Q, Key>
+        auto get(const Q& key) -> Result {
+            [[maybe_unused]] auto timing = stats_.time_get();
+            const auto hash = hash_of(key);
+            auto& shard = shard_for(hash);
+            if (auto hit = find_cached(shard, key, hash)) [[likely]] return hit;   // keeps the lookup inlined
+
+            // Load if loader available
+            if (!has_loader() && !Tier::enabled) return Traits::miss();
+            if constexpr (std::same_as<Q, Key>) {
+                return load_missing(shard, key, hash);
+            } else {
+                return load_missing(shard, Key(key), hash);
+            }
+        }
+
+        // get() as a coroutine: a miss parks the caller until the key's single in-flight load
+        // finishes, holding no thread, and resumes through CacheOptions::scheduler. With an async
+        // loader the leader parks on the loader's task too; with a plain loader the leader's
+        // thread runs the loader call. The key is taken by value, so the task may outlive it.
+        auto get_async(Key key) -> CacheTask<Result> {
+            const auto hash = hash_of(key);
+            auto& shard = shard_for(hash);
+            if (auto hit = find_cached(shard, key, hash)) co_return hit;
+
+            // Without a loader only a spilled copy can answer, restored by the key's one flight
+            const bool restore_only = !has_loader();
+            if (restore_only && !may_be_spilled(shard, hash)) co_return Traits::miss();
+            auto joined = join_flight(shard, key, hash);
+            if (!joined.flight) co_return joined.cached;
+            if (!joined.leader) {
+                stats_.coalesced();
+                co_await *joined.flight;
+                co_return flight_result(shard, key, hash, *joined.flight);
+            }
+            if (restore_only) co_return restore_as_leader(shard, key, hash, *joined.flight);
+            if (!has_async_loader()) co_return load_as_leader(shard, key, hash, *joined.flight);
+
+            // As load_as_leader, with the loader call awaited (a catch block cannot co_await)
+            std::optional<Stored> result;
+            std::exception_ptr error;
+            bool restored = false;
+            try {
+                if (auto spilled = restore(shard, key, hash, *joined.flight)) {
+                    result = std::move(spilled);
+                    restored = true;
+                } else {
+                    auto timing = stats_.time_load();
+                    auto loaded = Traits::wrap(co_await call_async_loader(key));
+                    timing.stop();
+                    std::lock_guard lock{shard.mutex};
+                    result.emplace(shard.publish(key, hash, *joined.flight, std::move(loaded), expiry(), clock_now()));
+                }
+            } catch (...) {
+                error = std::current_exception();
+            }
+            if (result) {
+                if (!restored) stats_.loaded();
+                joined.flight->complete(*result);
+                co_return Traits::result(*result);
+            }
+            stats_.load_failed();
             {
-                std::lock_guard lock{mutex_};
-                if (auto it = cache_.find(key); it != cache_.end()) {
-                    return it->second;
+                std::lock_guard lock{shard.mutex};
+                shard.abandon(key, hash, *joined.flight);
+            }
+            joined.flight->fail(error);
+            if (auto stale = serve_stale(shard, key, hash)) co_return stale;
+            std::rethrow_exception(error);
+        }
+
+        // Looks up many keys, taking each shard's read guard once; results are in key order.
+        // Misses go to the batch loader in one call if there is one, else are loaded one by one.
+        auto get_all(std::span<const Key> keys) -> std::vector<Result> {
+            std::vector<Result> results(keys.size(), Traits::miss());
+            if constexpr (Hot::enabled) {
+                for (const auto& key : keys) hot_.sample(key);
+            }
+            const auto lookups = group_by_shard(keys);
+            std::vector<std::size_t> misses;   // indices into lookups
+            std::vector<const Entry*> found;
+            for (std::size_t begin = 0, end; begin < lookups.size(); begin = end) {
+                auto& shard = shards_[lookups[begin].shard];
+                end = run_end(lookups, begin);
+                bool drain_hint = false;
+                std::vector<std::size_t> refresh;
+                const auto missed_before = misses.size();
+                {
+                    auto reading = shard.read_guard();
+                    found.clear();
+                    for (auto i = begin; i < end; ++i) found.push_back(shard.map.find(keys[lookups[i].position], lookups[i].hash));
+                    const auto now = clock_now();   // after the lookups, as in get()
+                    for (auto i = begin; i < end; ++i) {
+                        const auto* entry = found[i - begin];
+                        const auto state = entry ? shard.freshness(*entry, now) : Freshness::expired;
+                        if (state == Freshness::expired) {
+                            drain_hint = drain_hint || entry != nullptr;
+                            misses.push_back(i);
+                            continue;
+                        }
+                        results[lookups[i].position] = Traits::result(entry->value);
+                        drain_hint = shard.record_access(*entry, now) || drain_hint;
+                        if (state != Freshness::fresh && shard.claim_refresh(*entry)) refresh.push_back(i);
+                    }
                 }
+                stats_.hit(end - begin - (misses.size() - missed_before));
+                stats_.miss(misses.size() - missed_before);
+                if (drain_hint) shard.try_maintain(clock_now());
+                for (auto i : refresh) refresh_async(shard, keys[lookups[i].position], lookups[i].hash);
             }
 
-            // Load if loader available
-            if (!loader_) return std::nullopt;
+            if (misses.empty()) return results;
+            if (!has_loader()) {
+                if constexpr (Tier::enabled) {
+                    for (auto i : misses) {
+                        const auto& lookup = lookups[i];
+                        results[lookup.position] = spilled_or_miss(shards_[lookup.shard], keys[lookup.position], lookup.hash);
+                    }
+                }
+                return results;
+            }
+            if constexpr (Features.batch_loader) {
+                if (batch_loader_) {
+                    load_batch(keys, lookups, misses, results);
+                    return results;
+                }
+            }
+            for (auto i : misses) {
+                const auto& lookup = lookups[i];
+                results[lookup.position] = load_missing(shards_[lookup.shard], keys[lookup.position], lookup.hash);
+            }
+            return results;
+        }
+
+        // Zero-copy visitor: runs fn on a const reference to the cached value under the shard's
+        // shared lock (an epoch guard with lock-free storage). Never loads. Returns whether the
+        // key was present, or fn's result if any. fn must not write to this cache.
+        template<typename Fn>
+            requires std::invocable<Fn, const typename Traits::View&>
+        auto with(const Key& key, Fn&& fn) const {
+            return with<Key, Fn>(key, std::forward<Fn>(fn));
+        }
 
-            auto loaded = loader_(key);
-            std::lock_guard lock{mutex_};
-            return cache_.try_emplace(key, loaded).first->second;
+        template<typename Q, typename Fn>
+            requires cache_detail::DirectLookup<Q, Key> && std::invocable<Fn, const typename Traits::View&>
+        auto with(const Q& key, Fn&& fn) const {
+            using R = std::invoke_result_t<Fn, const typename Traits::View&>;
+            hot_.sample(key);
+            const auto hash = hash_of(key);
+            auto& shard = shard_for(hash);
+            std::uint64_t now = 0;
+            bool drain_hint = false;
+            auto visit = [&]() -> std::conditional_t<std::is_void_v<R>, bool, std::optional<R>> {
+                auto reading = shard.read_guard();
+                const auto* entry = shard.map.find(key, hash);
+                if (!entry) {
+                    stats_.miss();
+                    return {};
+                }
+                now = clock_now();
+                if (!shard.servable(*entry, now)) {
+                    stats_.miss();
+                    drain_hint = true;
+                    return {};
+                }
+                stats_.hit();
+                drain_hint = shard.record_access(*entry, now);
+                if constexpr (std::is_void_v<R>) {
+                    std::invoke(std::forward<Fn>(fn), Traits::view(entry->value));
+                    return true;
+                } else {
+                    return std::invoke(std::forward<Fn>(fn), Traits::view(entry->value));
+                }
+            };
+            auto visited = visit();
+            if (drain_hint) shard.try_maintain(now);
+            return visited;
         }
 
         // Simplified methods using C++23 features
-        void put(const Key& key, auto&& value) 
-            requires std::convertible_to<std::decay_t<decltype(value)>, Value> {
-            std::lock_guard lock{mutex_};
-            cache_[key] = std::forward<decltype(value)>(value);
+        void put(const Key& key, auto&& value)
+            requires (Traits::template storable<decltype(value)>) {
+            write(key, Traits::wrap(std::forward<decltype(value)>(value)), expiry());
         }
 
-        bool contains(const Key& key) const {
-            std::lock_guard lock{mutex_};
-            return cache_.contains(key);  // C++20 feature, but simplified
+        // Stores with its own expiry instead of CacheOptions::expiry
+        void put(const Key& key, auto&& value, const Expiry& expiry)
+            requires (Traits::template storable<decltype(value)>) && Expiration::enabled {
+            write(key, Traits::wrap(std::forward<decltype(value)>(value)), expiry);
         }
 
-        bool erase(const Key& key) {
-            std::lock_guard lock{mutex_};
-            return cache_.erase(key) > 0;
+        // Stores every (key, value) pair of the range, taking each shard's lock once; when a
+        // key repeats, the later pair wins
+        template<std::ranges::input_range R>
+            requires (Traits::template storable<std::tuple_element_t<1, cache_detail::range_pair_t<R>>>)
+        void put_all(R&& entries) {
+            write_all(std::forward<R>(entries), expiry());
+        }
+
+        template<std::ranges::input_range R>
+            requires (Traits::template storable<std::tuple_element_t<1, cache_detail::range_pair_t<R>>>) && Expiration::enabled
+        void put_all(R&& entries, const Expiry& expiry) {
+            write_all(std::forward<R>(entries), expiry);
+        }
+
+        // Expired entries that have not been reaped yet are not counted, unless still served stale
+        bool contains(const Key& key) const { return contains<Key>(key); }
+
+        template<typename Q>
+            requires cache_detail::DirectLookup<Q, Key>
+        bool contains(const Q& key) const {
+            const auto hash = hash_of(key);
+            auto& shard = shard_for(hash);
+            auto reading = shard.read_guard();
+            const auto* entry = shard.map.find(key, hash);
+            return entry && shard.servable(*entry, clock_now());
+        }
+
+        bool erase(const Key& key) { return erase<Key>(key); }
+
+        template<typename Q>
+            requires cache_detail::DirectLookup<Q, Key>
+        bool erase(const Q& key) {
+            const auto hash = hash_of(key);
+            auto& shard = shard_for(hash);
+            std::lock_guard lock{shard.mutex};
+            shard.invalidate_inflight(key);
+            const bool removed = shard.remove(key, hash);
+            shard.version.bump();   // even if absent: a thread may still hold a near copy of an evicted entry
+            if constexpr (Tier::enabled) {
+                if (!shard.spilled.may_hold(hash) || !tier_->erase(key, hash)) return removed;
+                shard.spilled.removed();
+                return true;
+            } else {
+                return removed;
+            }
         }
 
         void clear() {
-            std::lock_guard lock{mutex_};
-            cache_.clear();
+            for (std::size_t i = 0; i < shard_count_; ++i) {
+                auto& shard = shards_[i];
+                std::lock_guard lock{shard.mutex};
+                if constexpr (flights) {
+                    for (auto& [pending_key, flight] : shard.inflight) flight->invalidated = true;
+                }
+                shard.remove_all();
+                shard.version.bump();
+                if constexpr (Tier::enabled) shard.spilled.reset();
+            }
+            // After the shards, so nothing they still held is spilled past the clear
+            if constexpr (Tier::enabled) tier_->clear();
         }
 
+        // Sums per-shard counters without locking; exact once writers are quiescent, but may
+        // still count expired entries the timing wheel has not reaped yet
         auto size() const {
-            std::lock_guard lock{mutex_};
-            return cache_.size();
+            std::size_t total = 0;
+            for (std::size_t i = 0; i < shard_count_; ++i) {
+                total += shards_[i].size.load(std::memory_order_relaxed);
+            }
+            return total;
+        }
+
+        // Sum of entry weights (the entry count without a weigher), summed like size()
+        auto weight() const -> std::size_t {
+            if constexpr (Features.weigher) {
+                std::size_t total = 0;
+                for (std::size_t i = 0; i < shard_count_; ++i) {
+                    total += shards_[i].weight.load(std::memory_order_relaxed);
+                }
+                return total;
+            } else {
+                return size();
+            }
+        }
+
+        auto shard_count() const noexcept { return shard_count_; }
+
+        // Entries spilled to disk, and the bytes the log holds for them (dead records included)
+        auto disk_size() const noexcept -> std::size_t
+            requires Tier::enabled {
+            return tier_->entries();
+        }
+
+        auto disk_bytes() const -> std::size_t
+            requires Tier::enabled {
+            return tier_->bytes();
+        }
+
+        // Writes every live entry to path, one shard at a time: each shard is copied into a buffer
+        // under its shared lock, then written out after the lock is released, so a writer waits
+        // for at most one shard's copy. Each shard is a consistent cut; the file as a whole is not
+        // one instant. The file is written beside path and renamed over it when complete.
+        // Returns the number of entries saved.
+        auto save(const std::string& path) const -> std::size_t
+            requires Serializable<Key> && Serializable<typename Traits::View> {
+            using View = typename Traits::View;
+            cache_detail::SnapshotWriter out(path);
+            auto header = cache_detail::SnapshotHeader::describe<Key, View>(Expiration::enabled);
+            std::string buffer;
+            for (std::size_t i = 0; i < shard_count_; ++i) {
+                auto& shard = shards_[i];
+                buffer.clear();
+                {
+                    auto lock = shard.read_lock();   // a real lock even for lock-free storage
+                    const auto now = clock_now();
+                    shard.map.for_each([&](const Key& key, const Entry& entry) {
+                        if (shard.freshness(entry, now) == Freshness::expired) return;
+                        CacheCodec<Key>::write(buffer, key);
+                        CacheCodec<View>::write(buffer, Traits::view(entry.value));
+                        if constexpr (Expiration::enabled) {
+                            // Past its deadline (served stale) counts as due now
+                            const auto deadline = entry.stamp.deadline.load();
+                            const std::uint64_t ttl[2] = {
+                                deadline == cache_detail::never_expires ? deadline : deadline - std::min(deadline, now),
+                                entry.stamp.idle_ttl};
+                            cache_detail::append_bytes(buffer, ttl, sizeof(ttl));
+                        }
+                        ++header.entries;
+                    });
+                }
+                out.append(buffer);
+            }
+            header.saved_at = cache_detail::system_now();
+            out.commit(header);
+            return header.entries;
+        }
+
+        // Warm start from a file written by save(), memory-mapped and inserted in batches that
+        // take each shard's lock once. Keys already cached keep their current value, and the
+        // capacity and weight budgets apply as for put(). Saved TTLs keep counting from the save
+        // (an after-access entry gets its full idle TTL back); entries that expired in between
+        // are skipped, and entries of a file saved without TTLs get CacheOptions::expiry.
+        // Returns the number of entries restored; throws if the file is not a snapshot of
+        // this key and value encoding.
+        auto load(const std::string& path) -> std::size_t
+            requires Serializable<Key> && Serializable<typename Traits::View> {
+            using View = typename Traits::View;
+            constexpr std::size_t batch_size = 4096;
+            const cache_detail::MappedSnapshot file(path);
+            auto in = file.bytes();
+            cache_detail::SnapshotHeader header;
+            cache_detail::take_bytes(in, &header, sizeof(header));
+            header.check(cache_detail::SnapshotHeader::describe<Key, View>(Expiration::enabled));
+            const auto age = static_cast<std::uint64_t>(std::max<std::int64_t>(cache_detail::system_now() - header.saved_at, 0));
+
+            std::vector<PendingWrite> batch;
+            batch.reserve(batch_size);
+            std::size_t restored = 0;
+            for (std::uint64_t i = 0; i < header.entries; ++i) {
+                Key key = CacheCodec<Key>::read(in);
+                auto value = Traits::wrap(CacheCodec<View>::read(in));
+                auto expiry = this->expiry();
+                if (header.has_expiry) {
+                    std::uint64_t ttl[2];
+                    cache_detail::take_bytes(in, ttl, sizeof(ttl));
+                    if (ttl[0] != cache_detail::never_expires && ttl[0] <= age) continue;
+                    if (ttl[0] == cache_detail::never_expires) {
+                        expiry = Expiry{};
+                    } else if (ttl[1] != 0) {
+                        expiry = Expiry::after_access(std::chrono::nanoseconds(ttl[1]));
+                    } else {
+                        expiry = Expiry::after_write(std::chrono::nanoseconds(ttl[0] - age));
+                    }
+                }
+                const auto hash = hash_of(key);
+                batch.push_back({shard_index(hash), hash, std::move(key), std::move(value), expiry});
+                if (batch.size() == batch_size) {
+                    restored += store_grouped(batch, false);
+                    batch.clear();
+                }
+            }
+            restored += store_grouped(batch, false);
+            return restored;
+        }
+
+        // From now on, every entry removed from memory is queued with its cause and handed to
+        // listener on a dedicated thread, in batches, with no cache lock held; the writer that
+        // removed it only pays for the copy. Entries dropped from the disk tier are not reported,
+        // nor are the ones still cached when the cache is destroyed. At most once per cache.
+        void set_removal_listener(RemovalListener listener)
+            requires (Features.removal_listener) {
+            if (removals_) throw std::logic_error("ThreadSafeCache: removal listener already set");
+            removals_ = std::make_unique<Removals>(std::move(listener));
+            for (std::size_t i = 0; i < shard_count_; ++i) {
+                std::lock_guard lock{shards_[i].mutex};
+                shards_[i].removals = removals_.get();
+            }
+        }
+
+        // The k most looked-up keys lately, hottest first, with estimated rates; only with the
+        // HotKeys policy. Sees the calling thread's samples so far; other threads' are handed
+        // over one buffer of 64 at a time, or when the thread exits.
+        auto hot_keys(std::size_t k) const -> std::vector<HotKey<Key>>
+            requires Hot::enabled {
+            return hot_.top(k);
+        }
+
+        // Heap held by the shard tables, from their pools' counters; only with a PoolAllocator.
+        // Exact once writers are quiescent; entry nodes are counted at their pooled block size.
+        auto memory() const -> CacheMemory
+            requires pooled {
+            CacheMemory total;
+            for (std::size_t i = 0; i < shard_count_; ++i) shards_[i].pool.add_to(total);
+            return total;
+        }
+
+        // Bytes an entry carries besides its value: the eviction handle and the expiry stamp.
+        // 0 with NoEviction and NoExpiration, whatever the other policies.
+        static constexpr auto entry_overhead() noexcept -> std::size_t { return sizeof(Entry) - sizeof(Stored); }
+
+        // Counters since construction, summed from their stripes and shards without locking;
+        // only with the CacheStats policy
+        auto stats() const -> CacheStatsSnapshot
+            requires Stats::enabled {
+            CacheStatsSnapshot snapshot;
+            stats_.add_to(snapshot);
+            for (std::size_t i = 0; i < shard_count_; ++i) shards_[i].counters.add_to(snapshot);
+            return snapshot;
         }
 
     private:
-        mutable std::mutex mutex_;
-        std::unordered_map<Key, Value> cache_;
-        Loader loader_;
+        using Flight = cache_detail::LoadFlight<Stored>;
+        using Freshness = cache_detail::Freshness;
+
+        using Policy = typename Eviction::template State<Key>;
+        using Handle = typename Policy::Handle;
+
+        using Stamp = typename Expiration::Stamp;
+
+        struct Entry {
+            Stored value;
+            [[no_unique_address]] Handle handle;
+            [[no_unique_address]] Stamp stamp;
+        };
+
+        // Each shard starts on its own cache line so neighbouring locks never false-share.
+        // Everything below except the read buffer and size is guarded by the exclusive lock.
+        struct alignas(cache_detail::cache_line_size) Shard {
+            mutable std::conditional_t<Features.shared_reads, std::shared_mutex, std::mutex> mutex;
+            // Before the table, so it outlives every node the table frees
+            [[no_unique_address]] typename cache_detail::PoolResource<Allocator>::type pool;
+            typename Storage::template Table<Key, Entry, Allocator> map = make_table();
+            [[no_unique_address]] std::conditional_t<flights, std::unordered_map<Key, std::shared_ptr<Flight>, CacheHash<Key>, std::equal_to<>>,
+                                                     cache_detail::Empty> inflight;
+            std::atomic<std::size_t> size{0};
+            std::size_t capacity = 0;
+            // Weights exist only with CacheFeatures::weigher; otherwise every entry weighs 1
+            [[no_unique_address]] std::conditional_t<Features.weigher, std::atomic<std::size_t>, cache_detail::Empty> weight{};
+            [[no_unique_address]] std::conditional_t<Features.weigher, std::size_t, cache_detail::Empty> weight_budget{};
+            [[no_unique_address]] std::conditional_t<Features.weigher, std::size_t, cache_detail::Empty> weight_used{};
+            [[no_unique_address]] std::conditional_t<Features.weigher, Weigher, cache_detail::Empty> weigher{};
+            [[no_unique_address]] Policy policy;
+            [[no_unique_address]] std::conditional_t<Eviction::bounded, cache_detail::ReadBuffer, cache_detail::Empty> reads;
+            [[no_unique_address]] typename Expiration::template State<Key> timers;
+            [[no_unique_address]] typename Stats::ShardCounters counters;
+            [[no_unique_address]] std::conditional_t<Tier::enabled, Spill*, cache_detail::Empty> tier{};
+            [[no_unique_address]] std::conditional_t<Tier::enabled, cache_detail::SpillFilter, cache_detail::Empty> spilled{};
+            // Bumped by every write that near copies and NUMA replicas must not outlive
+            [[no_unique_address]] std::conditional_t<Near::enabled || Numa::replicated, cache_detail::NearVersion,
+                                                     cache_detail::NoNearVersion> version;
+            [[no_unique_address]] std::conditional_t<Features.removal_listener, Removals*, cache_detail::Empty> removals{};
+            // Whether a weight-only budget has sized the policy yet; see make_room
+            [[no_unique_address]] std::conditional_t<Eviction::bounded && Features.weigher, bool, cache_detail::Empty> policy_sized{};
+            [[no_unique_address]] std::conditional_t<Expiration::enabled, std::uint64_t, cache_detail::Empty> refresh_after{};   // ns; 0 = no refresh-ahead
+            [[no_unique_address]] std::conditional_t<Expiration::enabled, std::uint64_t, cache_detail::Empty> stale_for{};       // ns past the deadline a failed-reload value is still served
+
+            auto make_table() {
+                using Table = typename Storage::template Table<Key, Entry, Allocator>;
+                if constexpr (pooled) {
+                    return Table(Allocator(&pool));
+                } else {
+                    return Table();
+                }
+            }
+
+            void set_capacity(std::size_t entries) {
+                capacity = entries;
+                if constexpr (Eviction::bounded) policy.set_capacity(entries);
+            }
+
+            // Plain stores of values kept under the lock: the hot path has no shared counters
+            void publish_size() noexcept {
+                size.store(map.size(), std::memory_order_relaxed);
+                if constexpr (Features.weigher) weight.store(weight_used, std::memory_order_relaxed);
+            }
+
+            auto weigh([[maybe_unused]] const Key& key, [[maybe_unused]] const Stored& value) const -> std::size_t {
+                if constexpr (Features.weigher) {
+                    return weigher ? weigher(key, Traits::view(value)) : 1;
+                } else {
+                    return 1;
+                }
+            }
+
+            // Exclusive lock held: moves weight_used from `removed` to `added`
+            void reweigh([[maybe_unused]] std::size_t removed, [[maybe_unused]] std::size_t added) noexcept {
+                if constexpr (Features.weigher) weight_used = weight_used - removed + added;
+            }
+
+            // The weigher sees the stored Key; for a probe, the policy's copy when it keeps one
+            template<typename Q>
+            auto weigh_stored(const Q& key, const Entry& entry) const -> std::size_t {
+                if constexpr (std::same_as<Q, Key>) {
+                    return weigh(key, entry.value);
+                } else if constexpr (Eviction::bounded) {
+                    return weigh(policy.key_of(entry.handle), entry.value);
+                } else if constexpr (Features.weigher) {
+                    return weigher ? weigher(Key(key), Traits::view(entry.value)) : 1;
+                } else {
+                    return 1;
+                }
+            }
+
+            // Exclusive lock held: queues a copy of a removed entry for the listener, if there is one
+            template<typename Q>
+            void notify([[maybe_unused]] const Q& key, [[maybe_unused]] const Entry& entry, [[maybe_unused]] RemovalCause cause) {
+                if constexpr (!Features.removal_listener) {
+                    return;
+                } else if (!removals) {
+                    return;
+                } else if constexpr (std::same_as<Q, Key>) {
+                    removals->push(key, entry.value, cause);
+                } else if constexpr (Eviction::bounded) {
+                    removals->push(policy.key_of(entry.handle), entry.value, cause);
+                } else {
+                    removals->push(Key(key), entry.value, cause);
+                }
+            }
+
+            // Read-side critical section: a shared lock, or just an epoch pin for lock-free storage
+            auto read_guard() const {
+                if constexpr (Storage::lock_free_reads) {
+                    return cache_detail::EpochGuard{};
+                } else {
+                    return read_lock();
+                }
+            }
+
+            // The lock readers take; exclusive without CacheFeatures::shared_reads
+            auto read_lock() const {
+                if constexpr (Features.shared_reads) {
+                    return std::shared_lock{mutex};
+                } else {
+                    return std::lock_guard{mutex};
+                }
+            }
+
+            auto freshness([[maybe_unused]] const Entry& entry, [[maybe_unused]] std::uint64_t now) const noexcept -> Freshness {
+                if constexpr (Expiration::enabled) {
+                    return entry.stamp.freshness(now, stale_for);
+                } else {
+                    return Freshness::fresh;
+                }
+            }
+
+            bool servable(const Entry& entry, std::uint64_t now) const noexcept {
+                return freshness(entry, now) != Freshness::expired;
+            }
+
+            bool claim_refresh([[maybe_unused]] const Entry& entry) const noexcept {
+                if constexpr (Expiration::enabled) {
+                    return entry.stamp.claim_refresh();
+                } else {
+                    return false;
+                }
+            }
+
+            // Until when a near copy of a fresh entry may be served: its deadline or refresh time.
+            // After-access entries are not copied, since near hits would not push their deadline out.
+            auto near_until([[maybe_unused]] const Entry& entry) const noexcept -> std::uint64_t {
+                if constexpr (Expiration::enabled) {
+                    return entry.stamp.idle_ttl != 0 ? 0 : std::min(entry.stamp.deadline.load(), entry.stamp.refresh_at);
+                } else {
+                    return cache_detail::never_expires;
+                }
+            }
+
+            // Exclusive lock held: the reload for key failed, so its value may now be served stale
+            void mark_refresh_failed([[maybe_unused]] const Key& key, [[maybe_unused]] std::size_t hash) {
+                if constexpr (Expiration::enabled) {
+                    if (const auto* entry = map.find(key, hash)) entry->stamp.refresh.store(Stamp::refresh_failed);
+                }
+            }
+
+            // Read guard held; returns true when this reader should try to drain the buffer
+            bool record_access(const Entry& entry, [[maybe_unused]] std::uint64_t now) const noexcept {
+                if constexpr (Expiration::enabled) entry.stamp.touch(now);
+                if constexpr (Eviction::bounded) {
+                    return const_cast<cache_detail::ReadBuffer&>(reads).record(entry.handle);
+                } else {
+                    return false;
+                }
+            }
+
+            void drain_reads() {
+                if constexpr (Eviction::bounded) {
+                    reads.drain([this](std::uint32_t handle) { policy.on_access(handle); });
+                }
+            }
+
+            // Opportunistic: a reader never waits for writers just to replay hits or reap
+            void try_maintain(std::uint64_t now) {
+                if (std::unique_lock lock{mutex, std::try_to_lock}) {
+                    drain_reads();
+                    expire(now);
+                }
+            }
+
+            // Advances the timing wheel, removing entries whose deadline (possibly pushed out by
+            // after-access hits since they were scheduled) has passed
+            void expire([[maybe_unused]] std::uint64_t now) {
+                if constexpr (Expiration::enabled) {
+                    bool removed = false;
+                    timers.advance(now, [&](const Key& key) -> std::optional<std::uint64_t> {
+                        const auto hash = hash_of(key);
+                        const auto* entry = map.find(key, hash);
+                        // Kept through the serve-stale window in case a reload fails
+                        const auto until = cache_detail::saturating_add(entry->stamp.deadline.load(), stale_for);
+                        if (until > now) return until;
+                        if (!removed) drain_reads();
+                        removed = true;
+                        if constexpr (Eviction::bounded) policy.on_remove(entry->handle);
+                        reweigh(weigh(key, entry->value), 0);
+                        notify(key, *entry, RemovalCause::expired);
+                        map.erase(key, hash);
+                        counters.expired();
+                        return std::nullopt;
+                    });
+                    if (removed) publish_size();
+                }
+            }
+
+            // Stamp for a new value, reusing (or releasing) the timer of the entry it replaces
+            auto make_stamp(const Key& key, [[maybe_unused]] const Expiry& expiry, [[maybe_unused]] std::uint64_t now,
+                            [[maybe_unused]] const Stamp* replaced) -> Stamp {
+                if constexpr (Expiration::enabled) {
+                    auto stamp = Stamp::make(expiry, now, refresh_after);
+                    const auto timer = replaced ? replaced->timer : cache_detail::no_slot;
+                    const auto deadline = stamp.deadline.load();
+                    if (deadline == cache_detail::never_expires) {
+                        if (timer != cache_detail::no_slot) timers.cancel(timer);
+                    } else if (timer != cache_detail::no_slot) {
+                        timers.reschedule(timer, deadline);
+                        stamp.timer = timer;
+                    } else {
+                        stamp.timer = timers.schedule(key, deadline);
+                    }
+                    return stamp;
+                } else {
+                    return {};
+                }
+            }
+
+            void cancel_timer([[maybe_unused]] const Stamp& stamp) {
+                if constexpr (Expiration::enabled) {
+                    if (stamp.timer != cache_detail::no_slot) timers.cancel(stamp.timer);
+                }
+            }
+
+            // Insert or overwrite; evicts ahead of a new insert so the new entry is never the victim
+            // The returned entry is only valid until the shard is next modified
+            auto store(const Key& key, std::size_t hash, Stored&& value, const Expiry& expiry, std::uint64_t now) -> Entry& {
+                drain_reads();
+                expire(now);
+                if constexpr (Tier::enabled) {
+                    if (spilled.may_hold(hash) && tier->erase(key, hash)) spilled.removed();   // superseded
+                }
+                const auto weight = weigh(key, value);
+                if (const auto* found = map.find(key, hash)) {
+                    const auto replaced = weigh(key, found->value);
+                    if constexpr (Eviction::bounded) {
+                        if (weight > replaced) {
+                            policy.on_access(found->handle);   // so the policy prefers other victims
+                            make_room(0, weight - replaced, &key);
+                        }
+                    }
+                    const auto& entry = *map.find(key, hash);   // evictions may have moved it
+                    notify(key, entry, RemovalCause::replaced);
+                    // Replace rather than assign in place: lock-free readers may be copying it
+                    map.assign(key, hash, Entry{std::move(value), entry.handle, make_stamp(key, expiry, now, &entry.stamp)});
+                    // Found again rather than through assign's pointer, which GCC cannot tell from
+                    // the temporary Entry (-Wreturn-local-addr)
+                    auto& updated = *map.find(key, hash);
+                    if constexpr (Eviction::bounded) policy.on_access(updated.handle);
+                    reweigh(replaced, weight);
+                    publish_size();
+                    version.bump();
+                    return updated;
+                }
+                if constexpr (Eviction::bounded) make_room(1, weight, nullptr);
+                // Handle and timer go in before the entry is published, so readers never see them unset
+                Handle handle{};
+                if constexpr (Eviction::bounded) handle = policy.on_insert(key);
+                Stamp stamp = make_stamp(key, expiry, now, nullptr);
+                try {
+                    auto& entry = *map.try_emplace(key, hash, Entry{std::move(value), handle, stamp}).first;
+                    reweigh(0, weight);
+                    publish_size();
+                    version.bump();
+                    return entry;
+                } catch (...) {
+                    if constexpr (Eviction::bounded) policy.on_remove(handle);
+                    cancel_timer(stamp);
+                    publish_size();   // make_room may have evicted
+                    throw;
+                }
+            }
+
+            template<typename Q>
+            bool remove(const Q& key, std::size_t hash) {
+                const auto* entry = map.find(key, hash);
+                if (!entry) return false;
+                drain_reads();
+                reweigh(weigh_stored(key, *entry), 0);
+                if constexpr (Eviction::bounded) policy.on_remove(entry->handle);
+                cancel_timer(entry->stamp);
+                notify(key, *entry, RemovalCause::erased);
+                map.erase(key, hash);
+                publish_size();
+                return true;
+            }
+
+            void remove_all() {
+                drain_reads();
+                if constexpr (Eviction::bounded) policy.clear();
+                if constexpr (Expiration::enabled) timers.clear();
+                if constexpr (Features.removal_listener) {
+                    if (removals) map.for_each([&](const Key& key, const Entry& entry) { notify(key, entry, RemovalCause::erased); });
+                }
+                map.clear();
+                if constexpr (Features.weigher) weight_used = 0;
+                publish_size();
+            }
+
+            // Evicts until `entries` more entries weighing `weight` fit both budgets. Never evicts
+            // keep, and stops once the shard is empty, so an entry heavier than the whole budget
+            // still goes in, alone.
+            void make_room(std::size_t entries, std::size_t weight, const Key* keep) {
+                for (int spared = 0;;) {
+                    const bool over_count = capacity != 0 && map.size() + entries > capacity;
+                    bool over_weight = false;
+                    if constexpr (Features.weigher) over_weight = weight_budget != 0 && weight_used + weight > weight_budget;
+                    if ((!over_count && !over_weight) || map.size() == 0) return;
+                    // With only a weight budget, size the policy's queues by the entry count
+                    // that first fills it
+                    if constexpr (Features.weigher) {
+                        if (capacity == 0 && !policy_sized) {
+                            policy.set_capacity(map.size());
+                            policy_sized = true;
+                        }
+                    }
+                    const auto victim = policy.victim();
+                    if (keep && policy.key_of(victim) == *keep) {
+                        if (++spared > 2) return;   // over budget until the next write
+                        policy.on_access(victim);
+                        continue;
+                    }
+                    evict(victim);
+                }
+            }
+
+            void evict(Handle victim) {
+                const auto& key = policy.key_of(victim);
+                const auto hash = hash_of(key);
+                if (const auto* entry = map.find(key, hash)) {
+                    spill(key, hash, *entry);
+                    cancel_timer(entry->stamp);
+                    reweigh(weigh(key, entry->value), 0);
+                    notify(key, *entry, RemovalCause::evicted);
+                }
+                map.erase(key, hash);
+                policy.on_evict(victim);
+                counters.evicted();
+            }
+
+            // Exclusive lock held: hands an evicted entry to the disk tier, unless it has expired.
+            // The payload is the value, then with expiration its deadline and idle TTL.
+            void spill([[maybe_unused]] const Key& key, [[maybe_unused]] std::size_t hash, [[maybe_unused]] const Entry& entry) {
+                if constexpr (Tier::enabled) {
+                    using View = typename Traits::View;
+                    thread_local std::string payload;
+                    payload.clear();
+                    CacheCodec<View>::write(payload, Traits::view(entry.value));
+                    if constexpr (Expiration::enabled) {
+                        const std::uint64_t ttl[2] = {entry.stamp.deadline.load(), entry.stamp.idle_ttl};
+                        if (ttl[0] <= clock_now()) return;
+                        cache_detail::append_bytes(payload, ttl, sizeof(ttl));
+                    }
+                    const auto put = tier->put(key, hash, payload);
+                    if (put.stored) spilled.add(hash);
+                    if (put.superseded) spilled.removed();
+                }
+            }
+
+            // A load that overlaps erase/clear still answers its waiters but is not cached
+            template<typename Q>
+            void invalidate_inflight(const Q& key) {
+                if constexpr (flights) {
+                    if (auto it = inflight.find(key); it != inflight.end()) it->second->invalidated = true;
+                }
+            }
+
+            // Exclusive lock held: caches a finished load and retires its flight. A load that
+            // raced erase/clear, or a put since, is handed out but not cached.
+            auto publish(const Key& key, std::size_t hash, const Flight& flight, Stored&& loaded,
+                         const Expiry& expiry, std::uint64_t now) -> Stored {
+                Stored result = [&]() -> Stored {
+                    if (flight.invalidated) return std::move(loaded);
+                    // A concurrent put wins over the loaded value (a refresh replaces an entry
+                    // that is due, never one written since)
+                    if (const auto* entry = map.find(key, hash); entry && freshness(*entry, now) == Freshness::fresh) {
+                        return entry->value;
+                    }
+                    return store(key, hash, std::move(loaded), expiry, now).value;
+                }();
+                retire_flight(key, flight);
+                return result;
+            }
+
+            // Exclusive lock held: retires a failed load's flight
+            void abandon(const Key& key, std::size_t hash, const Flight& flight) {
+                retire_flight(key, flight);
+                mark_refresh_failed(key, hash);
+            }
+
+            // Exclusive lock held: unregisters flight, but never a later load's flight that has
+            // taken its place
+            void retire_flight(const Key& key, const Flight& flight) {
+                if constexpr (flights) {
+                    if (auto it = inflight.find(key); it != inflight.end() && it->second.get() == &flight) inflight.erase(it);
+                }
+            }
+
+            // Exclusive lock held: the key's flight and whether this call started it. Without
+            // flights there is none, and the miss stays a miss.
+            auto join_or_start(const Key& key, cache_detail::WaiterScheduler& waiters) -> std::pair<std::shared_ptr<Flight>, bool> {
+                if constexpr (flights) {
+                    auto [pending, inserted] = inflight.try_emplace(key);
+                    if (inserted) pending->second = std::make_shared<Flight>(waiters);
+                    return {pending->second, inserted};
+                } else {
+                    return {nullptr, false};
+                }
+            }
+        };
+
+        // One key of a bulk call, tagged with its shard so the call can take each lock once
+        struct Lookup {
+            std::size_t hash;
+            std::size_t shard;
+            std::size_t position;   // index into the caller's keys
+        };
+
+        auto group_by_shard(std::span<const Key> keys) const -> std::vector<Lookup> {
+            std::vector<Lookup> lookups(keys.size());
+            for (std::size_t i = 0; i < keys.size(); ++i) {
+                const auto hash = hash_of(keys[i]);
+                lookups[i] = {hash, shard_index(hash), i};
+            }
+            std::sort(lookups.begin(), lookups.end(), [](const Lookup& a, const Lookup& b) {
+                return a.shard != b.shard ? a.shard < b.shard : a.position < b.position;
+            });
+            return lookups;
+        }
+
+        // End of the run of lookups that share lookups[begin]'s shard
+        static auto run_end(const std::vector<Lookup>& lookups, std::size_t begin) -> std::size_t {
+            auto end = begin;
+            while (end < lookups.size() && lookups[end].shard == lookups[begin].shard) ++end;
+            return end;
+        }
+
+        // Registers a single-flight load per distinct missing key (a repeated key shares one),
+        // fetches the keys this call leads with one batch loader call, publishing each shard's
+        // share under one lock, then waits for the keys some other caller was already loading
+        void load_batch(std::span<const Key> keys, const std::vector<Lookup>& lookups,
+                        const std::vector<std::size_t>& misses, std::vector<Result>& results) {
+            struct Pending {
+                const Lookup* lookup;
+                std::shared_ptr<Flight> flight;   // null once answered from the cache
+                bool leader = false;
+            };
+            std::vector<Pending> pending;
+            std::vector<std::pair<std::size_t, std::size_t>> repeats;   // (position, pending index)
+            std::unordered_map<Key, std::size_t> seen;
+            seen.reserve(misses.size());
+
+            for (std::size_t begin = 0, end; begin < misses.size(); begin = end) {
+                auto& shard = shards_[lookups[misses[begin]].shard];
+                for (end = begin; end < misses.size() && lookups[misses[end]].shard == lookups[misses[begin]].shard;) ++end;
+                std::lock_guard lock{shard.mutex};
+                const auto now = clock_now();
+                shard.expire(now);
+                for (auto i = begin; i < end; ++i) {
+                    const auto& lookup = lookups[misses[i]];
+                    const auto& key = keys[lookup.position];
+                    if (auto [it, first] = seen.try_emplace(key, pending.size()); !first) {
+                        repeats.emplace_back(lookup.position, it->second);
+                        continue;
+                    }
+                    auto& item = pending.emplace_back(Pending{&lookup, nullptr, false});
+                    if (const auto* entry = shard.map.find(key, lookup.hash); entry && shard.servable(*entry, now)) {
+                        results[lookup.position] = Traits::result(entry->value);
+                        continue;
+                    }
+                    std::tie(item.flight, item.leader) = shard.join_or_start(key, *waiters_);
+                }
+            }
+
+            std::vector<Pending*> leaders;
+            std::vector<Key> batch;
+            for (auto& item : pending) {
+                if (!item.leader) continue;
+                if constexpr (Tier::enabled) {
+                    // A spilled copy answers without the batch loader; should reading it fail,
+                    // the loader still gets the key
+                    const auto& lookup = *item.lookup;
+                    std::optional<Stored> restored;
+                    try {
+                        restored = restore(shards_[lookup.shard], keys[lookup.position], lookup.hash, *item.flight);
+                    } catch (...) {
+                    }
+                    if (restored) {
+                        item.flight->complete(*restored);
+                        results[lookup.position] = Traits::result(*restored);
+                        item.flight = nullptr;
+                        continue;
+                    }
+                }
+                leaders.push_back(&item);
+                batch.push_back(keys[item.lookup->position]);
+            }
+
+            std::size_t published = 0;   // leaders[0, published) are complete
+            std::vector<Stored> answers;   // for leaders[published, ...), stored but not yet handed out
+            const auto hand_out = [&] {
+                for (std::size_t i = 0; i < answers.size(); ++i, ++published) {
+                    leaders[published]->flight->complete(answers[i]);
+                    results[leaders[published]->lookup->position] = Traits::result(answers[i]);
+                }
+                answers.clear();
+            };
+            try {
+                if (!batch.empty()) {
+                    auto timing = stats_.time_load();
+                    auto loaded = batch_loader_(std::span<const Key>(batch));
+                    timing.stop();
+                    if (loaded.size() != batch.size()) {
+                        throw std::length_error("ThreadSafeCache: batch loader returned the wrong number of values");
+                    }
+                    std::vector<Stored> values;
+                    values.reserve(loaded.size());
+                    for (auto& value : loaded) values.push_back(Traits::wrap(std::move(value)));   // outside the locks
+
+                    for (std::size_t begin = 0, end; begin < leaders.size(); begin = end) {
+                        auto& shard = shards_[leaders[begin]->lookup->shard];
+                        for (end = begin; end < leaders.size() && leaders[end]->lookup->shard == leaders[begin]->lookup->shard;) ++end;
+                        {
+                            std::lock_guard lock{shard.mutex};
+                            const auto now = clock_now();
+                            for (auto i = begin; i < end; ++i) {
+                                const auto& lookup = *leaders[i]->lookup;
+                                answers.push_back(shard.publish(keys[lookup.position], lookup.hash, *leaders[i]->flight,
+                                                                std::move(values[i]), expiry(), now));
+                            }
+                        }
+                        hand_out();
+                    }
+                    stats_.loaded(leaders.size());
+                }
+            } catch (...) {
+                // Fail every flight not yet published; keys inside a serve-stale window still answer
+                const auto error = std::current_exception();
+                hand_out();
+                stats_.loaded(published);
+                stats_.load_failed(leaders.size() - published);
+                bool unanswered = false;
+                for (auto i = published; i < leaders.size(); ++i) {
+                    const auto& lookup = *leaders[i]->lookup;
+                    auto& shard = shards_[lookup.shard];
+                    {
+                        std::lock_guard lock{shard.mutex};
+                        shard.abandon(keys[lookup.position], lookup.hash, *leaders[i]->flight);
+                    }
+                    leaders[i]->flight->fail(error);
+                    results[lookup.position] = serve_stale(shard, keys[lookup.position], lookup.hash);
+                    unanswered = unanswered || !results[lookup.position];
+                }
+                if (unanswered) throw;
+            }
+
+            for (auto& item : pending) {
+                if (!item.flight || item.leader) continue;
+                const auto& lookup = *item.lookup;
+                stats_.coalesced();
+                results[lookup.position] = await_flight(shards_[lookup.shard], keys[lookup.position], lookup.hash, *item.flight);
+            }
+            for (const auto& [position, index] : repeats) results[position] = results[pending[index].lookup->position];
+        }
+
+        // One entry of a bulk write, wrapped and hashed before any lock is taken
+        struct PendingWrite {
+            std::size_t shard;
+            std::size_t hash;
+            Key key;
+            Stored value;
+            Expiry expiry;
+        };
+
+        template<typename R>
+        void write_all(R&& entries, const Expiry& expiry) {
+            std::vector<PendingWrite> pending;
+            if constexpr (std::ranges::sized_range<R>) pending.reserve(std::ranges::size(entries));
+            for (auto&& item : entries) {
+                const auto& key = std::get<0>(item);
+                const auto hash = hash_of(key);
+                pending.push_back({shard_index(hash), hash, Key(key), Traits::wrap(std::get<1>(std::forward<decltype(item)>(item))), expiry});
+            }
+            store_grouped(pending, true);
+        }
+
+        // Stores the writes taking each shard's lock once, in order within a shard; without
+        // overwrite, a key that is already cached keeps its value. Returns how many were stored.
+        auto store_grouped(std::vector<PendingWrite>& pending, bool overwrite) -> std::size_t {
+            std::stable_sort(pending.begin(), pending.end(), [](const PendingWrite& a, const PendingWrite& b) { return a.shard < b.shard; });
+            std::size_t stored = 0;
+            for (std::size_t begin = 0, end; begin < pending.size(); begin = end) {
+                auto& shard = shards_[pending[begin].shard];
+                for (end = begin; end < pending.size() && pending[end].shard == pending[begin].shard;) ++end;
+                std::lock_guard lock{shard.mutex};
+                const auto now = clock_now();
+                for (auto i = begin; i < end; ++i) {
+                    auto& write = pending[i];
+                    if (!overwrite) {
+                        const auto* entry = shard.map.find(write.key, write.hash);
+                        if (entry && shard.servable(*entry, now)) continue;
+                    }
+                    shard.store(write.key, write.hash, std::move(write.value), write.expiry, now);
+                    ++stored;
+                }
+            }
+            return stored;
+        }
+
+        auto await_flight(Shard& shard, const Key& key, std::size_t hash, Flight& flight) -> Result {
+            flight.wait();
+            return flight_result(shard, key, hash, flight);
+        }
+
+        // A waiter shares the leader's error, unless the old value is inside its serve-stale window
+        auto flight_result(Shard& shard, const Key& key, std::size_t hash, const Flight& flight) -> Result {
+            if (flight.missing()) return Traits::miss();
+            try {
+                return Traits::result(flight.result());
+            } catch (...) {
+                if (auto stale = serve_stale(shard, key, hash)) return stale;
+                throw;
+            }
+        }
+
+        // The value is wrapped by the caller, so any allocation happens outside the lock
+        void write(const Key& key, Stored&& stored, const Expiry& expiry) {
+            const auto hash = hash_of(key);
+            auto& shard = shard_for(hash);
+            std::lock_guard lock{shard.mutex};
+            shard.store(key, hash, std::move(stored), expiry, clock_now());
+        }
+
+        // Hit path of get() and get_async(). Readers of the same shard share the lock, or take none
+        // at all with a lock-free storage backend. The clock is read after the lookup, so an
+        // entry found is judged at a time no earlier than when it was written. With plain_hits a
+        // hit is the lookup alone.
+        template<typename Q>
+        auto find_cached(Shard& shard, const Q& key, std::size_t hash) -> Result {
+            if constexpr (plain_hits) {
+                auto reading = shard.read_guard();
+                const auto* entry = shard.map.find(key, hash);
+                return entry ? Traits::result(entry->value) : Traits::miss();
+            }
+            hot_.sample(key);
+            // Read before the lookup, so a write landing after it invalidates the copy made below
+            [[maybe_unused]] const auto version = shard.version.load();
+            if constexpr (Near::enabled) {
+                if (const auto* near = near_table().find(near_owner_, key, hash, version, clock_now())) {
+                    stats_.hit();
+                    return Traits::result(*near);
+                }
+            }
+            // This node's replica of the shard when it is homed on another node, if it is to take copies
+            [[maybe_unused]] Replica* replica = nullptr;
+            if constexpr (Numa::replicated) {
+                const auto index = shard_index(hash);
+                if (const auto node = numa_.current_node(); node != shards_.node_of(index)) {
+                    replica = &replicas_.at(node, index);
+                    Result copied = Traits::miss();
+                    if (replica->read(key, hash, version, clock_now(), [&](const Stored& value) { copied = Traits::result(value); })) {
+                        stats_.hit();
+                        return copied;
+                    }
+                    if (!replica->wants(version)) replica = nullptr;
+                }
+            }
+            Result hit = Traits::miss();
+            std::uint64_t now = 0;
+            bool drain_hint = false;
+            bool refresh = false;
+            {
+                auto reading = shard.read_guard();
+                if (const auto* entry = shard.map.find(key, hash)) {
+                    now = clock_now();
+                    if (const auto state = shard.freshness(*entry, now); state != Freshness::expired) {
+                        hit = Traits::result(entry->value);
+                        drain_hint = shard.record_access(*entry, now);
+                        refresh = state != Freshness::fresh && shard.claim_refresh(*entry);
+                        if constexpr (Near::enabled || Numa::replicated) {
+                            if (const auto until = shard.near_until(*entry); state == Freshness::fresh && until > now) {
+                                if constexpr (Near::enabled) near_table().fill(near_owner_, key, hash, version, until, entry->value);
+                                if constexpr (Numa::replicated) {
+                                    if (replica) replica->fill(key, hash, version, until, entry->value);
+                                }
+                            }
+                        }
+                    } else {
+                        drain_hint = true;   // expired: let the wheel reap it
+                    }
+                }
+            }
+            if (hit) {
+                stats_.hit();
+            } else {
+                stats_.miss();
+            }
+            if (drain_hint) shard.try_maintain(now);
+            if (refresh) {
+                if constexpr (std::same_as<Q, Key>) {
+                    refresh_async(shard, key, hash);
+                } else {
+                    refresh_async(shard, Key(key), hash);
+                }
+            }
+            return hit;
+        }
+
+        // Single-flight: the first miss becomes the leader, later misses wait for its result.
+        // No flight when the entry turned up under the lock; it is in cached instead.
+        struct Joined {
+            Result cached;
+            std::shared_ptr<Flight> flight;
+            bool leader = false;
+        };
+
+        auto join_flight(Shard& shard, const Key& key, std::size_t hash) -> Joined {
+            std::lock_guard lock{shard.mutex};
+            const auto now = clock_now();
+            shard.expire(now);
+            if (const auto* entry = shard.map.find(key, hash); entry && shard.servable(*entry, now)) {
+                return {Traits::result(entry->value), nullptr, false};
+            }
+            auto [flight, inserted] = shard.join_or_start(key, *waiters_);
+            return {Traits::miss(), std::move(flight), inserted};
+        }
+
+        // Miss path of get() once the cache has been checked: leads or joins the key's load
+        auto load_missing(Shard& shard, const Key& key, std::size_t hash) -> Result {
+            if (!has_loader()) return spilled_or_miss(shard, key, hash);
+            auto joined = join_flight(shard, key, hash);
+            if (!joined.flight) return joined.cached;
+            if (!joined.leader) {
+                stats_.coalesced();
+                return await_flight(shard, key, hash, *joined.flight);
+            }
+            return load_as_leader(shard, key, hash, *joined.flight);
+        }
+
+        // Runs the loader outside the shard lock, publishes the result and wakes every waiter.
+        // A throwing loader fails the flight and unregisters it, so the next get retries; if the
+        // old value is inside its serve-stale window it is returned instead of the error.
+        auto load_as_leader(Shard& shard, const Key& key, std::size_t hash, Flight& flight) -> Result {
+            std::optional<Stored> result;
+            bool restored = false;
+            try {
+                if (auto spilled = restore(shard, key, hash, flight)) {
+                    result = std::move(spilled);
+                    restored = true;
+                } else {
+                    auto loaded = call_loader(key);
+                    std::lock_guard lock{shard.mutex};
+                    result.emplace(shard.publish(key, hash, flight, std::move(loaded), expiry(), clock_now()));
+                }
+            } catch (...) {
+                stats_.load_failed();
+                {
+                    std::lock_guard lock{shard.mutex};
+                    shard.abandon(key, hash, flight);
+                }
+                flight.fail(std::current_exception());
+                if (auto stale = serve_stale(shard, key, hash)) return stale;
+                throw;
+            }
+            if (!restored) stats_.loaded();
+            flight.complete(*result);
+            return Traits::result(*result);
+        }
+
+        // Moves key's spilled copy back into memory, publishing it through the key's flight. A
+        // copy that a write replaced while it was being read is read again; none, or an expired
+        // one, leaves the miss to the loader, if there is one.
+        auto restore([[maybe_unused]] Shard& shard, [[maybe_unused]] const Key& key, [[maybe_unused]] std::size_t hash,
+                     [[maybe_unused]] const Flight& flight) -> std::optional<Stored> {
+            if constexpr (Tier::enabled) {
+                using View = typename Traits::View;
+                if (!shard.spilled.may_hold(hash)) return std::nullopt;
+                for (;;) {
+                    auto record = tier_->find(key, hash);
+                    if (!record) return std::nullopt;
+                    std::string_view in = record->payload;
+                    auto value = Traits::wrap(CacheCodec<View>::read(in));
+                    auto expiry = this->expiry();
+                    bool expired = false;
+                    if constexpr (Expiration::enabled) {
+                        std::uint64_t ttl[2];
+                        cache_detail::take_bytes(in, ttl, sizeof(ttl));
+                        const auto now = clock_now();
+                        expired = ttl[0] <= now;
+                        if (ttl[0] == cache_detail::never_expires) {
+                            expiry = Expiry{};
+                        } else if (ttl[1] != 0) {
+                            expiry = Expiry::after_access(std::chrono::nanoseconds(ttl[1]));
+                        } else if (!expired) {
+                            expiry = Expiry::after_write(std::chrono::nanoseconds(ttl[0] - now));
+                        }
+                    }
+                    std::lock_guard lock{shard.mutex};
+                    if (!tier_->take(key, hash, record->at)) continue;
+                    shard.spilled.removed();
+                    if (expired) return std::nullopt;
+                    return shard.publish(key, hash, flight, std::move(value), expiry, clock_now());
+                }
+            } else {
+                return std::nullopt;
+            }
+        }
+
+        // Miss path without a loader: only the disk tier can answer. Misses of a key the shard
+        // may have spilled share one restore through single-flight, as loads do.
+        auto spilled_or_miss(Shard& shard, const Key& key, std::size_t hash) -> Result {
+            if (!may_be_spilled(shard, hash)) return Traits::miss();
+            auto joined = join_flight(shard, key, hash);
+            if (!joined.flight) return joined.cached;
+            if (!joined.leader) {
+                stats_.coalesced();
+                return await_flight(shard, key, hash, *joined.flight);
+            }
+            return restore_as_leader(shard, key, hash, *joined.flight);
+        }
+
+        bool may_be_spilled([[maybe_unused]] const Shard& shard, [[maybe_unused]] std::size_t hash) const noexcept {
+            if constexpr (Tier::enabled) {
+                return shard.spilled.may_hold(hash);
+            } else {
+                return false;
+            }
+        }
+
+        // Leader of a loader-less miss: publishes the spilled copy, or ends the flight as a miss
+        auto restore_as_leader(Shard& shard, const Key& key, std::size_t hash, Flight& flight) -> Result {
+            std::optional<Stored> restored;
+            try {
+                restored = restore(shard, key, hash, flight);
+            } catch (...) {
+                {
+                    std::lock_guard lock{shard.mutex};
+                    shard.abandon(key, hash, flight);
+                }
+                flight.fail(std::current_exception());
+                throw;
+            }
+            if (!restored) {
+                {
+                    std::lock_guard lock{shard.mutex};
+                    shard.retire_flight(key, flight);
+                }
+                flight.complete_missing();
+                return Traits::miss();
+            }
+            flight.complete(*restored);
+            return Traits::result(*restored);
+        }
+
+        auto call_loader(const Key& key) -> Stored {
+            if constexpr (std::same_as<LoaderFn, NoLoader>) {
+                std::unreachable();   // has_loader() is false
+            } else {
+                [[maybe_unused]] auto timing = stats_.time_load();
+                return Traits::wrap(std::invoke(loader_, key));
+            }
+        }
+
+        // Only a type-erased loader or a function pointer can be empty
+        bool has_loader() const noexcept {
+            if constexpr (std::same_as<LoaderFn, NoLoader>) {
+                return false;
+            } else if constexpr (erased_loader || std::is_pointer_v<LoaderFn>) {
+                return static_cast<bool>(loader_);
+            } else {
+                return true;
+            }
+        }
+
+        // Starts one background reload of key through loader_, unless a load is already running;
+        // readers keep getting the current value until it is replaced. Only a stale hit asks for
+        // one, so without an expiration policy there is nothing to run.
+        void refresh_async([[maybe_unused]] Shard& shard, [[maybe_unused]] const Key& key, [[maybe_unused]] std::size_t hash) {
+            if constexpr (Expiration::enabled) {
+                std::shared_ptr<Flight> flight;
+                {
+                    std::lock_guard lock{shard.mutex};
+                    bool inserted = false;
+                    std::tie(flight, inserted) = shard.join_or_start(key, *waiters_);
+                    if (!inserted) return;   // that load replaces the entry or marks it failed
+                }
+                try {
+                    refresher_->submit([this, &shard, key, hash, flight] {
+                        try {
+                            load_as_leader(shard, key, hash, *flight);
+                        } catch (...) {
+                            // Already recorded on the entry and handed to any waiters
+                        }
+                    });
+                } catch (...) {
+                    {
+                        std::lock_guard lock{shard.mutex};
+                        shard.abandon(key, hash, *flight);
+                    }
+                    flight->fail(std::current_exception());
+                }
+            }
+        }
+
+        // After a failed load: the old value, if it is inside its serve-stale window
+        auto serve_stale(Shard& shard, const Key& key, std::size_t hash) const -> Result {
+            if constexpr (Expiration::enabled) {
+                auto reading = shard.read_guard();
+                const auto* entry = shard.map.find(key, hash);
+                if (entry && shard.freshness(*entry, clock_now()) == Freshness::stale) return Traits::result(entry->value);
+            }
+            return Traits::miss();
+        }
+
+        // This thread's near copies, shared by every cache of this type and told apart by owner
+        static auto near_table() -> typename Near::template Table<Key, Stored>& {
+            thread_local typename Near::template Table<Key, Stored> table;
+            return table;
+        }
+
+        // CacheOptions::expiry; never expiring without an expiration policy, which keeps none
+        auto expiry() const noexcept -> Expiry {
+            if constexpr (Expiration::enabled) {
+                return expiry_;
+            } else {
+                return {};
+            }
+        }
+
+        // Read once per operation, and never without an expiration policy
+        static auto clock_now() noexcept -> std::uint64_t {
+            if constexpr (Expiration::enabled) {
+                return cache_detail::steady_now();
+            } else {
+                return 0;
+            }
+        }
+
+        bool has_async_loader() const noexcept {
+            if constexpr (Features.async_loader) {
+                return static_cast<bool>(async_loader_);
+            } else {
+                return false;
+            }
+        }
+
+        // Only reached when has_async_loader()
+        auto call_async_loader(const Key& key) -> CacheTask<typename Traits::Loaded> {
+            if constexpr (Features.async_loader) {
+                return async_loader_(key);
+            } else {
+                std::unreachable();
+            }
+        }
+
+        static auto blocking(const AsyncLoader& loader) -> Loader {
+            if (!loader) return nullptr;
+            return [loader](const Key& key) { return sync_wait(loader(key)); };
+        }
+
+        // Hashed once per operation; the shard table reuses the same hash. A transparent probe
+        // hashes as the Key it compares equal to, so it lands on the same shard and slot.
+        template<typename Q>
+        static auto hash_of(const Q& key) noexcept -> std::size_t { return CacheHash<Key>{}(key); }
+
+        // With NumaShards the high half of the mixed hash picks the home node, by multiply-shift
+        // since the node count need not be a power of two, and the low bits the shard there.
+        // Unsharded, the one shard needs no hash at all.
+        auto shard_index([[maybe_unused]] std::size_t hash) const noexcept -> std::size_t {
+            if constexpr (!Features.sharded) return 0;
+            const auto mixed = cache_detail::mix_hash(hash);
+            if constexpr (Numa::enabled) {
+                const auto node = ((mixed >> 32) * shards_.node_count()) >> 32;
+                return node * shards_.per_node() + (mixed & (shards_.per_node() - 1));
+            } else {
+                return mixed & (shard_count_ - 1);
+            }
+        }
+
+        Shard& shard_for(std::size_t hash) const noexcept { return shards_[shard_index(hash)]; }
+
+        static auto numa_topology([[maybe_unused]] const NumaTopology& requested) {
+            if constexpr (Numa::enabled) {
+                return requested.empty() ? NumaTopology::detect() : requested;
+            } else {
+                return cache_detail::Empty{};
+            }
+        }
+
+        // One without CacheFeatures::sharded. Otherwise a power of two, or with NumaShards a power of
+        // two per node. No more shards than a bounded cache's max_entries, so every shard's capacity
+        // is at least 1 and they add up to it; with NumaShards every node keeps one shard even when
+        // max_entries is under the node count.
+        auto shard_total(const CacheOptions& options) const noexcept -> std::size_t {
+            if constexpr (!Features.sharded) return 1;
+            const auto requested = std::max<std::size_t>(options.shards, 1);
+            const auto limit = Eviction::bounded && options.max_entries != 0 ? options.max_entries : ~std::size_t{0};
+            if constexpr (Numa::enabled) {
+                auto per_node = std::bit_ceil((requested + numa_.size() - 1) / numa_.size());
+                while (per_node > 1 && per_node * numa_.size() > limit) per_node /= 2;
+                return per_node * numa_.size();
+            } else {
+                return std::min(std::bit_ceil(requested), std::bit_floor(limit));
+            }
+        }
+
+        auto make_shards() const {
+            if constexpr (Numa::enabled) {
+                return cache_detail::NodeArray<Shard>(numa_, shard_count_ / numa_.size());
+            } else {
+                return std::make_unique<Shard[]>(shard_count_);
+            }
+        }
+
+        // Every node gets a replica slot for every shard; those of its own shards stay empty
+        auto make_replicas() const {
+            if constexpr (Numa::replicated) {
+                return cache_detail::NodeArray<Replica>(numa_, shard_count_);
+            } else {
+                return cache_detail::Empty{};
+            }
+        }
+
+        // First: the shard count and placement depend on it
+        [[no_unique_address]] std::conditional_t<Numa::enabled, NumaTopology, cache_detail::Empty> numa_;
+        std::size_t shard_count_;
+        std::conditional_t<Numa::enabled, cache_detail::NodeArray<Shard>, std::unique_ptr<Shard[]>> shards_;
+        [[no_unique_address]] std::conditional_t<Numa::replicated, cache_detail::NodeArray<Replica>, cache_detail::Empty> replicas_;
+        [[no_unique_address]] LoaderFn loader_;
+        [[no_unique_address]] BatchLoaderArg batch_loader_;
+        [[no_unique_address]] std::conditional_t<Features.async_loader, AsyncLoader, cache_detail::Empty> async_loader_;
+        [[no_unique_address]] std::conditional_t<Expiration::enabled, Expiry, cache_detail::Empty> expiry_;
+        [[no_unique_address]] typename Stats::Recorder stats_;
+        [[no_unique_address]] std::conditional_t<Near::enabled, std::uint64_t, cache_detail::Empty> near_owner_{};
+        [[no_unique_address]] typename Hot::template Tracker<Key> hot_;
+        [[no_unique_address]] std::conditional_t<Tier::enabled, std::unique_ptr<Spill>, cache_detail::Empty> tier_;
+        // Reset first by the destructor, so queued refreshes finish while the shards, the removal
+        // queue and the waiter scheduler still exist. Not last: a trailing empty member would pad
+        // the cache.
+        [[no_unique_address]] std::conditional_t<Expiration::enabled, std::unique_ptr<cache_detail::BackgroundExecutor>,
+                                                 cache_detail::Empty> refresher_;
+        // After the shards, which point to it
+        [[no_unique_address]] std::conditional_t<Features.removal_listener, std::unique_ptr<Removals>, cache_detail::Empty> removals_;
+        std::unique_ptr<cache_detail::WaiterScheduler> waiters_;
     };
+
+    // The policies as one constexpr options struct, for configurations that would otherwise spell
+    // out every template parameter. Derive and override what differs:
+    //     struct Sessions : CacheConfig { using Eviction = LruEviction; static constexpr auto features = CacheFeatures::none(); };
+    //     ConfiguredCache<std::string, Session, Sessions> sessions(load_session);
+    struct CacheConfig {
+        using Eviction = NoEviction;
+        using Storage = NodeStorage;
+        using Expiration = NoExpiration;
+        using Stats = NoStats;
+        using Tier = NoDiskTier;
+        using Near = NoNearCache;
+        using Hot = NoHotKeys;
+        using Allocator = std::allocator<std::byte>;
+        using Numa = NoNuma;
+        static constexpr CacheFeatures features = {};
+    };
+
+    template<Hashable Key, typename Value, typename Config = CacheConfig,
+             typename LoaderFn = std::function<typename cache_detail::ValueTraits<Value>::Loaded(const Key&)>>
+    using ConfiguredCache = ThreadSafeCache<Key, Value, typename Config::Eviction, typename Config::Storage, typename Config::Expiration,
+                                            typename Config::Stats, typename Config::Tier, typename Config::Near, typename Config::Hot,
+                                            Config::features, LoaderFn, typename Config::Allocator, typename Config::Numa>;
+
+    // A cache of Config's policies that stores loader inline:
+    //     auto users = make_cache<UserId, User, Sessions>([&db](const UserId& id) { return db.fetch(id); });
+    template<Hashable Key, typename Value, typename Config = CacheConfig, typename F>
+    auto make_cache(F loader, CacheOptions options = {}) -> ConfiguredCache<Key, Value, Config, F> {
+        return ConfiguredCache<Key, Value, Config, F>(std::move(loader), options);
+    }
+
+    // ThreadSafeCache cache(loader) with a loader of one signature: Key and Value come from its
+    // parameter and return types, and it is stored inline
+    template<cache_detail::DeducibleLoader F>
+    ThreadSafeCache(F) -> ThreadSafeCache<typename cache_detail::LoaderSignature<F>::Key, typename cache_detail::LoaderSignature<F>::Value,
+                                          NoEviction, NodeStorage, NoExpiration, NoStats, NoDiskTier, NoNearCache, NoHotKeys, CacheFeatures{}, F>;
+
+    template<cache_detail::DeducibleLoader F>
+    ThreadSafeCache(F, CacheOptions) -> ThreadSafeCache<typename cache_detail::LoaderSignature<F>::Key, typename cache_detail::LoaderSignature<F>::Value,
+                                                        NoEviction, NodeStorage, NoExpiration, NoStats, NoDiskTier, NoNearCache, NoHotKeys, CacheFeatures{}, F>;
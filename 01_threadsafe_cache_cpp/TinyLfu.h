@@ -0,0 +1,274 @@
+    #pragma once
+
+    #include <algorithm>
+    #include <bit>
+    #include <cstddef>
+    #include <cstdint>
+    #include <functional>
+    #include <vector>
+
+    #include "CacheEviction.h"
+
+    // W-TinyLFU admission (Einziger et al., "TinyLFU: A Highly Efficient Cache Admission Policy").
+    // Sized per shard and only touched under the shard's exclusive lock, like the policies it wraps.
+    namespace cache_detail {
+        // Count-min sketch of 4-bit counters, sixteen to a 64-bit word. Every sample_size
+        // increments all counters are halved, so old popularity fades out.
+        class FrequencySketch {
+        public:
+            void set_capacity(std::size_t capacity) {
+                const auto words = std::bit_ceil(std::max<std::size_t>(capacity, 16) / 16 * 4);
+                table_.assign(words, 0);
+                mask_ = words - 1;
+                sample_size_ = std::max<std::size_t>(capacity, 1) * 10;
+                additions_ = 0;
+            }
+
+            auto frequency(std::uint64_t hash) const noexcept -> unsigned {
+                if (table_.empty()) return 0;
+                unsigned estimate = 15;
+                for (unsigned row = 0; row < 4; ++row) {
+                    const auto [word, shift] = locate(hash, row);
+                    estimate = std::min<unsigned>(estimate, (table_[word] >> shift) & 0xf);
+                }
+                return estimate;
+            }
+
+            // Returns true when the sketch aged, so companions (the doorkeeper) can reset too
+            bool increment(std::uint64_t hash) noexcept {
+                if (table_.empty()) return false;
+                bool added = false;
+                for (unsigned row = 0; row < 4; ++row) {
+                    const auto [word, shift] = locate(hash, row);
+                    if (((table_[word] >> shift) & 0xf) != 0xf) {
+                        table_[word] += std::uint64_t{1} << shift;
+                        added = true;
+                    }
+                }
+                if (added && ++additions_ >= sample_size_) {
+                    age();
+                    return true;
+                }
+                return false;
+            }
+
+            void clear() noexcept {
+                std::fill(table_.begin(), table_.end(), 0);
+                additions_ = 0;
+            }
+
+        private:
+            // Each row re-mixes the hash with its own seed and picks one of the word's 16 counters
+            auto locate(std::uint64_t hash, unsigned row) const noexcept -> std::pair<std::size_t, unsigned> {
+                static constexpr std::uint64_t seeds[4] = {
+                    0xc3a5c85c97cb3127ULL, 0xb492b66fbe98f273ULL, 0x9ae16a3b2f90404fULL, 0xcbf29ce484222325ULL};
+                const auto h = mix_hash(hash + seeds[row]);
+                return {static_cast<std::size_t>(h) & mask_, static_cast<unsigned>(h >> 60) * 4};
+            }
+
+            void age() noexcept {
+                for (auto& word : table_) word = (word >> 1) & 0x7777777777777777ULL;
+                additions_ /= 2;
+            }
+
+            std::vector<std::uint64_t> table_;
+            std::size_t mask_ = 0;
+            std::size_t sample_size_ = 0;
+            std::size_t additions_ = 0;
+        };
+
+        // Bloom filter in front of the sketch: a key's first sighting per aging period only sets
+        // doorkeeper bits, so one-hit wonders never occupy sketch counters.
+        class Doorkeeper {
+        public:
+            void set_capacity(std::size_t capacity) {
+                bits_.assign(std::bit_ceil(std::max<std::size_t>(capacity, 64) * 8) / 64, 0);
+                mask_ = bits_.size() * 64 - 1;
+            }
+
+            bool contains(std::uint64_t hash) const noexcept {
+                if (bits_.empty()) return false;
+                const auto [a, b] = probes(hash);
+                return test(a) && test(b);
+            }
+
+            // Returns true if the hash was (probably) already present
+            bool put(std::uint64_t hash) noexcept {
+                if (bits_.empty()) return false;
+                const auto [a, b] = probes(hash);
+                const bool present = test(a) && test(b);
+                bits_[a / 64] |= std::uint64_t{1} << (a % 64);
+                bits_[b / 64] |= std::uint64_t{1} << (b % 64);
+                return present;
+            }
+
+            void clear() noexcept { std::fill(bits_.begin(), bits_.end(), 0); }
+
+        private:
+            auto probes(std::uint64_t hash) const noexcept -> std::pair<std::size_t, std::size_t> {
+                const auto h = mix_hash(hash ^ 0x5bd1e9955bd1e995ULL);
+                return {static_cast<std::size_t>(h) & mask_, static_cast<std::size_t>(h >> 32) & mask_};
+            }
+
+            bool test(std::size_t bit) const noexcept { return (bits_[bit / 64] >> (bit % 64)) & 1; }
+
+            std::vector<std::uint64_t> bits_;
+            std::size_t mask_ = 0;
+        };
+    }
+
+    // W-TinyLFU admission wrapped around any eviction policy. New entries land in a small LRU
+    // window (1% of the shard); when the window overflows its oldest entry competes with the
+    // main policy's victim, and only wins the slot if the sketch has seen it more often. Main must
+    // offer peek_victim() alongside victim().
+    template<typename Main = LruEviction>
+    struct TinyLfuAdmission {
+        static constexpr bool bounded = true;
+
+        template<typename Key>
+        class State {
+        public:
+            using Handle = std::uint32_t;
+
+            auto on_insert(const Key& key) -> Handle {
+                record(key);
+                const auto handle = allocate_route();
+                routes_[handle] = Route{window_.on_insert(key), false, true};
+                bind(window_owners_, routes_[handle].inner, handle);
+                ++window_size_;
+                return handle;
+            }
+
+            void on_access(Handle handle) {
+                if (handle >= routes_.size() || !routes_[handle].live) return;
+                const auto route = routes_[handle];
+                record(inner_key(route));
+                if (route.in_main) main_.on_access(route.inner); else window_.on_access(route.inner);
+            }
+
+            void on_remove(Handle handle) { release(handle, false); }
+
+            void on_evict(Handle handle) { release(handle, true); }
+
+            auto victim() -> Handle {
+                for (;;) {
+                    if (window_size_ == 0 || (window_size_ < window_capacity_ && main_size_ > 0)) {
+                        return main_owners_[main_.victim()];
+                    }
+                    const auto candidate = window_owners_[window_.victim()];
+                    if (main_capacity_ == 0) return candidate;
+                    if (main_size_ < main_capacity_) {
+                        promote(candidate);
+                        continue;
+                    }
+                    // Admission: the window's oldest entry only displaces a more valuable victim.
+                    // The main policy is only peeked at, so a rejected candidate leaves its
+                    // reference bits and queues as they were.
+                    if (estimate(key_of(candidate)) <= estimate(key_of(main_owners_[main_.peek_victim()]))) return candidate;
+                    const auto main_victim = main_owners_[main_.victim()];
+                    promote(candidate);
+                    return main_victim;
+                }
+            }
+
+            auto key_of(Handle handle) const -> const Key& { return inner_key(routes_[handle]); }
+
+            void clear() {
+                window_.clear();
+                main_.clear();
+                routes_.clear();
+                free_routes_.clear();
+                window_owners_.clear();
+                main_owners_.clear();
+                sketch_.clear();
+                doorkeeper_.clear();
+                window_size_ = main_size_ = 0;
+            }
+
+            void set_capacity(std::size_t capacity) {
+                window_capacity_ = std::max<std::size_t>(1, capacity / 100);
+                main_capacity_ = capacity - std::min(capacity, window_capacity_);
+                window_.set_capacity(window_capacity_);
+                main_.set_capacity(main_capacity_);
+                sketch_.set_capacity(capacity);
+                doorkeeper_.set_capacity(capacity);
+            }
+
+        private:
+            // Where an outer handle currently lives; the outer handle survives window -> main moves
+            struct Route {
+                std::uint32_t inner = cache_detail::no_slot;
+                bool in_main = false;
+                bool live = false;
+            };
+
+            auto allocate_route() -> Handle {
+                if (free_routes_.empty()) {
+                    routes_.emplace_back();
+                    return static_cast<Handle>(routes_.size() - 1);
+                }
+                const auto handle = free_routes_.back();
+                free_routes_.pop_back();
+                return handle;
+            }
+
+            void release(Handle handle, bool evicted) {
+                auto& route = routes_[handle];
+                if (route.in_main) {
+                    if (evicted) main_.on_evict(route.inner); else main_.on_remove(route.inner);
+                    --main_size_;
+                } else {
+                    window_.on_remove(route.inner);
+                    --window_size_;
+                }
+                route.live = false;
+                free_routes_.push_back(handle);
+            }
+
+            static void bind(std::vector<Handle>& owners, std::uint32_t inner, Handle outer) {
+                if (owners.size() <= inner) owners.resize(inner + 1, cache_detail::no_slot);
+                owners[inner] = outer;
+            }
+
+            auto inner_key(const Route& route) const -> const Key& {
+                return route.in_main ? main_.key_of(route.inner) : window_.key_of(route.inner);
+            }
+
+            static auto hash_of(const Key& key) -> std::uint64_t { return CacheHash<Key>{}(key); }
+
+            void record(const Key& key) {
+                const auto hash = hash_of(key);
+                if (!doorkeeper_.put(hash)) return;
+                if (sketch_.increment(hash)) doorkeeper_.clear();
+            }
+
+            auto estimate(const Key& key) const -> unsigned {
+                const auto hash = hash_of(key);
+                return sketch_.frequency(hash) + (doorkeeper_.contains(hash) ? 1 : 0);
+            }
+
+            void promote(Handle handle) {
+                auto& route = routes_[handle];
+                const Key key = window_.key_of(route.inner);
+                window_.on_remove(route.inner);
+                --window_size_;
+                route.inner = main_.on_insert(key);
+                route.in_main = true;
+                bind(main_owners_, route.inner, handle);
+                ++main_size_;
+            }
+
+            typename LruEviction::template State<Key> window_;
+            typename Main::template State<Key> main_;
+            std::vector<Route> routes_;
+            std::vector<Handle> free_routes_;
+            std::vector<Handle> window_owners_;
+            std::vector<Handle> main_owners_;
+            cache_detail::FrequencySketch sketch_;
+            cache_detail::Doorkeeper doorkeeper_;
+            std::size_t window_capacity_ = 1;
+            std::size_t main_capacity_ = 0;
+            std::size_t window_size_ = 0;
+            std::size_t main_size_ = 0;
+        };
+    };
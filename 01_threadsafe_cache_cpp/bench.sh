@@ -0,0 +1,39 @@
+#!/bin/bash
+
+# ThreadSafe Cache Benchmark Script
+# Compiles every bench/*_Bench.cpp driver and runs the one named on the command line
+# Usage: ./bench.sh [HitRatio] [extra args passed to the driver]
+
+echo "=== ThreadSafe Cache Benchmark Script ==="
+echo ""
+
+BENCH=${1:-HitRatio}
+[ $# -gt 0 ] && shift
+
+# Creating out folder if not exists
+mkdir -p out
+
+echo "Compiling benchmark drivers..."
+for SRC in bench/*_Bench.cpp; do
+    NAME=$(basename "$SRC" .cpp)
+    # Benchmarks need optimisation and native tuning; keep warnings on like run.sh
+    g++ -std=c++23 -pthread -Wall -Wextra -O3 -march=native -DNDEBUG "$SRC" -o "out/$NAME"
+    if [ $? -ne 0 ]; then
+        echo "❌ Compilation of $SRC failed!"
+        exit 1
+    fi
+done
+echo "✅ Compilation successful!"
+
+if [ ! -x "out/${BENCH}_Bench" ]; then
+    echo "❌ Unknown benchmark: $BENCH"
+    echo "Available:" $(ls bench/*_Bench.cpp | xargs -n1 basename | sed 's/_Bench.cpp//')
+    exit 1
+fi
+
+echo ""
+echo "Running ${BENCH}_Bench..."
+echo "================================="
+./out/${BENCH}_Bench "$@"
+echo "================================="
+echo "✅ Benchmark completed!"
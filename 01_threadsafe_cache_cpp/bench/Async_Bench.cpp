@@ -0,0 +1,136 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "../ThreadSafeCache.h"
+
+// Cold misses against a backend with 1ms latency: blocking get() from a pool of threads vs
+// get_async() driven by one thread, where the backend is a single timer thread that resumes
+// the parked loads. Each key is requested twice, so half the misses join an in-flight load.
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int distinct_keys = 10'000;
+    constexpr auto latency = std::chrono::milliseconds(1);
+
+    // Stand-in for an async client: co_await backend.call() resumes on the timer thread later
+    class Backend {
+    public:
+        ~Backend() {
+            {
+                std::lock_guard lock{mutex_};
+                stopping_ = true;
+            }
+            ready_.notify_one();
+            thread_.join();
+        }
+
+        auto call() {
+            struct Awaiter {
+                Backend* backend;
+                bool await_ready() noexcept { return false; }
+                void await_suspend(std::coroutine_handle<> caller) {
+                    auto* self = backend;   // the awaiter lives in the caller's frame, gone once resumed
+                    std::lock_guard lock{self->mutex_};
+                    self->due_.push({Clock::now() + latency, caller});
+                    self->ready_.notify_one();
+                }
+                void await_resume() noexcept {}
+            };
+            return Awaiter{this};
+        }
+
+    private:
+        using Timer = std::pair<Clock::time_point, std::coroutine_handle<>>;
+
+        void run() {
+            std::unique_lock lock{mutex_};
+            for (;;) {
+                if (due_.empty()) {
+                    if (stopping_) return;
+                    ready_.wait(lock);
+                    continue;
+                }
+                const auto [at, caller] = due_.top();
+                if (Clock::now() < at) {
+                    ready_.wait_until(lock, at);
+                    continue;
+                }
+                due_.pop();
+                lock.unlock();
+                caller.resume();
+                lock.lock();
+            }
+        }
+
+        std::mutex mutex_;
+        std::condition_variable ready_;
+        std::priority_queue<Timer, std::vector<Timer>, std::greater<>> due_;
+        bool stopping_ = false;
+        std::thread thread_{[this] { run(); }};
+    };
+
+    struct Detached {
+        struct promise_type {
+            Detached get_return_object() noexcept { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+    };
+
+    double blocking_ms(std::size_t threads) {
+        ThreadSafeCache<std::uint64_t, std::uint64_t> cache(
+            [](std::uint64_t key) { std::this_thread::sleep_for(latency); return key; }, {.shards = 16});
+        std::atomic<int> next{0};
+        const auto start = Clock::now();
+        std::vector<std::thread> pool;
+        for (std::size_t t = 0; t < threads; ++t) {
+            pool.emplace_back([&] {
+                for (int i; (i = next++) < 2 * distinct_keys;) cache.get(static_cast<std::uint64_t>(i % distinct_keys));
+            });
+        }
+        for (auto& thread : pool) thread.join();
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    double async_ms() {
+        Backend backend;
+        ThreadSafeCache<std::uint64_t, std::uint64_t> cache(
+            [&](const std::uint64_t& key) -> CacheTask<std::uint64_t> { co_await backend.call(); co_return key; },
+            {.shards = 16});
+        std::atomic<int> done{0};
+        const auto request = [](auto& cache, std::uint64_t key, std::atomic<int>& done) -> Detached {
+            co_await cache.get_async(key);
+            done.fetch_add(1, std::memory_order_release);
+        };
+        const auto start = Clock::now();
+        for (int i = 0; i < 2 * distinct_keys; ++i) request(cache, static_cast<std::uint64_t>(i % distinct_keys), done);
+        while (done.load(std::memory_order_acquire) < 2 * distinct_keys) std::this_thread::yield();
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+}
+
+int main()
+{
+    std::cout << 2 * distinct_keys << " gets over " << distinct_keys << " cold keys, backend latency 1ms\n";
+    std::cout << std::setw(24) << "mode" << std::setw(12) << "total ms" << std::setw(14) << "gets/s" << "\n";
+    std::cout << std::fixed << std::setprecision(1);
+    const auto row = [](const char* name, double ms) {
+        std::cout << std::setw(24) << name << std::setw(12) << ms << std::setw(14) << 2 * distinct_keys / (ms / 1000.0) << "\n";
+    };
+    row("get(), 8 threads", blocking_ms(8));
+    row("get(), 64 threads", blocking_ms(64));
+    row("get_async(), 1 thread", async_ms());
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <span>
+#include <thread>
+#include <vector>
+#include "../ThreadSafeCache.h"
+
+// 500-key requests: a loop of get() vs one get_all(), on a warm cache and on a cold one where
+// every loader call costs a 50us round-trip. get_all takes each shard's lock once and, with a
+// batch loader, fetches all of a request's misses in one call.
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr std::size_t request_keys = 500;
+    constexpr int requests = 200;
+    constexpr auto round_trip = std::chrono::microseconds(50);
+
+    using Cache = ThreadSafeCache<std::uint64_t, std::uint64_t, LruEviction>;
+
+    auto make_requests() -> std::vector<std::vector<std::uint64_t>> {
+        std::mt19937_64 rng{7};
+        std::vector<std::vector<std::uint64_t>> batches(requests);
+        for (auto& batch : batches) {
+            for (std::size_t i = 0; i < request_keys; ++i) batch.push_back(rng() % 1'000'000);
+        }
+        return batches;
+    }
+
+    auto make_cache() -> Cache {
+        return Cache(
+            [](std::uint64_t key) { std::this_thread::sleep_for(round_trip); return key; },
+            [](std::span<const std::uint64_t> keys) {
+                std::this_thread::sleep_for(round_trip);
+                return std::vector<std::uint64_t>(keys.begin(), keys.end());
+            },
+            {.shards = 16, .max_entries = 1'000'000});
+    }
+
+    // Microseconds per request
+    template<typename Fetch>
+    double run(const std::vector<std::vector<std::uint64_t>>& batches, Fetch&& fetch) {
+        std::uint64_t checksum = 0;
+        const auto start = Clock::now();
+        for (const auto& batch : batches) checksum += fetch(batch);
+        const auto elapsed = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        return checksum == 42 ? 0.0 : elapsed / static_cast<double>(batches.size());
+    }
+
+    std::uint64_t get_each(Cache& cache, const std::vector<std::uint64_t>& batch) {
+        std::uint64_t sum = 0;
+        for (auto key : batch) sum += cache.get(key).value_or(0);
+        return sum;
+    }
+
+    std::uint64_t get_all(Cache& cache, const std::vector<std::uint64_t>& batch) {
+        std::uint64_t sum = 0;
+        for (const auto& value : cache.get_all(batch)) sum += value.value_or(0);
+        return sum;
+    }
+}
+
+int main()
+{
+    const auto batches = make_requests();
+    std::cout << requests << " requests of " << request_keys << " keys, 16 shards, loader round-trip 50us; us per request\n";
+    std::cout << std::setw(12) << "" << std::setw(12) << "get loop" << std::setw(12) << "get_all" << "\n";
+    std::cout << std::fixed << std::setprecision(1);
+
+    auto cold_each = make_cache();
+    auto cold_all = make_cache();
+    const auto each_miss = run(batches, [&](const auto& batch) { return get_each(cold_each, batch); });
+    const auto all_miss = run(batches, [&](const auto& batch) { return get_all(cold_all, batch); });
+    std::cout << std::setw(12) << "cold" << std::setw(12) << each_miss << std::setw(12) << all_miss << "\n";
+
+    const auto each_hit = run(batches, [&](const auto& batch) { return get_each(cold_each, batch); });
+    const auto all_hit = run(batches, [&](const auto& batch) { return get_all(cold_each, batch); });
+    std::cout << std::setw(12) << "warm" << std::setw(12) << each_hit << std::setw(12) << all_hit << "\n";
+    return 0;
+}
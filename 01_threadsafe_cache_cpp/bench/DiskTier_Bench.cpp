@@ -0,0 +1,65 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include "../ThreadSafeCache.h"
+#include "Workload.h"
+
+// A working set ten times the memory tier: zipf(0.9) gets over `keys` keys of 1 KiB values,
+// LRU holding a tenth of them, and a loader that spins for 100us (a remote fetch). With DiskTier
+// the evicted values go to a log in the system temporary directory, and most misses come back
+// from there instead of the loader. Usage: DiskTier_Bench [keys] (default 200000)
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr std::size_t value_bytes = 1024;
+    constexpr auto loader_latency = std::chrono::microseconds(100);
+
+    auto remote_fetch(std::uint64_t key, std::uint64_t& calls) -> std::string {
+        ++calls;
+        const auto until = Clock::now() + loader_latency;
+        while (Clock::now() < until) {
+        }
+        return std::string(value_bytes, static_cast<char>('a' + key % 26));
+    }
+
+    template<typename Tier>
+    void report(const char* name, std::uint64_t keys, std::uint64_t gets) {
+        std::uint64_t calls = 0;
+        ThreadSafeCache<std::uint64_t, std::string, LruEviction, NodeStorage, NoExpiration, NoStats, Tier> cache(
+            [&](std::uint64_t key) { return remote_fetch(key, calls); },
+            {.shards = 16, .max_entries = static_cast<std::size_t>(keys / 10)});
+        ZipfGenerator zipf(keys, 0.9);
+        std::mt19937_64 rng{7};
+        for (std::uint64_t i = 0; i < gets; ++i) cache.get(zipf(rng));   // warm both tiers
+
+        calls = 0;
+        const auto start = Clock::now();
+        for (std::uint64_t i = 0; i < gets; ++i) cache.get(zipf(rng));
+        const auto seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << std::setw(12) << name << std::fixed << std::setprecision(3) << std::setw(12)
+                  << 1.0 - static_cast<double>(calls) / static_cast<double>(gets) << std::setw(12) << calls
+                  << std::setprecision(2) << std::setw(12) << seconds * 1e6 / static_cast<double>(gets);
+        if constexpr (Tier::enabled) {
+            std::cout << std::setw(12) << cache.disk_size() << std::setw(12) << cache.disk_bytes() / (1 << 20);
+        }
+        std::cout << "\n";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::uint64_t keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200'000;
+    const std::uint64_t gets = keys * 2;
+    std::cout << keys << " keys of " << value_bytes << " B, zipf 0.9, LRU holding " << keys / 10
+              << ", loader 100us; " << gets << " gets after as many warm-up gets\n";
+    std::cout << std::setw(12) << "tier" << std::setw(12) << "hit ratio" << std::setw(12) << "loads"
+              << std::setw(12) << "us/get" << std::setw(12) << "on disk" << std::setw(12) << "disk MiB" << "\n";
+    report<NoDiskTier>("memory", keys, gets);
+    report<DiskTier>("memory+disk", keys, gets);
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../ThreadSafeCache.h"
+#include "Workload.h"
+
+// Single-threaded hit ratio of each eviction policy on synthetic traces.
+// One shard, so the capacity bound is exact and results are comparable across policies.
+
+namespace {
+    constexpr std::uint64_t key_space = 1'000'000;
+    constexpr std::size_t requests = 2'000'000;
+
+    template<typename Eviction>
+    double hit_ratio(const std::vector<std::uint64_t>& trace, std::size_t capacity) {
+        std::size_t loads = 0;
+        ThreadSafeCache<std::uint64_t, std::uint64_t, Eviction> cache(
+            [&loads](std::uint64_t key) { ++loads; return key; }, {.shards = 1, .max_entries = capacity});
+        for (auto key : trace) cache.get(key);
+        return 1.0 - static_cast<double>(loads) / static_cast<double>(trace.size());
+    }
+
+    template<typename Generator>
+    std::vector<std::uint64_t> make_trace(Generator generator) {
+        std::mt19937_64 rng{42};
+        std::vector<std::uint64_t> trace(requests);
+        for (auto& key : trace) key = generator(rng);
+        return trace;
+    }
+
+    void report(const std::string& name, const std::vector<std::uint64_t>& trace) {
+        std::cout << "\n" << name << "\n";
+        std::cout << std::setw(10) << "capacity" << std::setw(9) << "LRU" << std::setw(9) << "CLOCK"
+                  << std::setw(9) << "S3-FIFO" << std::setw(12) << "W-TinyLFU" << std::setw(12) << "TLFU+CLOCK"
+                  << std::setw(12) << "TLFU+S3" << "\n";
+        std::cout << std::fixed << std::setprecision(4);
+        for (std::size_t capacity : {1'000, 10'000, 100'000}) {
+            std::cout << std::setw(10) << capacity
+                      << std::setw(9) << hit_ratio<LruEviction>(trace, capacity)
+                      << std::setw(9) << hit_ratio<ClockEviction>(trace, capacity)
+                      << std::setw(9) << hit_ratio<S3FifoEviction>(trace, capacity)
+                      << std::setw(12) << hit_ratio<TinyLfuAdmission<LruEviction>>(trace, capacity)
+                      << std::setw(12) << hit_ratio<TinyLfuAdmission<ClockEviction>>(trace, capacity)
+                      << std::setw(12) << hit_ratio<TinyLfuAdmission<S3FifoEviction>>(trace, capacity) << "\n";
+        }
+    }
+}
+
+int main()
+{
+    std::cout << "Hit ratio over " << requests << " requests, " << key_space << " keys" << std::endl;
+    report("zipf(0.9)", make_trace(ZipfGenerator{key_space, 0.9}));
+    report("zipf(0.99)", make_trace(ZipfGenerator{key_space, 0.99}));
+    report("zipf(0.9) + 5k-key scans (started with p=1e-4 per request)",
+           make_trace(ScanMixGenerator{key_space, 0.9, 5'000, 1e-4}));
+    return 0;
+}
@@ -0,0 +1,54 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include "../ThreadSafeCache.h"
+#include "Workload.h"
+
+// get() cost with and without HotKeys, on zipf(0.9) hits over `keys` keys, where halfway through
+// the coldest key suddenly takes 30% of the traffic; then the top five keys HotKeys reports.
+// Usage: HotKeys_Bench [keys] (default 100000)
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    template<typename Hot>
+    void report(const char* name, std::uint64_t keys, std::uint64_t gets) {
+        ThreadSafeCache<std::uint64_t, std::uint64_t, LruEviction, NodeStorage, NoExpiration, NoStats, NoDiskTier, NoNearCache, Hot> cache(
+            [](std::uint64_t key) { return key; }, {.shards = 16, .max_entries = static_cast<std::size_t>(keys)});
+        for (std::uint64_t key = 0; key < keys; ++key) cache.put(key, key);
+        ZipfGenerator zipf(keys, 0.9);
+        std::mt19937_64 rng{7};
+        const auto spike = keys - 1;
+
+        std::uint64_t checksum = 0;
+        const auto start = Clock::now();
+        for (std::uint64_t i = 0; i < gets; ++i) {
+            const auto key = i > gets / 2 && rng() % 10 < 3 ? spike : zipf(rng);
+            checksum += cache.get(key).value_or(0);
+        }
+        const auto seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << std::setw(10) << name << std::fixed << std::setprecision(2) << std::setw(10)
+                  << seconds * 1e9 / static_cast<double>(gets) << (checksum == 42 ? " " : "") << "\n";
+        if constexpr (Hot::enabled) {
+            std::cout << "  key " << spike << " took 30% of the second half; top 5 (key, rate, share +- error):\n";
+            for (const auto& hot : cache.hot_keys(5)) {
+                std::cout << std::setw(12) << hot.key << std::setprecision(0) << std::setw(12) << hot.per_second
+                          << "/s" << std::setprecision(3) << std::setw(8) << hot.share << " +- " << hot.error_share << "\n";
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::uint64_t keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100'000;
+    const std::uint64_t gets = keys * 50;
+    std::cout << keys << " keys, zipf 0.9, " << gets << " get() hits, 1 thread\n";
+    std::cout << std::setw(10) << "policy" << std::setw(10) << "ns/get" << "\n";
+    report<NoHotKeys>("none", keys, gets);
+    report<HotKeys<>>("HotKeys", keys, gets);
+    return 0;
+}
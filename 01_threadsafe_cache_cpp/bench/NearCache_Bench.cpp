@@ -0,0 +1,81 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+#include "../ThreadSafeCache.h"
+
+// get() throughput on a handful of ultra-hot keys (uniform over `hot_keys`), with and without a
+// per-thread NearCache in front of the shards, and with one writer putting a random hot key
+// every 100us, which bumps that key's shard version and so invalidates the near copies of every
+// key in the shard. Usage: NearCache_Bench [max threads] (default 2 x hardware threads)
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr std::uint64_t hot_keys = 32;
+    constexpr auto run_time = std::chrono::milliseconds(500);
+
+    template<typename Near>
+    double gets_per_second(std::size_t readers, bool with_writer) {
+        ThreadSafeCache<std::uint64_t, std::uint64_t, LruEviction, NodeStorage, NoExpiration, NoStats, NoDiskTier, Near> cache(
+            [](std::uint64_t key) { return key; }, {.shards = 16, .max_entries = 100'000});
+        for (std::uint64_t key = 0; key < hot_keys; ++key) cache.put(key, key);
+
+        std::atomic<bool> stop{false};
+        std::atomic<std::uint64_t> total{0};
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0; t < readers; ++t) {
+            threads.emplace_back([&, t] {
+                std::mt19937_64 rng{t + 1};
+                std::uint64_t reads = 0;
+                std::uint64_t checksum = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    for (int i = 0; i < 256; ++i) checksum += cache.get(rng() % hot_keys).value_or(0);
+                    reads += 256;
+                }
+                total += reads + (checksum == 42);
+            });
+        }
+        if (with_writer) {
+            threads.emplace_back([&] {
+                std::mt19937_64 rng{99};
+                while (!stop.load(std::memory_order_relaxed)) {
+                    const auto key = rng() % hot_keys;
+                    cache.put(key, key);
+                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+                }
+            });
+        }
+
+        const auto start = Clock::now();
+        std::this_thread::sleep_for(run_time);
+        stop = true;
+        for (auto& thread : threads) thread.join();
+        return static_cast<double>(total.load()) / std::chrono::duration<double>(Clock::now() - start).count();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::size_t max_threads = argc > 1 ? std::strtoull(argv[1], nullptr, 10)
+                                             : 2 * std::max(1u, std::thread::hardware_concurrency());
+
+    std::cout << "Hot-key get() throughput (M gets/s), LRU, 16 shards, " << hot_keys << " hot keys, "
+              << std::thread::hardware_concurrency() << " hardware threads\n";
+    std::cout << std::setw(8) << "readers" << std::setw(12) << "shared" << std::setw(12) << "near"
+              << std::setw(16) << "shared+writer" << std::setw(16) << "near+writer" << "\n";
+    std::cout << std::fixed << std::setprecision(2);
+    for (std::size_t readers = 1; readers <= max_threads; readers *= 2) {
+        std::cout << std::setw(8) << readers
+                  << std::setw(12) << gets_per_second<NoNearCache>(readers, false) / 1e6
+                  << std::setw(12) << gets_per_second<NearCache<>>(readers, false) / 1e6
+                  << std::setw(16) << gets_per_second<NoNearCache>(readers, true) / 1e6
+                  << std::setw(16) << gets_per_second<NearCache<>>(readers, true) / 1e6 << "\n";
+    }
+    return 0;
+}
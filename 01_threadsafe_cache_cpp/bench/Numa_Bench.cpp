@@ -0,0 +1,93 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+#include "../ThreadSafeCache.h"
+#include "Workload.h"
+
+// Throughput of flat shards, NUMA shard groups and NUMA groups with read replicas, on zipf(0.99)
+// gets with 2% puts. Threads are dealt out over the nodes and bound to them, as numactl
+// --cpunodebind would. The layout is the host's when it has at least `nodes` nodes, else a
+// synthetic one cut from its CPUs: there the memory of every node is the same, so the run shows
+// the bookkeeping each mode costs, not the interconnect traffic it saves.
+// Usage: Numa_Bench [threads] [keys] [nodes] (defaults 4, 100000 and 2)
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr auto run_time = std::chrono::milliseconds(500);
+
+    struct Flat : CacheConfig {
+        using Eviction = LruEviction;
+        using Allocator = PoolAllocator<std::byte>;
+    };
+
+    struct Grouped : Flat {
+        using Numa = NumaShards<>;
+    };
+
+    struct Replicated : Flat {
+        using Numa = NumaShards<1024>;
+    };
+
+    template<typename Config>
+    double ops_per_second(const NumaTopology& topology, std::size_t threads, std::uint64_t keys) {
+        CacheOptions options{.shards = 64, .max_entries = static_cast<std::size_t>(keys)};
+        options.numa = topology;
+        ConfiguredCache<std::uint64_t, std::uint64_t, Config> cache(nullptr, options);
+        for (std::uint64_t key = 0; key < keys; ++key) cache.put(key, key);
+
+        std::atomic<bool> stop{false};
+        std::atomic<std::uint64_t> total{0};
+        std::vector<std::thread> workers;
+        for (std::size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                topology.bind_current_thread(t % topology.size());
+                ZipfGenerator zipf(keys, 0.99);
+                std::mt19937_64 rng{t + 1};
+                std::uint64_t ops = 0, checksum = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    for (int i = 0; i < 256; ++i, ++ops) {
+                        const auto key = zipf(rng);
+                        if (rng() % 50 == 0) {
+                            cache.put(key, key);
+                        } else {
+                            checksum += cache.get(key).value_or(0);
+                        }
+                    }
+                }
+                total.fetch_add(ops + (checksum == 42 ? 1 : 0));
+            });
+        }
+        std::this_thread::sleep_for(run_time);
+        stop = true;
+        for (auto& worker : workers) worker.join();
+        return static_cast<double>(total.load()) / std::chrono::duration<double>(run_time).count();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::size_t threads = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4;
+    const std::uint64_t keys = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100'000;
+    const std::size_t nodes = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 2;
+
+    const auto host = NumaTopology::detect();
+    const bool synthetic = host.size() < nodes;
+    const auto topology = synthetic ? NumaTopology::synthetic(nodes) : host;
+    std::cout << topology.size() << (synthetic ? " synthetic" : " host") << " nodes:";
+    for (const auto& node : topology.nodes()) {
+        std::cout << " [memory " << node.memory_node << ", " << node.cpus.size() << " cpus]";
+    }
+    std::cout << "\n" << threads << " threads, " << keys << " keys, zipf 0.99, 98% get / 2% put, LRU, 64 shards, PoolAllocator\n";
+    std::cout << std::setw(12) << "mode" << std::setw(12) << "M ops/s" << "\n" << std::fixed << std::setprecision(2);
+    std::cout << std::setw(12) << "flat" << std::setw(12) << ops_per_second<Flat>(topology, threads, keys) / 1e6 << "\n";
+    std::cout << std::setw(12) << "grouped" << std::setw(12) << ops_per_second<Grouped>(topology, threads, keys) / 1e6 << "\n";
+    std::cout << std::setw(12) << "replicated" << std::setw(12) << ops_per_second<Replicated>(topology, threads, keys) / 1e6 << "\n";
+    return 0;
+}
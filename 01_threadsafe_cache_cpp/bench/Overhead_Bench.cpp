@@ -0,0 +1,182 @@
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <malloc.h>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <random>
+#include <unordered_map>
+#include <vector>
+#include "../ThreadSafeCache.h"
+
+// What the feature switches cost a cache that uses none of them: the original single-mutex
+// cache this one grew from, the default ThreadSafeCache, the same cache with every CacheFeatures
+// switch off, and a fully featured one for scale. Heap bytes per entry (shards included) and
+// warm get() hits, one thread, the caches' passes interleaved so drift hits them all alike.
+// Fails (exit 1) unless the lean cache matches the original in both.
+// Usage: Overhead_Bench [entries] (default 1'000'000)
+
+namespace {
+    // Heap accounting as in Storage_Bench: usable block sizes, malloc headers excluded
+    std::size_t live_bytes = 0;
+}
+
+[[gnu::noinline]] void* operator new(std::size_t size) {
+    void* block = std::malloc(size);
+    if (!block) throw std::bad_alloc{};
+    live_bytes += malloc_usable_size(block);
+    return block;
+}
+
+[[gnu::noinline]] void operator delete(void* pointer) noexcept {
+    if (!pointer) return;
+    live_bytes -= malloc_usable_size(pointer);
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept { operator delete(pointer); }
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // The cache as it was before shards, policies and features: one mutex over one
+    // std::unordered_map, the loader a std::function
+    template<typename Key, typename Value>
+    class OriginalCache {
+    public:
+        using Loader = std::function<Value(const Key&)>;
+
+        explicit OriginalCache(auto&& loader = nullptr) : loader_(std::forward<decltype(loader)>(loader)) {}
+
+        auto get(const Key& key) -> std::optional<Value> {
+            {
+                std::lock_guard lock{mutex_};
+                if (auto it = cache_.find(key); it != cache_.end()) return it->second;
+            }
+            if (!loader_) return std::nullopt;
+            auto loaded = loader_(key);
+            std::lock_guard lock{mutex_};
+            return cache_.try_emplace(key, loaded).first->second;
+        }
+
+        void put(const Key& key, const Value& value) {
+            std::lock_guard lock{mutex_};
+            cache_[key] = value;
+        }
+
+    private:
+        mutable std::mutex mutex_;
+        std::unordered_map<Key, Value> cache_;
+        Loader loader_;
+    };
+
+    struct Lean : CacheConfig {
+        static constexpr auto features = CacheFeatures::none();
+    };
+
+    struct Full : CacheConfig {
+        using Eviction = LruEviction;
+        using Expiration = TimerWheelExpiration;
+        using Stats = CacheStats;
+        using Hot = HotKeys<>;
+    };
+
+    using Original = OriginalCache<std::uint64_t, std::uint64_t>;
+    using Default = ThreadSafeCache<std::uint64_t, std::uint64_t>;
+    using LeanCache = ConfiguredCache<std::uint64_t, std::uint64_t, Lean>;
+    using FullCache = ConfiguredCache<std::uint64_t, std::uint64_t, Full>;
+
+    // The static half of the check: nothing disabled leaves a byte in an entry or the cache
+    static_assert(LeanCache::entry_overhead() == 0);
+    static_assert(Default::entry_overhead() == 0);
+    static_assert(sizeof(LeanCache) <= sizeof(Default));
+    static_assert(sizeof(LeanCache) <= sizeof(Original));
+    static_assert(sizeof(Default) <= sizeof(Original));
+
+    // Best of this many passes per cache; "matches" allows this much run-to-run noise
+    constexpr int passes = 7;
+    constexpr double latency_slack = 1.05;
+    constexpr double heap_slack = 1.01;
+
+    struct Measured {
+        const char* name;
+        double heap = 0;            // bytes per entry
+        double get_ns = 1e30;       // best pass
+        std::size_t size = 0;       // sizeof the cache object
+    };
+
+    // One cache, filled with every key, and the keys its passes look up
+    class Subject {
+    public:
+        virtual ~Subject() = default;
+        virtual void pass() = 0;
+        Measured measured;
+    };
+
+    template<typename Cache>
+    class Filled : public Subject {
+    public:
+        Filled(const char* name, std::uint64_t entries) : keys_(1 << 20) {
+            const auto before = live_bytes;
+            if constexpr (std::constructible_from<Cache, std::nullptr_t, CacheOptions>) {
+                cache_ = std::make_unique<Cache>(nullptr, CacheOptions{.shards = 16});
+            } else {
+                cache_ = std::make_unique<Cache>(nullptr);
+            }
+            for (std::uint64_t key = 0; key < entries; ++key) cache_->put(key, key);
+            measured = {name, static_cast<double>(live_bytes - before) / static_cast<double>(entries), 1e30, sizeof(Cache)};
+            std::mt19937_64 rng{3};
+            for (auto& key : keys_) key = rng() % entries;
+        }
+
+        void pass() override {
+            std::uint64_t checksum = 0;
+            const auto start = Clock::now();
+            for (auto key : keys_) checksum += cache_->get(key).value_or(0);
+            const auto ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / static_cast<double>(keys_.size());
+            measured.get_ns = std::min(measured.get_ns, ns + (checksum == 42 ? 1e-9 : 0));
+        }
+
+    private:
+        std::unique_ptr<Cache> cache_;
+        std::vector<std::uint64_t> keys_;
+    };
+}
+
+int main(int argc, char** argv)
+{
+    const std::uint64_t entries = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+    std::cout << entries << " entries of uint64 -> uint64, NodeStorage, 16 shards (lean: 1); best of " << passes
+              << " interleaved passes of 1M gets\n";
+    std::vector<std::unique_ptr<Subject>> subjects;
+    subjects.push_back(std::make_unique<Filled<Original>>("original", entries));
+    subjects.push_back(std::make_unique<Filled<Default>>("default", entries));
+    subjects.push_back(std::make_unique<Filled<LeanCache>>("lean", entries));
+    subjects.push_back(std::make_unique<Filled<FullCache>>("full", entries));
+    for (int round = 0; round < passes; ++round) {
+        for (auto& subject : subjects) subject->pass();
+    }
+
+    std::cout << std::setw(10) << "config" << std::setw(14) << "heap B/entry" << std::setw(12) << "get ns"
+              << std::setw(10) << "sizeof" << "\n";
+    for (const auto& subject : subjects) {
+        const auto& m = subject->measured;
+        std::cout << std::setw(10) << m.name << std::fixed << std::setprecision(2) << std::setw(14) << m.heap
+                  << std::setw(12) << m.get_ns << std::setw(10) << m.size << "\n";
+    }
+
+    // The dynamic half: the lean cache costs no more than the original per entry and per hit
+    const auto& original = subjects[0]->measured;
+    const auto& lean = subjects[2]->measured;
+    const bool heap_ok = lean.heap <= original.heap * heap_slack;
+    const bool latency_ok = lean.get_ns <= original.get_ns * latency_slack;
+    std::cout << "lean / original: heap " << lean.heap / original.heap << ", get " << lean.get_ns / original.get_ns
+              << (heap_ok && latency_ok ? "  ✅ matches or beats" : "  ❌ costs more") << "\n";
+    return heap_ok && latency_ok ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <malloc.h>
+#include <new>
+#include <thread>
+#include <vector>
+#include "../ThreadSafeCache.h"
+
+// Insert/evict churn through std::allocator and through the per-shard PoolAllocator: writers put
+// fresh keys into a full LRU cache, so every put frees one node and allocates another. Reports
+// puts per second and the heap the cache holds afterwards (counted by the replaced operator new,
+// as in Storage_Bench), next to what memory() reports for the pool.
+// Usage: Pool_Bench [threads] [entries] (defaults 4 and 1'000'000)
+
+namespace {
+    std::atomic<std::size_t> live_bytes{0};
+}
+
+[[gnu::noinline]] void* operator new(std::size_t size) {
+    void* block = std::malloc(size);
+    if (!block) throw std::bad_alloc{};
+    live_bytes.fetch_add(malloc_usable_size(block), std::memory_order_relaxed);
+    return block;
+}
+
+[[gnu::noinline]] void* operator new(std::size_t size, std::align_val_t align) {
+    void* block = std::aligned_alloc(static_cast<std::size_t>(align), (size + static_cast<std::size_t>(align) - 1) & ~(static_cast<std::size_t>(align) - 1));
+    if (!block) throw std::bad_alloc{};
+    live_bytes.fetch_add(malloc_usable_size(block), std::memory_order_relaxed);
+    return block;
+}
+
+[[gnu::noinline]] void operator delete(void* pointer) noexcept {
+    if (!pointer) return;
+    live_bytes.fetch_sub(malloc_usable_size(pointer), std::memory_order_relaxed);
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept { operator delete(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { operator delete(pointer); }
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept { operator delete(pointer); }
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Heap : CacheConfig {
+        using Eviction = LruEviction;
+    };
+
+    struct Pooled : Heap {
+        using Allocator = PoolAllocator<std::byte>;
+    };
+
+    template<typename Config>
+    void report(const char* name, std::size_t threads, std::uint64_t entries) {
+        const auto before = live_bytes.load();
+        ConfiguredCache<std::uint64_t, std::uint64_t, Config> cache(nullptr, {.shards = 16, .max_entries = static_cast<std::size_t>(entries)});
+        for (std::uint64_t key = 0; key < entries; ++key) cache.put(key, key);
+
+        const auto per_thread = entries * 2;
+        const auto start = Clock::now();
+        std::vector<std::thread> writers;
+        for (std::size_t t = 0; t < threads; ++t) {
+            writers.emplace_back([&, t] {
+                const auto base = entries + t * per_thread;
+                for (std::uint64_t i = 0; i < per_thread; ++i) cache.put(base + i, i);
+            });
+        }
+        for (auto& writer : writers) writer.join();
+        const auto seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        const auto heap = static_cast<double>(live_bytes.load() - before) / static_cast<double>(cache.size());
+        std::cout << std::setw(10) << name << std::fixed << std::setprecision(2) << std::setw(12)
+                  << static_cast<double>(threads * per_thread) / seconds / 1e6 << std::setw(14) << heap;
+        if constexpr (requires { cache.memory(); }) {
+            const auto memory = cache.memory();
+            std::cout << std::setw(12) << static_cast<double>(memory.node_bytes) / static_cast<double>(cache.size())
+                      << std::setw(12) << static_cast<double>(memory.reserved_bytes) / static_cast<double>(cache.size());
+        }
+        std::cout << "\n";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::size_t threads = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4;
+    const std::uint64_t entries = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1'000'000;
+    std::cout << threads << " writers churning " << entries * 2 << " fresh keys each through a full LRU cache of "
+              << entries << " uint64 -> uint64, 16 shards\n";
+    std::cout << std::setw(10) << "allocator" << std::setw(12) << "M puts/s" << std::setw(14) << "heap B/entry"
+              << std::setw(12) << "node B" << std::setw(12) << "reserved B" << "\n";
+    report<Heap>("std", threads, entries);
+    report<Pooled>("pool", threads, entries);
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+#include "../ThreadSafeCache.h"
+#include "Workload.h"
+
+// Read-hit throughput as reader threads are added, shared-lock shards vs the lock-free read
+// path, with and without one background writer. Keys are zipf(0.99), so a few shards stay hot.
+// Usage: ReadScaling_Bench [max threads] (default 2 x hardware threads)
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr std::uint64_t key_space = 100'000;
+    constexpr auto run_time = std::chrono::milliseconds(500);
+
+    template<typename Storage>
+    double reads_per_second(std::size_t readers, bool with_writer) {
+        ThreadSafeCache<std::uint64_t, std::uint64_t, LruEviction, Storage> cache(
+            [](std::uint64_t key) { return key; }, {.shards = 16, .max_entries = key_space});
+        for (std::uint64_t key = 0; key < key_space; ++key) cache.put(key, key);
+
+        std::atomic<bool> stop{false};
+        std::atomic<std::uint64_t> total{0};
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0; t < readers; ++t) {
+            threads.emplace_back([&, t] {
+                ZipfGenerator zipf{key_space, 0.99};
+                std::mt19937_64 rng{t + 1};
+                std::uint64_t reads = 0;
+                std::uint64_t checksum = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    for (int i = 0; i < 256; ++i) checksum += cache.get(zipf(rng)).value_or(0);
+                    reads += 256;
+                }
+                total += reads + (checksum == 42);
+            });
+        }
+        if (with_writer) {
+            threads.emplace_back([&] {
+                std::mt19937_64 rng{99};
+                while (!stop.load(std::memory_order_relaxed)) {
+                    const auto key = rng() % key_space;
+                    cache.put(key, key);
+                    std::this_thread::sleep_for(std::chrono::microseconds(10));
+                }
+            });
+        }
+
+        const auto start = Clock::now();
+        std::this_thread::sleep_for(run_time);
+        stop = true;
+        for (auto& thread : threads) thread.join();
+        return static_cast<double>(total.load()) / std::chrono::duration<double>(Clock::now() - start).count();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::size_t max_threads = argc > 1 ? std::strtoull(argv[1], nullptr, 10)
+                                             : 2 * std::max(1u, std::thread::hardware_concurrency());
+
+    std::cout << "Read-hit throughput (M gets/s), LRU, 16 shards, zipf(0.99) over " << key_space << " keys, "
+              << std::thread::hardware_concurrency() << " hardware threads\n";
+    std::cout << std::setw(8) << "readers" << std::setw(14) << "NodeStorage" << std::setw(18) << "ConcurrentStorage"
+              << std::setw(18) << "Node+writer" << std::setw(18) << "Concurrent+writer" << "\n";
+    std::cout << std::fixed << std::setprecision(2);
+    for (std::size_t readers = 1; readers <= max_threads; readers *= 2) {
+        std::cout << std::setw(8) << readers
+                  << std::setw(14) << reads_per_second<NodeStorage>(readers, false) / 1e6
+                  << std::setw(18) << reads_per_second<ConcurrentStorage>(readers, false) / 1e6
+                  << std::setw(18) << reads_per_second<NodeStorage>(readers, true) / 1e6
+                  << std::setw(18) << reads_per_second<ConcurrentStorage>(readers, true) / 1e6 << "\n";
+    }
+    return 0;
+}
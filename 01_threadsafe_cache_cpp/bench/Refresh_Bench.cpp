@@ -0,0 +1,53 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+#include "../ThreadSafeCache.h"
+
+// get() latency across expiry boundaries: a small hot key set with a short TTL and a slow
+// loader, with and without refresh-ahead. Without it every expiry puts a full loader call on
+// the request path; with it reloads happen in the background and the tail stays flat.
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+    using namespace std::chrono_literals;
+
+    constexpr int hot_keys = 64;
+    constexpr auto ttl = 100ms;
+    constexpr auto loader_latency = 2ms;
+    constexpr auto run_time = 1s;
+
+    void report(const char* name, CacheOptions options) {
+        ThreadSafeCache<int, int, LruEviction, NodeStorage, TimerWheelExpiration> cache(
+            [](int key) { std::this_thread::sleep_for(loader_latency); return key; }, options);
+        std::mt19937 rng{1};
+        std::vector<double> latencies;
+        const auto stop = Clock::now() + run_time;
+        while (Clock::now() < stop) {
+            const auto key = static_cast<int>(rng() % hot_keys);
+            const auto start = Clock::now();
+            cache.get(key);
+            latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        }
+        const auto slow = std::count_if(latencies.begin(), latencies.end(), [](double us) { return us >= 1000.0; });
+        std::sort(latencies.begin(), latencies.end());
+        const auto at = [&](double q) { return latencies[static_cast<std::size_t>(q * static_cast<double>(latencies.size() - 1))]; };
+        std::cout << std::setw(16) << name << std::fixed << std::setprecision(1) << std::setw(10) << latencies.size()
+                  << std::setw(10) << at(0.5) << std::setw(10) << at(0.99) << std::setw(10) << at(0.999)
+                  << std::setw(12) << latencies.back() << std::setw(10) << slow << "\n";
+    }
+}
+
+int main()
+{
+    std::cout << hot_keys << " hot keys, TTL 100ms, loader 2ms; get() latency in us\n";
+    std::cout << std::setw(16) << "mode" << std::setw(10) << "gets" << std::setw(10) << "p50" << std::setw(10) << "p99"
+              << std::setw(10) << "p99.9" << std::setw(12) << "max" << std::setw(10) << ">=1ms" << "\n";
+    report("expire only", {.shards = 4, .expiry = Expiry::after_write(ttl)});
+    report("refresh at 80%", {.shards = 4, .expiry = Expiry::after_write(ttl), .refresh_after = ttl * 8 / 10});
+    return 0;
+}
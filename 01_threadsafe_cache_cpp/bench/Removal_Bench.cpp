@@ -0,0 +1,71 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "../ThreadSafeCache.h"
+
+// put() cost on an LRU cache that evicts on every insert, without a removal listener and with
+// one that takes `listener_ns` per event. The listener runs on the cache's own thread, so the
+// writers only pay for queueing the event; "drain ms" is how long it then takes to catch up.
+// Usage: Removal_Bench [threads] [listener ns] (defaults 4 and 1000)
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr std::uint64_t puts_per_thread = 200'000;
+
+    void spin(std::chrono::nanoseconds for_how_long) {
+        const auto until = Clock::now() + for_how_long;
+        while (Clock::now() < until) {
+        }
+    }
+
+    void report(const char* name, std::size_t threads, long listener_ns) {
+        std::atomic<std::uint64_t> delivered{0};
+        ThreadSafeCache<std::uint64_t, std::uint64_t, LruEviction> cache(nullptr, {.shards = 16, .max_entries = 10'000});
+        if (listener_ns >= 0) {
+            cache.set_removal_listener([&](const std::uint64_t&, const std::uint64_t&, RemovalCause) {
+                spin(std::chrono::nanoseconds(listener_ns));
+                delivered.fetch_add(1, std::memory_order_relaxed);
+            });
+        }
+
+        const auto start = Clock::now();
+        std::vector<std::thread> writers;
+        for (std::size_t t = 0; t < threads; ++t) {
+            writers.emplace_back([&, t] {
+                for (std::uint64_t i = 0; i < puts_per_thread; ++i) cache.put(t * puts_per_thread + i, i);
+            });
+        }
+        for (auto& writer : writers) writer.join();
+        const auto written = Clock::now();
+        const auto expected = threads * puts_per_thread - cache.size();
+        while (listener_ns >= 0 && delivered.load() < expected) std::this_thread::sleep_for(std::chrono::microseconds(100));
+        const auto drained = Clock::now();
+
+        const auto puts = static_cast<double>(threads * puts_per_thread);
+        std::cout << std::setw(12) << name << std::fixed << std::setprecision(1) << std::setw(12)
+                  << std::chrono::duration<double, std::nano>(written - start).count() / puts << std::setw(12)
+                  << delivered.load() << std::setw(12) << std::chrono::duration<double, std::milli>(drained - written).count()
+                  << "\n";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::size_t threads = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4;
+    const long listener_ns = argc > 2 ? std::strtol(argv[2], nullptr, 10) : 1000;
+
+    std::cout << threads << " writers x " << puts_per_thread << " new keys, LRU holding 10000, 16 shards; "
+              << "listener " << listener_ns << " ns per event\n";
+    std::cout << std::setw(12) << "listener" << std::setw(12) << "ns/put" << std::setw(12) << "events"
+              << std::setw(12) << "drain ms" << "\n";
+    report("none", threads, -1);
+    report("empty", threads, 0);
+    report("slow", threads, listener_ns);
+    return 0;
+}
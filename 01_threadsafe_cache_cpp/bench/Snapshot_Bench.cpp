@@ -0,0 +1,60 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "../ThreadSafeCache.h"
+
+// save() and load() of a full cache: uint64 -> 16-byte payload (fixed-size records) and
+// string -> string (codec-encoded). The snapshot goes to out/, next to the bench binaries.
+// Usage: Snapshot_Bench [entries] (default 2000000)
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Payload {
+        std::uint64_t a, b;
+    };
+
+    auto seconds_since(Clock::time_point start) -> double {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    template<typename Cache, typename Fill>
+    void report(const char* name, std::size_t entries, Fill fill) {
+        const std::string path = "out/snapshot_bench.bin";
+        Cache source(nullptr, {.shards = 64});
+        for (std::size_t i = 0; i < entries; ++i) fill(source, i);
+
+        auto start = Clock::now();
+        source.save(path);
+        const auto save_s = seconds_since(start);
+
+        Cache warm(nullptr, {.shards = 64});
+        start = Clock::now();
+        warm.load(path);
+        const auto load_s = seconds_since(start);
+        std::remove(path.c_str());
+
+        std::cout << std::setw(16) << name << std::fixed << std::setprecision(3) << std::setw(10) << save_s
+                  << std::setw(10) << load_s << std::setw(14) << std::setprecision(2)
+                  << static_cast<double>(entries) / load_s / 1e6 << "\n";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::size_t entries = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2'000'000;
+    std::cout << entries << " entries, 64 shards, NodeStorage\n";
+    std::cout << std::setw(16) << "types" << std::setw(10) << "save s" << std::setw(10) << "load s"
+              << std::setw(14) << "load M/s" << "\n";
+    report<ThreadSafeCache<std::uint64_t, Payload>>("u64 -> 16 B", entries, [](auto& cache, std::size_t i) {
+        cache.put(i, Payload{i, ~i});
+    });
+    report<ThreadSafeCache<std::string, std::string>>("string -> string", entries, [](auto& cache, std::size_t i) {
+        cache.put("user:" + std::to_string(i), "profile-" + std::to_string(i * 7));
+    });
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+#include "../ThreadSafeCache.h"
+
+// Cost of the CacheStats policy on the hit path: the same warm cache read by 1..N threads, with
+// and without stats. The key set fits in L2, so the bookkeeping is not hidden behind cache
+// misses; each configuration is run a few times, interleaved, and the best run is kept.
+// With NoStats the recorder calls are empty.
+// Usage: Stats_Bench [max threads] (default 4)
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int keys = 10'000;
+    constexpr int rounds = 3;
+    constexpr int gets_per_thread = 2'000'000;
+
+    template<typename Stats>
+    auto hit_ns(int threads) -> double {
+        ThreadSafeCache<int, int, LruEviction, NodeStorage, NoExpiration, Stats> cache(
+            [](int key) { return key; }, {.shards = 16, .max_entries = 2 * keys});   // headroom: every get hits
+        for (int key = 0; key < keys; ++key) cache.get(key);
+
+        std::vector<std::thread> readers;
+        std::atomic<std::int64_t> sink{0};
+        const auto start = Clock::now();
+        for (int t = 0; t < threads; ++t) {
+            readers.emplace_back([&cache, &sink, t] {
+                std::mt19937 rng(static_cast<unsigned>(t));
+                std::int64_t sum = 0;
+                for (int i = 0; i < gets_per_thread; ++i) sum += *cache.get(static_cast<int>(rng() % keys));
+                sink += sum;
+            });
+        }
+        for (auto& reader : readers) reader.join();
+        const auto elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        return elapsed / gets_per_thread;   // wall time per get on each thread
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const int max_threads = argc > 1 ? std::atoi(argv[1]) : 4;
+    std::cout << "Warm get() hits, " << keys << " keys, LRU, 16 shards; ns per get per thread\n";
+    std::cout << std::setw(8) << "threads" << std::setw(12) << "NoStats" << std::setw(12) << "CacheStats" << "\n";
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        double off = 1e9, on = 1e9;
+        for (int round = 0; round < rounds; ++round) {
+            off = std::min(off, hit_ns<NoStats>(threads));
+            on = std::min(on, hit_ns<CacheStats>(threads));
+        }
+        std::cout << std::fixed << std::setprecision(2) << std::setw(8) << threads << std::setw(12) << off
+                  << std::setw(12) << on << "\n";
+    }
+    return 0;
+}
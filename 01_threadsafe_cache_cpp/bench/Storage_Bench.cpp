@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <malloc.h>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#include "../ThreadSafeCache.h"
+
+// Compares shard storage backends head to head: insert throughput, hit/miss lookup latency
+// and heap bytes per entry. Usage: Storage_Bench [entries] (default 1'000'000)
+
+namespace {
+    // Heap accounting through the replaced global operator new/delete. Counts usable block
+    // sizes, so malloc's size-class rounding is included but its per-block header is not.
+    std::size_t live_bytes = 0;
+}
+
+// noinline keeps GCC from pairing the inlined malloc/free with new/delete and warning
+[[gnu::noinline]] void* operator new(std::size_t size) {
+    void* block = std::malloc(size);
+    if (!block) throw std::bad_alloc{};
+    live_bytes += malloc_usable_size(block);
+    return block;
+}
+
+[[gnu::noinline]] void operator delete(void* pointer) noexcept {
+    if (!pointer) return;
+    live_bytes -= malloc_usable_size(pointer);
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept { operator delete(pointer); }
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Stand-in for the cache's per-entry payload: a value plus an eviction handle
+    struct Payload {
+        std::uint64_t value;
+        std::uint32_t handle;
+    };
+
+    template<typename Storage>
+    void run(const char* name, const std::vector<std::uint64_t>& keys, const std::vector<std::uint64_t>& absent) {
+        const auto before = live_bytes;
+        auto* table = new typename Storage::template Table<std::uint64_t, Payload>();
+        const auto hash = [](std::uint64_t key) { return std::hash<std::uint64_t>{}(key); };
+
+        auto start = Clock::now();
+        for (auto key : keys) table->try_emplace(key, hash(key), Payload{key, 0});
+        const double insert_s = std::chrono::duration<double>(Clock::now() - start).count();
+        const double bytes_per_entry = static_cast<double>(live_bytes - before) / static_cast<double>(keys.size());
+
+        // Lookups in a different order than inserts, so neither backend gets a locality gift
+        std::vector<std::uint64_t> probes(keys);
+        std::shuffle(probes.begin(), probes.end(), std::mt19937_64{7});
+        std::uint64_t checksum = 0;
+        start = Clock::now();
+        for (auto key : probes) checksum += table->find(key, hash(key))->value;
+        const double hit_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / static_cast<double>(probes.size());
+
+        start = Clock::now();
+        for (auto key : absent) checksum += table->find(key, hash(key)) != nullptr;
+        const double miss_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / static_cast<double>(absent.size());
+
+        delete table;
+        std::cout << std::setw(14) << name << std::fixed << std::setprecision(2)
+                  << std::setw(16) << static_cast<double>(keys.size()) / insert_s / 1e6
+                  << std::setw(14) << hit_ns << std::setw(14) << miss_ns
+                  << std::setw(16) << bytes_per_entry
+                  << "   (checksum " << checksum % 1000 << ")\n";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::size_t entries = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+    std::mt19937_64 rng{42};
+    std::vector<std::uint64_t> keys(entries);
+    std::vector<std::uint64_t> absent(entries);
+    for (auto& key : keys) key = rng() | 1;      // odd keys are present
+    for (auto& key : absent) key = rng() & ~1ull; // even keys never are
+
+    std::cout << "Storage backends, " << entries << " entries of uint64 -> 16-byte payload\n";
+    std::cout << std::setw(14) << "backend" << std::setw(16) << "insert Mops/s" << std::setw(14) << "hit ns/op"
+              << std::setw(14) << "miss ns/op" << std::setw(16) << "heap B/entry" << "\n";
+    run<NodeStorage>("NodeStorage", keys, absent);
+    run<FlatStorage>("FlatStorage", keys, absent);
+    run<ConcurrentStorage>("Concurrent", keys, absent);
+    return 0;
+}
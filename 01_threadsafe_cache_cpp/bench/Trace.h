@@ -0,0 +1,105 @@
+    #pragma once
+
+    #include <algorithm>
+    #include <cerrno>
+    #include <charconv>
+    #include <cstdint>
+    #include <functional>
+    #include <optional>
+    #include <span>
+    #include <string>
+    #include <string_view>
+    #include <system_error>
+    #include <vector>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+
+    // Key trace reading for the trace-driven drivers
+
+    // Read-only private mapping of a whole file
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::string& path) {
+            const int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) throw std::system_error(errno, std::generic_category(), "open " + path);
+            struct stat info {};
+            if (::fstat(fd, &info) != 0) {
+                const int error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::generic_category(), "stat " + path);
+            }
+            size_ = static_cast<std::size_t>(info.st_size);
+            if (size_ != 0) {
+                data_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data_ == MAP_FAILED) {
+                    const int error = errno;
+                    ::close(fd);
+                    throw std::system_error(error, std::generic_category(), "mmap " + path);
+                }
+                ::madvise(data_, size_, MADV_SEQUENTIAL);
+            }
+            ::close(fd);   // the mapping keeps the file open
+        }
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile() {
+            if (size_ != 0) ::munmap(data_, size_);
+        }
+
+        auto bytes() const noexcept -> std::string_view { return {static_cast<const char*>(data_), size_}; }
+
+    private:
+        void* data_ = nullptr;
+        std::size_t size_ = 0;
+    };
+
+    // Hands out the trace as consecutive chunks of keys. Binary traces are chunks of the mapping
+    // itself; text traces are parsed into the caller's buffer, one chunk at a time.
+    class Trace {
+    public:
+        static constexpr std::size_t chunk_keys = 1 << 16;
+
+        static auto binary(std::span<const std::uint64_t> keys) -> Trace { return Trace{keys, {}}; }
+        static auto text(std::string_view lines) -> Trace { return Trace{{}, lines}; }
+
+        template<typename Fn>
+        void for_each_chunk(Fn&& fn) const {
+            if (text_.empty()) {
+                for (std::size_t begin = 0; begin < keys_.size(); begin += chunk_keys) {
+                    fn(keys_.subspan(begin, std::min(chunk_keys, keys_.size() - begin)));
+                }
+                return;
+            }
+            std::vector<std::uint64_t> buffer;
+            buffer.reserve(chunk_keys);
+            for (std::size_t at = 0; at < text_.size();) {
+                auto end = text_.find('\n', at);
+                if (end == std::string_view::npos) end = text_.size();
+                if (const auto key = parse_line(text_.substr(at, end - at))) buffer.push_back(*key);
+                at = end + 1;
+                if (buffer.size() == chunk_keys) {
+                    fn(std::span<const std::uint64_t>(buffer));
+                    buffer.clear();
+                }
+            }
+            if (!buffer.empty()) fn(std::span<const std::uint64_t>(buffer));
+        }
+
+    private:
+        Trace(std::span<const std::uint64_t> keys, std::string_view text) : keys_(keys), text_(text) {}
+
+        static auto parse_line(std::string_view line) -> std::optional<std::uint64_t> {
+            const auto begin = line.find_first_not_of(" \t\r");
+            if (begin == std::string_view::npos || line[begin] == '#') return std::nullopt;
+            const auto token = line.substr(begin, line.find_first_of(" \t\r,", begin) - begin);
+            std::uint64_t key = 0;
+            const auto [end, error] = std::from_chars(token.data(), token.data() + token.size(), key);
+            if (error == std::errc{} && end == token.data() + token.size()) return key;
+            return std::hash<std::string_view>{}(token);
+        }
+
+        std::span<const std::uint64_t> keys_;
+        std::string_view text_;
+    };
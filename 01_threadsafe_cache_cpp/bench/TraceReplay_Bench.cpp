@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include "../ThreadSafeCache.h"
+#include "Trace.h"
+#include "Workload.h"
+
+// Trace-driven hit-ratio simulator: replays a recorded key trace through one cache per
+// (policy, capacity) pair and prints the hit-ratio curve of each policy.
+//
+// The trace is memory-mapped and streamed in chunks, so its size is bounded by the address
+// space, not by RAM. The configurations are split across worker threads; each worker makes a
+// single pass over the trace and feeds every chunk to each of its caches in turn, so a chunk
+// is read from memory once per worker while it is still in the CPU cache.
+//
+// Usage: TraceReplay_Bench [--option=value ...]
+//   --trace=PATH           trace file; without one a zipf(0.99) trace of 2M requests over 1M keys is used
+//   --format=bin|text      bin: packed native-endian uint64 keys; text: one key per line, the first
+//                          token of the line (decimal, or any other string, which is hashed);
+//                          '#' lines are skipped (default: bin for *.bin, text otherwise)
+//   --policies=a,b,...     lru, clock, s3fifo, tinylfu, tinylfu-clock, tinylfu-s3 (default: all)
+//   --capacities=a,b,...   entries (default 1000,10000,100000,1000000)
+//   --shards=N             shards per cache (default 1, so capacity is exact)
+//   --warmup=N             requests replayed before hits are counted (default 0)
+//   --jobs=N               worker threads (default: hardware threads)
+//   --output=table|csv
+//   --write-synthetic=PATH write the synthetic trace as a bin file and exit; not with --trace
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Config {
+        std::string trace;
+        std::string format;
+        std::vector<std::string> policies = {"lru", "clock", "s3fifo", "tinylfu", "tinylfu-clock", "tinylfu-s3"};
+        std::vector<std::size_t> capacities = {1'000, 10'000, 100'000, 1'000'000};
+        std::size_t shards = 1;
+        std::uint64_t warmup = 0;
+        std::size_t jobs = std::max(1u, std::thread::hardware_concurrency());
+        std::string output = "table";
+        std::string write_synthetic;
+    };
+
+    // One cache under test. A hit is a with() that finds the key (which also counts as an access
+    // for the policy); a miss puts it, as a loading get() would, without the single-flight
+    // bookkeeping a one-thread replay does not need.
+    class Simulation {
+    public:
+        Simulation(std::string policy, std::size_t capacity) : policy_(std::move(policy)), capacity_(capacity) {}
+        virtual ~Simulation() = default;
+
+        void replay(std::span<const std::uint64_t> keys, bool counted) {
+            const auto misses = replay_misses(keys);
+            if (!counted) return;
+            requests_ += keys.size();
+            misses_ += misses;
+        }
+
+        auto policy() const -> const std::string& { return policy_; }
+        auto capacity() const noexcept { return capacity_; }
+        auto requests() const noexcept { return requests_; }
+        auto misses() const noexcept { return misses_; }
+        auto hit_ratio() const noexcept -> double {
+            return requests_ == 0 ? 0.0 : 1.0 - static_cast<double>(misses_) / static_cast<double>(requests_);
+        }
+
+    private:
+        virtual auto replay_misses(std::span<const std::uint64_t> keys) -> std::uint64_t = 0;
+
+        std::string policy_;
+        std::size_t capacity_;
+        std::uint64_t requests_ = 0;
+        std::uint64_t misses_ = 0;
+    };
+
+    template<typename Eviction>
+    class CacheSimulation final : public Simulation {
+    public:
+        CacheSimulation(std::string policy, std::size_t capacity, std::size_t shards)
+            : Simulation(std::move(policy), capacity), cache_(nullptr, {.shards = shards, .max_entries = capacity}) {}
+
+    private:
+        auto replay_misses(std::span<const std::uint64_t> keys) -> std::uint64_t override {
+            std::uint64_t misses = 0;
+            for (const auto key : keys) {
+                if (cache_.with(key, [](std::uint8_t) {})) continue;
+                cache_.put(key, std::uint8_t{1});
+                ++misses;
+            }
+            return misses;
+        }
+
+        ThreadSafeCache<std::uint64_t, std::uint8_t, Eviction, FlatStorage> cache_;
+    };
+
+    auto make_simulation(const std::string& policy, std::size_t capacity, std::size_t shards) -> std::unique_ptr<Simulation> {
+        if (policy == "lru") return std::make_unique<CacheSimulation<LruEviction>>(policy, capacity, shards);
+        if (policy == "clock") return std::make_unique<CacheSimulation<ClockEviction>>(policy, capacity, shards);
+        if (policy == "s3fifo") return std::make_unique<CacheSimulation<S3FifoEviction>>(policy, capacity, shards);
+        if (policy == "tinylfu") return std::make_unique<CacheSimulation<TinyLfuAdmission<LruEviction>>>(policy, capacity, shards);
+        if (policy == "tinylfu-clock") return std::make_unique<CacheSimulation<TinyLfuAdmission<ClockEviction>>>(policy, capacity, shards);
+        if (policy == "tinylfu-s3") return std::make_unique<CacheSimulation<TinyLfuAdmission<S3FifoEviction>>>(policy, capacity, shards);
+        return nullptr;
+    }
+
+    // Each worker streams the whole trace once, feeding every chunk to its own simulations
+    void replay(const Trace& trace, std::vector<std::unique_ptr<Simulation>>& simulations, const Config& config) {
+        const auto workers = std::min(config.jobs, simulations.size());
+        // Largest caches first, dealt round-robin, so the workers get similar amounts of work
+        std::vector<Simulation*> order;
+        for (auto& simulation : simulations) order.push_back(simulation.get());
+        std::stable_sort(order.begin(), order.end(), [](auto* a, auto* b) { return a->capacity() > b->capacity(); });
+
+        std::vector<std::thread> threads;
+        for (std::size_t w = 0; w < workers; ++w) {
+            threads.emplace_back([&, w] {
+                std::vector<Simulation*> mine;
+                for (auto i = w; i < order.size(); i += workers) mine.push_back(order[i]);
+                std::uint64_t position = 0;
+                trace.for_each_chunk([&](std::span<const std::uint64_t> chunk) {
+                    // Split the chunk that straddles the end of the warm-up
+                    const auto warm = static_cast<std::size_t>(std::min<std::uint64_t>(
+                        chunk.size(), config.warmup > position ? config.warmup - position : 0));
+                    for (auto* simulation : mine) {
+                        if (warm != 0) simulation->replay(chunk.first(warm), false);
+                        if (warm != chunk.size()) simulation->replay(chunk.subspan(warm), true);
+                    }
+                    position += chunk.size();
+                });
+            });
+        }
+        for (auto& thread : threads) thread.join();
+    }
+
+    void print(const Config& config, const std::vector<std::unique_ptr<Simulation>>& simulations) {
+        const auto find = [&](const std::string& policy, std::size_t capacity) -> const Simulation& {
+            return **std::ranges::find_if(simulations, [&](const auto& s) { return s->policy() == policy && s->capacity() == capacity; });
+        };
+        if (config.output == "csv") {
+            std::cout << "policy,capacity,requests,misses,hit_ratio\n";
+            for (const auto& policy : config.policies) {
+                for (const auto capacity : config.capacities) {
+                    const auto& s = find(policy, capacity);
+                    std::cout << policy << "," << capacity << "," << s.requests() << "," << s.misses() << ","
+                              << std::setprecision(6) << s.hit_ratio() << "\n";
+                }
+            }
+            return;
+        }
+        std::cout << std::setw(10) << "capacity";
+        for (const auto& policy : config.policies) std::cout << std::setw(15) << policy;
+        std::cout << "\n" << std::fixed << std::setprecision(4);
+        for (const auto capacity : config.capacities) {
+            std::cout << std::setw(10) << capacity;
+            for (const auto& policy : config.policies) std::cout << std::setw(15) << find(policy, capacity).hit_ratio();
+            std::cout << "\n";
+        }
+    }
+
+    auto synthetic_trace() -> std::vector<std::uint64_t> {
+        ZipfGenerator zipf{1'000'000, 0.99};
+        std::mt19937_64 rng{42};
+        std::vector<std::uint64_t> keys(2'000'000);
+        for (auto& key : keys) key = zipf(rng);
+        return keys;
+    }
+
+    [[noreturn]] void usage(const std::string& problem) {
+        std::cerr << "TraceReplay_Bench: " << problem << " (options are listed at the top of TraceReplay_Bench.cpp)\n";
+        std::exit(2);
+    }
+
+    template<typename T>
+    auto split(const std::string& list) -> std::vector<T> {
+        std::vector<T> items;
+        std::istringstream in(list);
+        for (std::string item; std::getline(in, item, ',');) {
+            std::istringstream field(item);
+            T value{};
+            if (!(field >> value)) usage("bad list " + list);
+            items.push_back(value);
+        }
+        return items;
+    }
+
+    auto parse(int argc, char** argv) -> Config {
+        Config config;
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            const auto eq = arg.find('=');
+            if (arg.rfind("--", 0) != 0 || eq == std::string::npos) usage("bad option " + arg);
+            const auto name = arg.substr(2, eq - 2);
+            const auto value = arg.substr(eq + 1);
+            if (name == "trace") config.trace = value;
+            else if (name == "format") config.format = value;
+            else if (name == "policies") config.policies = split<std::string>(value);
+            else if (name == "capacities") config.capacities = split<std::size_t>(value);
+            else if (name == "shards") config.shards = std::strtoull(value.c_str(), nullptr, 10);
+            else if (name == "warmup") config.warmup = std::strtoull(value.c_str(), nullptr, 10);
+            else if (name == "jobs") config.jobs = std::strtoull(value.c_str(), nullptr, 10);
+            else if (name == "output") config.output = value;
+            else if (name == "write-synthetic") config.write_synthetic = value;
+            else usage("bad option " + arg);
+        }
+        if (config.format.empty()) config.format = config.trace.ends_with(".bin") ? "bin" : "text";
+        if (config.format != "bin" && config.format != "text") usage("unknown --format " + config.format);
+        if (config.output != "table" && config.output != "csv") usage("unknown --output " + config.output);
+        if (config.jobs == 0 || config.shards == 0) usage("--jobs and --shards must be positive");
+        if (!config.trace.empty() && !config.write_synthetic.empty()) usage("--write-synthetic cannot be combined with --trace");
+        if (config.policies.empty() || config.capacities.empty()) usage("no --policies or --capacities");
+        for (const auto& policy : config.policies) {
+            if (!make_simulation(policy, 1, 1)) usage("unknown policy " + policy);
+        }
+        return config;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const auto config = parse(argc, argv);
+    try {
+        std::vector<std::uint64_t> generated;
+        std::unique_ptr<MappedFile> file;
+        auto trace = Trace::binary({});
+        if (config.trace.empty()) {
+            generated = synthetic_trace();
+            if (!config.write_synthetic.empty()) {
+                std::ofstream out(config.write_synthetic, std::ios::binary);
+                out.write(reinterpret_cast<const char*>(generated.data()), static_cast<std::streamsize>(generated.size() * sizeof(std::uint64_t)));
+                if (!out) throw std::system_error(errno, std::generic_category(), "write " + config.write_synthetic);
+                return 0;
+            }
+            trace = Trace::binary(generated);
+        } else {
+            file = std::make_unique<MappedFile>(config.trace);
+            const auto bytes = file->bytes();
+            if (config.format == "bin") {
+                // mmap returns page-aligned memory; a trailing partial key is ignored
+                trace = Trace::binary({reinterpret_cast<const std::uint64_t*>(bytes.data()), bytes.size() / sizeof(std::uint64_t)});
+            } else {
+                trace = Trace::text(bytes);
+            }
+        }
+
+        std::vector<std::unique_ptr<Simulation>> simulations;
+        for (const auto& policy : config.policies) {
+            for (const auto capacity : config.capacities) simulations.push_back(make_simulation(policy, capacity, config.shards));
+        }
+        const auto start = Clock::now();
+        replay(trace, simulations, config);
+        const auto seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::cerr << (config.trace.empty() ? std::string("synthetic zipf(0.99)") : config.trace) << ": "
+                  << simulations.front()->requests() << " counted requests, " << simulations.size() << " configurations on "
+                  << std::min(config.jobs, simulations.size()) << " threads in " << std::fixed << std::setprecision(2)
+                  << seconds << "s\n";
+        print(config, simulations);
+    } catch (const std::exception& error) {
+        std::cerr << "TraceReplay_Bench: " << error.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
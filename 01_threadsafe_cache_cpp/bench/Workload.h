@@ -0,0 +1,103 @@
+    #pragma once
+
+    #include <algorithm>
+    #include <cmath>
+    #include <cstdint>
+    #include <random>
+
+    // Key generators shared by the benchmark drivers
+
+    // Zipfian ranks in [0, n) using the closed-form approximation from Gray et al.,
+    // "Quickly Generating Billion-Record Synthetic Databases" (also used by YCSB). theta must be
+    // in (0, 1): the approximation divides by 1 - theta.
+    class ZipfGenerator {
+    public:
+        ZipfGenerator(std::uint64_t n, double theta) : n_(n), theta_(theta) {
+            zetan_ = zeta(n, theta);
+            const double zeta2 = zeta(2, theta);
+            alpha_ = 1.0 / (1.0 - theta);
+            eta_ = (1.0 - std::pow(2.0 / static_cast<double>(n), 1.0 - theta)) / (1.0 - zeta2 / zetan_);
+        }
+
+        template<typename Rng>
+        std::uint64_t operator()(Rng& rng) {
+            const double u = std::uniform_real_distribution<double>{0.0, 1.0}(rng);
+            const double uz = u * zetan_;
+            if (uz < 1.0) return 0;
+            if (uz < 1.0 + std::pow(0.5, theta_)) return 1;
+            const auto rank = static_cast<std::uint64_t>(static_cast<double>(n_) * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+            return rank < n_ ? rank : n_ - 1;
+        }
+
+    private:
+        static double zeta(std::uint64_t n, double theta) {
+            double sum = 0;
+            for (std::uint64_t i = 1; i <= n; ++i) sum += 1.0 / std::pow(static_cast<double>(i), theta);
+            return sum;
+        }
+
+        std::uint64_t n_;
+        double theta_;
+        double zetan_ = 0;
+        double alpha_ = 0;
+        double eta_ = 0;
+    };
+
+    // Zipfian traffic interrupted by sequential scans over keys that are never seen again,
+    // the pattern that flushes a pure-recency cache (batch jobs, crawlers, full exports).
+    class ScanMixGenerator {
+    public:
+        ScanMixGenerator(std::uint64_t n, double theta, std::uint64_t scan_length, double scan_probability)
+            : zipf_(n, theta), scan_base_(n), scan_length_(scan_length), scan_probability_(scan_probability) {}
+
+        template<typename Rng>
+        std::uint64_t operator()(Rng& rng) {
+            if (scan_left_ == 0 && std::bernoulli_distribution{scan_probability_}(rng)) scan_left_ = scan_length_;
+            if (scan_left_ > 0) {
+                --scan_left_;
+                return scan_base_++;
+            }
+            return zipf_(rng);
+        }
+
+    private:
+        ZipfGenerator zipf_;
+        std::uint64_t scan_base_;
+        std::uint64_t scan_length_;
+        double scan_probability_;
+        std::uint64_t scan_left_ = 0;
+    };
+
+    // Uniform keys in [0, n)
+    class UniformGenerator {
+    public:
+        explicit UniformGenerator(std::uint64_t n) : keys_(0, n - 1) {}
+
+        template<typename Rng>
+        std::uint64_t operator()(Rng& rng) { return keys_(rng); }
+
+    private:
+        std::uniform_int_distribution<std::uint64_t> keys_;
+    };
+
+    // A hot set of hot_fraction of the keys takes hot_probability of the requests (e.g. 1% of
+    // keys, 90% of traffic); both sets are uniform inside
+    class HotspotGenerator {
+    public:
+        HotspotGenerator(std::uint64_t n, double hot_fraction, double hot_probability)
+            : hot_(std::max<std::uint64_t>(1, static_cast<std::uint64_t>(static_cast<double>(n) * hot_fraction))),
+              n_(n), hot_probability_(hot_probability) {}
+
+        template<typename Rng>
+        std::uint64_t operator()(Rng& rng) {
+            if (hot_ >= n_ || std::bernoulli_distribution{hot_probability_}(rng)) {
+                return std::uniform_int_distribution<std::uint64_t>{0, hot_ - 1}(rng);
+            }
+            return std::uniform_int_distribution<std::uint64_t>{hot_, n_ - 1}(rng);
+        }
+
+    private:
+        std::uint64_t hot_;
+        std::uint64_t n_;
+        double hot_probability_;
+    };
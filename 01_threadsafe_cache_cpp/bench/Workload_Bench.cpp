@@ -0,0 +1,272 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <initializer_list>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+#include "../ThreadSafeCache.h"
+#include "Workload.h"
+
+// Closed-loop load generator: 1..N threads run a read/write/erase mix against one cache for a
+// fixed time, every operation timed. Prints one record per thread count as JSON lines (default)
+// or CSV, so runs before and after a change can be diffed or plotted.
+//
+// Usage: Workload_Bench [--option=value ...]
+//   --threads=N            thread counts 1, 2, 4, ... up to N (default: hardware threads)
+//   --mix=R:W:E            read/put/erase percentages (default 90:8:2)
+//   --dist=D               uniform | zipf[:theta] | hotspot[:hot_fraction:hot_probability]
+//                          (default zipf:0.99; hotspot defaults to 0.01:0.9; theta in (0, 1), the others in [0, 1])
+//   --keys=N               key space (default 1000000)
+//   --capacity=N           max_entries (default 100000)
+//   --shards=N             (default: CacheOptions default)
+//   --policy=P             lru | clock | s3fifo | tinylfu (default tinylfu)
+//   --storage=S            node | flat | concurrent (default node)
+//   --load-us=N            loader latency per miss; spins below 100us, sleeps above (default 0)
+//   --duration-ms=N        per thread count (default 1000)
+//   --prefill=0|1          put keys [0, capacity) first (default 1)
+//   --format=json|csv
+//
+// Latencies include the two clock reads around each operation. The hit ratio is
+// 1 - loader calls / reads, so a read that waited on another thread's load counts as a hit.
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Config {
+        std::size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+        unsigned read_pct = 90;
+        unsigned write_pct = 8;
+        unsigned erase_pct = 2;
+        std::string dist = "zipf";
+        double theta = 0.99;
+        double hot_fraction = 0.01;
+        double hot_probability = 0.9;
+        std::uint64_t keys = 1'000'000;
+        std::size_t capacity = 100'000;
+        std::size_t shards = CacheOptions{}.shards;
+        std::string policy = "tinylfu";
+        std::string storage = "node";
+        std::chrono::microseconds load_latency{0};
+        std::chrono::milliseconds duration{1000};
+        bool prefill = true;
+        std::string format = "json";
+
+        auto dist_name() const -> std::string {
+            std::ostringstream name;
+            if (dist == "zipf") name << "zipf:" << theta;
+            else if (dist == "hotspot") name << "hotspot:" << hot_fraction << ":" << hot_probability;
+            else name << dist;
+            return name.str();
+        }
+    };
+
+    struct Result {
+        std::size_t threads = 0;
+        std::uint64_t ops = 0;
+        std::uint64_t reads = 0;
+        std::uint64_t loads = 0;
+        double seconds = 0;
+        LatencySnapshot latency;
+    };
+
+    using KeyGenerator = std::variant<UniformGenerator, ZipfGenerator, HotspotGenerator>;
+
+    auto make_generator(const Config& config) -> KeyGenerator {
+        if (config.dist == "uniform") return UniformGenerator{config.keys};
+        if (config.dist == "hotspot") return HotspotGenerator{config.keys, config.hot_fraction, config.hot_probability};
+        return ZipfGenerator{config.keys, config.theta};
+    }
+
+    void simulate_load(std::chrono::microseconds latency) {
+        if (latency.count() == 0) return;
+        if (latency >= std::chrono::microseconds(100)) {
+            std::this_thread::sleep_for(latency);
+            return;
+        }
+        const auto until = Clock::now() + latency;   // sleep_for overshoots short waits by ~50us
+        while (Clock::now() < until) {}
+    }
+
+    template<typename Eviction, typename Storage>
+    auto run(const Config& config, std::size_t threads, const KeyGenerator& keys) -> Result {
+        std::atomic<std::uint64_t> loads{0};
+        ThreadSafeCache<std::uint64_t, std::uint64_t, Eviction, Storage> cache(
+            [&](std::uint64_t key) {
+                loads.fetch_add(1, std::memory_order_relaxed);
+                simulate_load(config.load_latency);
+                return key;
+            },
+            {.shards = config.shards, .max_entries = config.capacity});
+        if (config.prefill) {
+            for (std::uint64_t key = 0; key < std::min<std::uint64_t>(config.capacity, config.keys); ++key) cache.put(key, key);
+        }
+
+        std::atomic<bool> go{false};
+        std::atomic<bool> stop{false};
+        std::atomic<std::uint64_t> sink{0};
+        std::vector<Result> partial(threads);
+        std::vector<std::thread> workers;
+        for (std::size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                auto generator = keys;
+                std::mt19937_64 rng{t + 1};
+                std::uniform_int_distribution<unsigned> percent{0, 99};
+                auto& mine = partial[t];
+                std::uint64_t checksum = 0;
+                while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+                while (!stop.load(std::memory_order_relaxed)) {
+                    const auto key = std::visit([&](auto& g) { return g(rng); }, generator);
+                    const auto op = percent(rng);
+                    const auto start = Clock::now();
+                    if (op < config.read_pct) {
+                        checksum += cache.get(key).value_or(0);
+                        ++mine.reads;
+                    } else if (op < config.read_pct + config.write_pct) {
+                        cache.put(key, key);
+                    } else {
+                        cache.erase(key);
+                    }
+                    const auto ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+                    ++mine.latency.buckets[LatencySnapshot::index_of(ns)];
+                    mine.latency.total_ns += ns;
+                    ++mine.ops;
+                }
+                sink += checksum;
+            });
+        }
+
+        const auto start = Clock::now();
+        go.store(true, std::memory_order_release);
+        std::this_thread::sleep_for(config.duration);
+        stop = true;
+        for (auto& worker : workers) worker.join();
+
+        Result total;
+        total.threads = threads;
+        total.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        for (const auto& part : partial) {
+            total.ops += part.ops;
+            total.reads += part.reads;
+            total.latency.total_ns += part.latency.total_ns;
+            for (std::size_t i = 0; i < LatencySnapshot::bucket_count; ++i) total.latency.buckets[i] += part.latency.buckets[i];
+        }
+        total.latency.count = total.ops;
+        total.loads = loads.load();
+        return total;
+    }
+
+    template<typename Eviction>
+    auto run_with_storage(const Config& config, std::size_t threads, const KeyGenerator& keys) -> Result {
+        if (config.storage == "flat") return run<Eviction, FlatStorage>(config, threads, keys);
+        if (config.storage == "concurrent") return run<Eviction, ConcurrentStorage>(config, threads, keys);
+        return run<Eviction, NodeStorage>(config, threads, keys);
+    }
+
+    auto run_config(const Config& config, std::size_t threads, const KeyGenerator& keys) -> Result {
+        if (config.policy == "lru") return run_with_storage<LruEviction>(config, threads, keys);
+        if (config.policy == "clock") return run_with_storage<ClockEviction>(config, threads, keys);
+        if (config.policy == "s3fifo") return run_with_storage<S3FifoEviction>(config, threads, keys);
+        return run_with_storage<TinyLfuAdmission<LruEviction>>(config, threads, keys);
+    }
+
+    void print(const Config& config, const Result& result, bool header) {
+        const auto ops_per_sec = static_cast<double>(result.ops) / result.seconds;
+        const auto hit_ratio = result.reads == 0 ? 0.0 : 1.0 - static_cast<double>(result.loads) / static_cast<double>(result.reads);
+        const auto ns = [&](double q) { return result.latency.percentile(q).count(); };
+        if (config.format == "csv") {
+            if (header) {
+                std::cout << "threads,policy,storage,dist,keys,capacity,read_pct,write_pct,erase_pct,load_us,"
+                             "ops,seconds,ops_per_sec,p50_ns,p99_ns,p999_ns,max_ns,hit_ratio\n";
+            }
+            std::cout << result.threads << "," << config.policy << "," << config.storage << "," << config.dist_name() << ","
+                      << config.keys << "," << config.capacity << "," << config.read_pct << "," << config.write_pct << ","
+                      << config.erase_pct << "," << config.load_latency.count() << "," << result.ops << ","
+                      << result.seconds << "," << ops_per_sec << "," << ns(0.5) << "," << ns(0.99) << "," << ns(0.999)
+                      << "," << result.latency.max().count() << "," << hit_ratio << "\n";
+            return;
+        }
+        std::cout << "{\"threads\":" << result.threads << ",\"policy\":\"" << config.policy << "\",\"storage\":\""
+                  << config.storage << "\",\"dist\":\"" << config.dist_name() << "\",\"keys\":" << config.keys
+                  << ",\"capacity\":" << config.capacity << ",\"read_pct\":" << config.read_pct << ",\"write_pct\":"
+                  << config.write_pct << ",\"erase_pct\":" << config.erase_pct << ",\"load_us\":"
+                  << config.load_latency.count() << ",\"ops\":" << result.ops << ",\"seconds\":" << result.seconds
+                  << ",\"ops_per_sec\":" << ops_per_sec << ",\"p50_ns\":" << ns(0.5) << ",\"p99_ns\":" << ns(0.99)
+                  << ",\"p999_ns\":" << ns(0.999) << ",\"max_ns\":" << result.latency.max().count()
+                  << ",\"hit_ratio\":" << hit_ratio << "}\n";
+    }
+
+    [[noreturn]] void usage(const std::string& problem) {
+        std::cerr << "Workload_Bench: " << problem << " (options are listed at the top of Workload_Bench.cpp)\n";
+        std::exit(2);
+    }
+
+    auto parse(int argc, char** argv) -> Config {
+        Config config;
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            const auto eq = arg.find('=');
+            if (arg.rfind("--", 0) != 0 || eq == std::string::npos) usage("bad option " + arg);
+            const auto name = arg.substr(2, eq - 2);
+            std::istringstream value(arg.substr(eq + 1));
+            char sep = 0;
+            if (name == "threads") value >> config.max_threads;
+            else if (name == "mix") value >> config.read_pct >> sep >> config.write_pct >> sep >> config.erase_pct;
+            else if (name == "dist") {
+                std::getline(value, config.dist, ':');
+                if (config.dist == "zipf") value >> config.theta;
+                if (config.dist == "hotspot") value >> config.hot_fraction >> sep >> config.hot_probability;
+                value.clear();
+                if (config.dist != "uniform" && config.dist != "zipf" && config.dist != "hotspot") usage("bad option " + arg);
+            }
+            else if (name == "keys") value >> config.keys;
+            else if (name == "capacity") value >> config.capacity;
+            else if (name == "shards") value >> config.shards;
+            else if (name == "policy") value >> config.policy;
+            else if (name == "storage") value >> config.storage;
+            else if (name == "load-us") { std::int64_t us = 0; value >> us; config.load_latency = std::chrono::microseconds(us); }
+            else if (name == "duration-ms") { std::int64_t ms = 0; value >> ms; config.duration = std::chrono::milliseconds(ms); }
+            else if (name == "prefill") value >> config.prefill;
+            else if (name == "format") value >> config.format;
+            else usage("bad option " + arg);
+            if (value.fail()) usage("bad option " + arg);
+        }
+        if (config.read_pct + config.write_pct + config.erase_pct != 100 || config.keys == 0 || config.max_threads == 0) {
+            usage("--mix must add up to 100; --keys and --threads must be positive");
+        }
+        const auto one_of = [](const std::string& value, std::initializer_list<const char*> allowed) {
+            return std::ranges::any_of(allowed, [&](const char* name) { return value == name; });
+        };
+        // ZipfGenerator's closed form divides by 1 - theta; a share outside [0, 1] is no share
+        if (config.dist == "zipf" && !(config.theta > 0 && config.theta < 1)) usage("zipf theta must be in (0, 1)");
+        if (config.dist == "hotspot" && !(config.hot_fraction >= 0 && config.hot_fraction <= 1 &&
+                                          config.hot_probability >= 0 && config.hot_probability <= 1)) {
+            usage("hotspot fraction and probability must be in [0, 1]");
+        }
+        if (!one_of(config.policy, {"lru", "clock", "s3fifo", "tinylfu"})) usage("unknown --policy " + config.policy);
+        if (!one_of(config.storage, {"node", "flat", "concurrent"})) usage("unknown --storage " + config.storage);
+        if (!one_of(config.format, {"json", "csv"})) usage("unknown --format " + config.format);
+        return config;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const auto config = parse(argc, argv);
+    const auto keys = make_generator(config);   // zipf's zeta sum is computed once, then copied per thread
+    std::cout << std::setprecision(6);
+    bool header = true;
+    for (std::size_t threads = 1;; threads = std::min(threads * 2, config.max_threads)) {
+        print(config, run_config(config, threads, keys), header);
+        header = false;
+        if (threads == config.max_threads) break;
+    }
+    return 0;
+}
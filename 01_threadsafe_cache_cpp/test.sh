@@ -0,0 +1,55 @@
+#!/bin/bash
+
+# ThreadSafe Cache Test Script
+# Builds every tests/*_Test.cpp twice, under AddressSanitizer + UBSan and under ThreadSanitizer,
+# and runs both; any failed check or sanitizer report fails the script
+# Usage: ./test.sh [Name ...] (all tests by default)
+
+echo "=== ThreadSafe Cache Test Script ==="
+echo ""
+
+# Creating out folder if not exists
+mkdir -p out/tests
+
+if [ $# -gt 0 ]; then
+    SOURCES=$(for NAME in "$@"; do echo "tests/${NAME}_Test.cpp"; done)
+else
+    SOURCES=$(ls tests/*_Test.cpp)
+fi
+
+export ASAN_OPTIONS=detect_leaks=1
+export UBSAN_OPTIONS=print_stacktrace=1
+export TSAN_OPTIONS=halt_on_error=1
+
+FAILED=0
+for SRC in $SOURCES; do
+    NAME=$(basename "$SRC" .cpp)
+    for MODE in asan tsan; do
+        if [ "$MODE" = asan ]; then
+            SANITIZE="-O1 -fsanitize=address,undefined -fno-sanitize-recover=all"
+        else
+            # TSan does not model standalone fences (the epoch pin); it still checks everything else
+            SANITIZE="-O1 -fsanitize=thread -Wno-tsan"
+        fi
+        # Warnings are errors here: the tests are the warning-clean build of every header
+        if ! g++ -std=c++23 -pthread -Wall -Wextra -Werror -g $SANITIZE "$SRC" -o "out/tests/${NAME}_$MODE"; then
+            echo "❌ $NAME ($MODE): compilation failed"
+            FAILED=1
+            continue
+        fi
+        if ./out/tests/${NAME}_$MODE > "out/tests/${NAME}_$MODE.log" 2>&1; then
+            echo "✅ $NAME ($MODE)"
+        else
+            echo "❌ $NAME ($MODE)"
+            tail -20 "out/tests/${NAME}_$MODE.log"
+            FAILED=1
+        fi
+    done
+done
+
+echo ""
+if [ $FAILED -ne 0 ]; then
+    echo "❌ Some tests failed"
+    exit 1
+fi
+echo "✅ All tests passed!"
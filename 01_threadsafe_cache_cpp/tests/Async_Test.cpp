@@ -0,0 +1,256 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "../ThreadSafeCache.h"
+#include "Check.h"
+
+// get_async: misses park their coroutine on the key's one flight and resume when it finishes,
+// with async or plain loaders, values or errors, off the finishing thread; the key is owned by
+// the task
+
+namespace {
+    using namespace std::chrono_literals;
+    using Clock = std::chrono::steady_clock;
+
+    // Resumes parked coroutines on its own thread once their delay has passed, like an async client
+    class Backend {
+    public:
+        ~Backend() {
+            {
+                std::lock_guard lock{mutex_};
+                stopping_ = true;
+            }
+            wake_.notify_one();
+            thread_.join();
+        }
+
+        auto sleep(std::chrono::microseconds delay) {
+            struct Awaiter {
+                Backend& backend;
+                std::chrono::microseconds delay;
+
+                bool await_ready() noexcept { return false; }
+                // Once queued, the waiter may resume and free this awaiter: only locals after that
+                void await_suspend(std::coroutine_handle<> waiter) {
+                    auto& owner = backend;
+                    {
+                        std::lock_guard lock{owner.mutex_};
+                        owner.due_.emplace(Clock::now() + delay, waiter);
+                    }
+                    owner.wake_.notify_one();
+                }
+                void await_resume() noexcept {}
+            };
+            return Awaiter{*this, delay};
+        }
+
+    private:
+        void run() {
+            std::unique_lock lock{mutex_};
+            for (;;) {
+                if (due_.empty()) {
+                    if (stopping_) return;
+                    wake_.wait(lock);
+                    continue;
+                }
+                const auto [at, waiter] = due_.top();
+                if (Clock::now() < at) {
+                    wake_.wait_until(lock, at);
+                    continue;
+                }
+                due_.pop();
+                lock.unlock();
+                waiter.resume();
+                lock.lock();
+            }
+        }
+
+        using Due = std::pair<Clock::time_point, std::coroutine_handle<>>;
+
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::priority_queue<Due, std::vector<Due>, std::greater<>> due_;
+        bool stopping_ = false;
+        std::thread thread_{[this] { run(); }};
+    };
+
+    std::atomic<int> finished{0};
+
+    cache_detail::Detached expect_value(CacheTask<std::optional<int>> task, int expected) {
+        const auto value = co_await std::move(task);
+        CHECK(value == expected);
+        ++finished;
+    }
+
+    cache_detail::Detached expect_error(CacheTask<std::optional<int>> task) {
+        try {
+            co_await std::move(task);
+            CHECK(false);
+        } catch (const std::runtime_error&) {
+            ++finished;
+        }
+    }
+
+    void wait_for(int count) {
+        while (finished < count) std::this_thread::sleep_for(1ms);
+        finished = 0;
+    }
+
+    void async_loader_serves_many_parked_gets() {
+        Backend backend;
+        std::atomic<int> loads{0};
+        ThreadSafeCache<int, int, LruEviction> cache([&](const int& key) -> CacheTask<int> {
+            ++loads;
+            co_await backend.sleep(2ms);
+            co_return key * 10;
+        }, {.shards = 8, .max_entries = 100'000});
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 2; ++t) {
+            threads.emplace_back([&] {
+                for (int key = 0; key < 2000; ++key) expect_value(cache.get_async(key), key * 10);
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        wait_for(4000);
+        CHECK(loads >= 2000 && loads <= 4000);
+        CHECK(cache.get(7) == 70 && sync_wait(cache.get_async(7)) == 70);
+        CHECK(cache.get(123'456) == 1'234'560);   // a blocking get runs the async loader to completion
+    }
+
+    void failures_reach_every_waiter() {
+        Backend backend;
+        ThreadSafeCache<int, int> cache([&](const int&) -> CacheTask<int> {
+            co_await backend.sleep(5ms);
+            throw std::runtime_error("backend down");
+        }, {.shards = 2});
+        for (int i = 0; i < 100; ++i) expect_error(cache.get_async(1));
+        wait_for(100);
+        CHECK_THROWS(sync_wait(cache.get_async(2)), std::runtime_error);
+        CHECK(!cache.contains(1));
+    }
+
+    void plain_and_async_loaders_mix_with_blocking_gets() {
+        ThreadSafeCache<int, int> plain([](int key) { return key + 1; });
+        CHECK(sync_wait(plain.get_async(4)) == 5);
+
+        Backend backend;
+        std::atomic<int> loads{0};
+        ThreadSafeCache<int, int> cache([&](const int& key) -> CacheTask<int> {
+            ++loads;
+            co_await backend.sleep(20ms);
+            co_return key;
+        });
+        expect_value(cache.get_async(9), 9);
+        std::this_thread::sleep_for(2ms);
+        CHECK(cache.get(9) == 9 && loads == 1);   // the blocking get joined the parked leader's flight
+        wait_for(1);
+    }
+
+    void async_failure_serves_stale() {
+        Backend backend;
+        std::atomic<int> loads{0};
+        ThreadSafeCache<int, SharedValue<std::string>, NoEviction, ConcurrentStorage, TimerWheelExpiration> cache(
+            [&](const int& key) -> CacheTask<std::string> {
+                co_await backend.sleep(1ms);
+                if (loads++ > 0) throw std::runtime_error("backend down");
+                co_return std::to_string(key);
+            }, {.shards = 2, .expiry = Expiry::after_write(30ms), .serve_stale_for = 1s});
+        CHECK(*sync_wait(cache.get_async(3)) == "3");
+        std::this_thread::sleep_for(40ms);
+        CHECK(*sync_wait(cache.get_async(3)) == "3");
+    }
+
+    cache_detail::Detached lead(ThreadSafeCache<int, int>& cache, std::atomic<bool>& done) {
+        const auto value = co_await cache.get_async(1);
+        CHECK(value == 1);
+        done = true;
+    }
+
+    // Blocks whichever thread resumes it until the leader is done, or gives up after 2s
+    cache_detail::Detached wait_for_leader(ThreadSafeCache<int, int>& cache, const std::atomic<bool>& leader_done) {
+        const auto value = co_await cache.get_async(1);
+        CHECK(value == 1);
+        const auto until = Clock::now() + 2s;
+        while (!leader_done && Clock::now() < until) std::this_thread::sleep_for(1ms);
+        CHECK(leader_done);
+        ++finished;
+    }
+
+    void blocked_waiter_does_not_hold_up_leader() {
+        Backend backend;
+        ThreadSafeCache<int, int> cache([&](const int& key) -> CacheTask<int> {
+            co_await backend.sleep(5ms);
+            co_return key;
+        });
+        std::atomic<bool> leader_done{false};
+        lead(cache, leader_done);
+        wait_for_leader(cache, leader_done);
+        wait_for(1);
+    }
+
+    void waiters_resume_through_the_scheduler() {
+        Backend backend;
+        std::mutex mutex;
+        std::vector<std::coroutine_handle<>> queued;
+        ThreadSafeCache<int, int> cache([&](const int& key) -> CacheTask<int> {
+            co_await backend.sleep(2ms);
+            co_return key;
+        }, {.scheduler = [&](std::coroutine_handle<> waiter) {
+            std::lock_guard lock{mutex};
+            queued.push_back(waiter);
+        }});
+        for (int i = 0; i < 10; ++i) expect_value(cache.get_async(3), 3);
+        wait_for(1);   // the leader, on the backend's thread
+        std::lock_guard lock{mutex};
+        CHECK(queued.size() == 9 && finished == 0);
+        for (auto waiter : queued) waiter.resume();
+        CHECK(finished == 9);
+        finished = 0;
+    }
+
+    CacheTask<void> read_into(ThreadSafeCache<int, int>& cache, int& out) {
+        out = *co_await cache.get_async(5);
+    }
+
+    CacheTask<void> fail_void() {
+        throw std::runtime_error("void task");
+        co_return;
+    }
+
+    void tasks_own_their_key_and_compose() {
+        Backend backend;
+        ThreadSafeCache<std::string, int> cache([&](const std::string& key) -> CacheTask<int> {
+            co_await backend.sleep(1ms);
+            co_return static_cast<int>(key.size());
+        });
+        auto task = cache.get_async(std::string(100, 'x'));   // the temporary key is gone before the await
+        CHECK(sync_wait(std::move(task)) == 100);
+
+        ThreadSafeCache<int, int> plain([](int key) { return key; });
+        int out = 0;
+        sync_wait(read_into(plain, out));
+        CHECK(out == 5);
+        CHECK_THROWS(sync_wait(fail_void()), std::runtime_error);
+    }
+}
+
+int main()
+{
+    async_loader_serves_many_parked_gets();
+    failures_reach_every_waiter();
+    plain_and_async_loaders_mix_with_blocking_gets();
+    async_failure_serves_stale();
+    blocked_waiter_does_not_hold_up_leader();
+    waiters_resume_through_the_scheduler();
+    tasks_own_their_key_and_compose();
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "../ThreadSafeCache.h"
+#include "Check.h"
+
+// Bulk calls: get_all answers in key order, hands every distinct missing key to one batch loader
+// call, and put_all stores pairs from any range; over each storage backend
+
+namespace {
+    using namespace std::chrono_literals;
+
+    template<typename Storage>
+    void batch_loader_gets_each_missing_key_once() {
+        std::atomic<int> calls{0};
+        std::atomic<int> loaded{0};
+        ThreadSafeCache<int, std::string, LruEviction, Storage> cache(nullptr, [&](std::span<const int> keys) {
+            ++calls;
+            loaded += static_cast<int>(keys.size());
+            std::vector<std::string> values;
+            for (int key : keys) values.push_back(std::to_string(key));
+            return values;
+        }, {.shards = 8, .max_entries = 1000});
+        cache.put(3, "three");
+        const std::vector<int> keys{1, 2, 3, 2, 5, 1, 9};
+        const auto first = cache.get_all(keys);
+        CHECK(first.size() == 7 && calls == 1 && loaded == 4);
+        CHECK(first[0] == "1" && first[1] == "2" && first[2] == "three" && first[3] == "2");
+        CHECK(first[4] == "5" && first[5] == "1" && first[6] == "9");
+        CHECK(cache.get_all(keys) == first && calls == 1);
+        CHECK(cache.get(42) == "42" && calls == 2);   // a single get goes through the batch loader
+        CHECK(cache.get_all(std::span<const int>{}).empty());
+    }
+
+    template<typename Storage>
+    void put_all_from_any_range() {
+        ThreadSafeCache<int, int, NoEviction, Storage> cache(nullptr);
+        cache.put_all(std::vector<std::pair<int, int>>{{1, 10}, {2, 20}, {1, 11}});   // the last pair wins
+        cache.put_all(std::map<int, int>{{7, 70}});
+        cache.put_all(std::vector<std::pair<int, int>>{});
+        const auto found = cache.get_all(std::vector<int>{1, 2, 3, 7});
+        CHECK(found[0] == 11 && found[1] == 20 && !found[2] && found[3] == 70);
+    }
+
+    template<typename Storage>
+    void single_loader_fills_in() {
+        std::atomic<int> loads{0};
+        ThreadSafeCache<int, int, NoEviction, Storage> cache([&](int key) {
+            ++loads;
+            return key * 2;
+        });
+        const auto found = cache.get_all(std::vector<int>{1, 2, 1});
+        CHECK(found[0] == 2 && found[1] == 4 && found[2] == 2 && loads == 2);
+    }
+
+    template<typename Storage>
+    void batch_failures() {
+        bool failing = true;
+        ThreadSafeCache<int, int, NoEviction, Storage> cache(nullptr, [&](std::span<const int> keys) {
+            if (failing) throw std::runtime_error("backend down");
+            return std::vector<int>(keys.size() + 1);
+        }, {.shards = 4});
+        CHECK_THROWS(cache.get_all(std::vector<int>{1, 2, 3}), std::runtime_error);
+        failing = false;
+        CHECK_THROWS(cache.get_all(std::vector<int>{1, 2, 3}), std::length_error);   // one value too many
+        CHECK(!cache.contains(1) && cache.size() == 0);
+    }
+
+    template<typename Storage>
+    void batch_failure_serves_stale() {
+        std::atomic<int> batches{0};
+        ThreadSafeCache<int, int, NoEviction, Storage, TimerWheelExpiration> cache(nullptr, [&](std::span<const int> keys) {
+            if (batches++ > 0) throw std::runtime_error("backend down");
+            return std::vector<int>(keys.begin(), keys.end());
+        }, {.shards = 2, .expiry = Expiry::after_write(50ms), .serve_stale_for = 1s});
+        const auto fresh = cache.get_all(std::vector<int>{1, 2});
+        CHECK(fresh[0] == 1 && fresh[1] == 2);
+        std::this_thread::sleep_for(80ms);
+        const auto stale = cache.get_all(std::vector<int>{1, 2});
+        CHECK(stale[0] == 1 && stale[1] == 2);
+        CHECK_THROWS(cache.get_all(std::vector<int>{1, 3}), std::runtime_error);   // 3 has nothing stale
+        cache.put_all(std::vector<std::pair<int, int>>{{5, 5}}, Expiry::after_write(1ms));
+        std::this_thread::sleep_for(5ms);
+        CHECK(!cache.contains(5));
+    }
+
+    // get_all, get, put_all and erase at once: every answer is the loaded or the put value
+    template<typename Storage>
+    void bulk_calls_race() {
+        ThreadSafeCache<int, int, LruEviction, Storage> cache([](int key) { return key; }, [](std::span<const int> keys) {
+            return std::vector<int>(keys.begin(), keys.end());
+        }, {.shards = 4, .max_entries = 200});
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < 6; ++t) {
+            threads.emplace_back([&, t] {
+                std::mt19937 rng{t};
+                for (int i = 0; i < 300; ++i) {
+                    std::vector<int> keys;
+                    for (int j = 0; j < 16; ++j) keys.push_back(static_cast<int>(rng() % 500));
+                    if (t % 3 == 0) {
+                        const auto found = cache.get_all(keys);
+                        for (std::size_t j = 0; j < keys.size(); ++j) CHECK(found[j] == keys[j] || found[j] == -keys[j]);
+                    } else if (t % 3 == 1) {
+                        for (int key : keys) {
+                            const auto found = cache.get(key);
+                            CHECK(found == key || found == -key);
+                        }
+                    } else {
+                        std::vector<std::pair<int, int>> pairs;
+                        for (int key : keys) pairs.emplace_back(key, -key);
+                        cache.put_all(pairs);
+                        cache.erase(keys[0]);
+                        if (i % 50 == 0) cache.clear();
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        CHECK(cache.size() <= 200);
+    }
+
+    template<typename Storage>
+    void run() {
+        batch_loader_gets_each_missing_key_once<Storage>();
+        put_all_from_any_range<Storage>();
+        single_loader_fills_in<Storage>();
+        batch_failures<Storage>();
+        batch_failure_serves_stale<Storage>();
+        bulk_calls_race<Storage>();
+    }
+}
+
+int main()
+{
+    run<NodeStorage>();
+    run<FlatStorage>();
+    run<ConcurrentStorage>();
+    return 0;
+}
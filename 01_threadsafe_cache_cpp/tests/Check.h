@@ -0,0 +1,27 @@
+    #pragma once
+
+    #include <cstdio>
+    #include <cstdlib>
+
+    // Test assertions: unlike assert() they stay on under -DNDEBUG and name the failed expression
+    #define CHECK(condition)                                                                            \
+        do {                                                                                            \
+            if (!(condition)) {                                                                         \
+                std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);      \
+                std::abort();                                                                           \
+            }                                                                                           \
+        } while (0)
+
+    #define CHECK_THROWS(expression, Exception)                                                         \
+        do {                                                                                            \
+            bool thrown = false;                                                                        \
+            try {                                                                                       \
+                (void)(expression);                                                                     \
+            } catch (const Exception&) {                                                                \
+                thrown = true;                                                                          \
+            }                                                                                           \
+            if (!thrown) {                                                                              \
+                std::fprintf(stderr, "%s:%d: %s did not throw %s\n", __FILE__, __LINE__, #expression, #Exception); \
+                std::abort();                                                                           \
+            }                                                                                           \
+        } while (0)
@@ -0,0 +1,114 @@
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../ThreadSafeCache.h"
+#include "Check.h"
+
+// DiskTier: evicted entries spill to the log and come back on a miss, with or without a loader,
+// through one flight per key, and every record the log drops on its own is reported back
+
+namespace {
+    using Spilling = ThreadSafeCache<int, std::string, LruEviction, NodeStorage, NoExpiration, NoStats, DiskTier>;
+
+    void evictions_spill_and_restore() {
+        std::atomic<int> loads{0};
+        Spilling cache([&](int key) {
+            ++loads;
+            return "loaded" + std::to_string(key);
+        }, {.shards = 4, .max_entries = 100});
+        for (int key = 0; key < 1000; ++key) cache.put(key, "put" + std::to_string(key));
+        CHECK(cache.size() <= 100 && cache.size() + cache.disk_size() == 1000);
+        for (int key = 0; key < 1000; ++key) CHECK(cache.get(key) == "put" + std::to_string(key));
+        CHECK(loads == 0);
+
+        // put and erase remove the spilled copy, so it cannot come back
+        for (int key = 0; key < 1000; ++key) cache.put(key, "again" + std::to_string(key));
+        CHECK(cache.erase(3) && cache.erase(500));
+        for (int key = 0; key < 1000; ++key) {
+            CHECK(cache.get(key) == (key == 3 || key == 500 ? "loaded" : "again") + std::to_string(key));
+        }
+        CHECK(loads == 2);
+        cache.clear();
+        CHECK(cache.size() == 0 && cache.disk_size() == 0);
+        CHECK(cache.get(7) == "loaded7" && loads == 3);
+    }
+
+    void puts_drop_spilled_copies() {
+        Spilling cache(nullptr, {.shards = 1, .max_entries = 10});
+        for (int key = 0; key < 20; ++key) cache.put(key, std::to_string(key));
+        CHECK(cache.disk_size() == 10);
+        for (int key = 0; key < 10; ++key) cache.put(key, "new");   // spilled keys: their copies go
+        CHECK(cache.disk_size() == 10);                              // and the evicted ones come in
+        for (int key = 0; key < 10; ++key) CHECK(cache.get(key) == "new");
+        for (int key = 10; key < 20; ++key) CHECK(cache.get(key) == std::to_string(key));
+    }
+
+    void loaderless_misses() {
+        ThreadSafeCache<std::string, long, LruEviction, NodeStorage, NoExpiration, NoStats, DiskTier> cache(nullptr, {.shards = 1, .max_entries = 10});
+        for (long i = 0; i < 100; ++i) cache.put("k" + std::to_string(i), i);
+        CHECK(cache.disk_size() == 90);
+        CHECK(cache.get("k5") == 5 && !cache.get("never"));
+        const std::vector<std::string> keys{"k1", "k2", "k99", "never"};
+        const auto found = cache.get_all(keys);
+        CHECK(found[0] == 1 && found[1] == 2 && found[2] == 99 && !found[3]);
+        CHECK(sync_wait(cache.get_async("k40")) == 40 && !sync_wait(cache.get_async("never")));
+        CHECK(cache.erase(std::string_view("k41")) && !cache.get("k41"));
+    }
+
+    // Every thread missing on a spilled key at once finds it: one restores, the others wait
+    void concurrent_restores_share_one_flight() {
+        constexpr int keys = 200;
+        constexpr int threads = 8;
+        Spilling cache(nullptr, {.shards = 2, .max_entries = 20});
+        for (int round = 0; round < 5; ++round) {
+            for (int key = 0; key < keys; ++key) cache.put(key, std::to_string(key));
+            std::atomic<int> missed{0};
+            std::atomic<int> ready{0};
+            std::vector<std::thread> readers;
+            for (int t = 0; t < threads; ++t) {
+                readers.emplace_back([&] {
+                    ready.fetch_add(1);
+                    while (ready.load() < threads) std::this_thread::yield();
+                    for (int key = 0; key < keys; ++key) {
+                        if (cache.get(key) != std::to_string(key)) missed.fetch_add(1);
+                    }
+                });
+            }
+            for (auto& reader : readers) reader.join();
+            CHECK(missed == 0);
+        }
+    }
+
+    // Past max_bytes the store drops whole segments; each record it drops that way is reported,
+    // so a shard can count it off its filter
+    void dropped_records_are_reported() {
+        std::atomic<std::size_t> dropped{0};
+        cache_detail::DiskStore<int> store({.directory = {}, .max_bytes = 32 << 10, .segment_bytes = 4096, .write_batch_bytes = 4096},
+                                           {.dropped = [&](std::span<const std::size_t> hashes) { dropped += hashes.size(); }});
+        const std::string payload(100, 'x');
+        std::size_t stored = 0;
+        for (int key = 0; key < 2000; ++key) {
+            const auto put = store.put(key, CacheHash<int>{}(key), payload);
+            CHECK(!put.superseded);
+            if (put.stored) ++stored;
+            if (key % 100 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        for (int wait = 0; wait < 500 && store.entries() + dropped != stored; ++wait) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        CHECK(dropped > 0 && store.entries() + dropped == stored);
+    }
+}
+
+int main()
+{
+    evictions_spill_and_restore();
+    puts_drop_spilled_copies();
+    loaderless_misses();
+    concurrent_restores_share_one_flight();
+    dropped_records_are_reported();
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "../ThreadSafeCache.h"
+#include "Check.h"
+
+// Bounded capacity: max_entries is a hard bound for every policy, however it divides over the
+// shards, LRU evicts the least recently used key, every policy's peek_victim() names the entry
+// victim() goes on to pick, and S3-FIFO's ghost only remembers evicted keys
+
+namespace {
+    template<typename Eviction>
+    void stays_within(std::size_t shards, std::size_t max_entries) {
+        ThreadSafeCache<std::uint64_t, std::uint64_t, Eviction> cache(nullptr, {.shards = shards, .max_entries = max_entries});
+        CHECK(cache.shard_count() <= max_entries);
+        for (std::uint64_t key = 0; key < 10'000; ++key) {
+            cache.put(key, key);
+            if (key % 3 == 0) (void)cache.get(key / 2);
+            CHECK(cache.size() <= max_entries);
+        }
+        CHECK(cache.size() > 0);
+    }
+
+    template<typename Eviction>
+    void bounds_hold() {
+        stays_within<Eviction>(16, 100);   // 100 = 6 * 16 + 4
+        stays_within<Eviction>(16, 10);    // fewer entries than shards
+        stays_within<Eviction>(4, 1);
+        stays_within<Eviction>(1, 37);
+    }
+
+    void shard_count_clamps_only_when_bounded() {
+        CHECK((ThreadSafeCache<int, int, LruEviction>(nullptr, {.shards = 16, .max_entries = 10}).shard_count() == 8));
+        CHECK((ThreadSafeCache<int, int, LruEviction>(nullptr, {.shards = 16}).shard_count() == 16));
+    }
+
+    // NoEviction never evicts, so a bound it was given would not hold
+    void unbounded_policy_rejects_a_bound() {
+        CHECK_THROWS((ThreadSafeCache<int, int>(nullptr, {.max_entries = 10})), std::invalid_argument);
+        CHECK_THROWS((ThreadSafeCache<int, int>(nullptr, {.max_weight = 10})), std::invalid_argument);
+        CHECK((ThreadSafeCache<int, int>(nullptr, {.shards = 16}).shard_count() == 16));
+    }
+
+    void lru_evicts_least_recent() {
+        ThreadSafeCache<int, int, LruEviction> cache(nullptr, {.shards = 1, .max_entries = 3});
+        cache.put(1, 1);
+        cache.put(2, 2);
+        cache.put(3, 3);
+        CHECK(cache.get(1));   // 2 is now the least recent
+        cache.put(4, 4);
+        CHECK(cache.contains(1) && !cache.contains(2) && cache.contains(3) && cache.contains(4));
+    }
+
+    template<typename Eviction>
+    void peek_matches_victim() {
+        typename Eviction::template State<int> policy;
+        policy.set_capacity(50);
+        std::vector<std::uint32_t> handles;
+        std::mt19937 rng{7};
+        int next = 0;
+        for (int step = 0; step < 20'000; ++step) {
+            if (handles.size() < 50) {
+                handles.push_back(policy.on_insert(next++ % 80));   // keys return, so S3-FIFO's ghost is used
+            } else if (rng() % 3 != 0) {
+                policy.on_access(handles[rng() % handles.size()]);
+            } else {
+                const auto peeked = policy.peek_victim();
+                CHECK(policy.peek_victim() == peeked);
+                const auto victim = policy.victim();
+                CHECK(victim == peeked);
+                policy.on_evict(victim);
+                std::erase(handles, victim);
+            }
+        }
+    }
+
+    // Only evictions feed S3-FIFO's ghost: an evicted key that returns skips probation, an
+    // erased one starts on it again
+    void s3fifo_ghost_remembers_only_evictions() {
+        S3FifoEviction::State<int> policy;
+        policy.set_capacity(10);   // small queue of 1
+        policy.on_evict(policy.on_insert(1));
+        (void)policy.on_insert(1);   // into main
+        policy.on_remove(policy.on_insert(2));
+        const auto erased = policy.on_insert(2);   // into the small queue, which is now full
+        CHECK(policy.victim() == erased);
+    }
+
+    void concurrent_writers_stay_bounded() {
+        ThreadSafeCache<std::uint64_t, std::uint64_t, S3FifoEviction> cache(nullptr, {.shards = 8, .max_entries = 200});
+        std::vector<std::thread> threads;
+        for (std::uint64_t t = 0; t < 4; ++t) {
+            threads.emplace_back([&cache, t] {
+                for (std::uint64_t i = 0; i < 5000; ++i) {
+                    cache.put(t * 100'000 + i, i);
+                    (void)cache.get(t * 100'000 + i / 2);
+                }
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        CHECK(cache.size() <= 200);
+    }
+}
+
+int main()
+{
+    bounds_hold<LruEviction>();
+    bounds_hold<ClockEviction>();
+    bounds_hold<S3FifoEviction>();
+    bounds_hold<TinyLfuAdmission<>>();
+    shard_count_clamps_only_when_bounded();
+    unbounded_policy_rejects_a_bound();
+    lru_evicts_least_recent();
+    peek_matches_victim<LruEviction>();
+    peek_matches_victim<ClockEviction>();
+    peek_matches_victim<S3FifoEviction>();
+    s3fifo_ghost_remembers_only_evictions();
+    concurrent_writers_stay_bounded();
+    return 0;
+}
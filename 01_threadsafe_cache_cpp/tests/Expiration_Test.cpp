@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../ThreadSafeCache.h"
+#include "Check.h"
+
+// Expiration: the timing wheel fires every timer once its deadline has passed and not long after,
+// and a cache never serves an entry past its after-write or after-access deadline
+
+namespace {
+    using namespace std::chrono_literals;
+
+    // Random schedules, cancels, reschedules and clock jumps, checked against a map of deadlines
+    void wheel_matches_deadlines() {
+        cache_detail::TimerWheel<int> wheel;
+        std::map<int, std::uint64_t> live;
+        std::map<int, std::uint32_t> handles;
+        std::mt19937_64 rng{1};
+        std::uint64_t now = 1'000'000'000'000ull;
+        const auto none = [](const int&) -> std::optional<std::uint64_t> { return std::nullopt; };
+        wheel.advance(now, none);
+        const auto pick = [&] {
+            auto it = live.begin();
+            std::advance(it, static_cast<std::ptrdiff_t>(rng() % std::min<std::size_t>(live.size(), 50)));
+            return it;
+        };
+        int next = 0;
+        for (int step = 0; step < 100'000; ++step) {
+            const auto op = rng() % 10;
+            if (op < 4) {
+                const auto deadline = now + (rng() % 4 == 0 ? rng() % (1ull << 50) : rng() % (1ull << 28));
+                live[next] = deadline;
+                handles[next] = wheel.schedule(next, deadline);
+                ++next;
+            } else if (op < 5 && !live.empty()) {
+                const auto it = pick();
+                wheel.cancel(handles[it->first]);
+                handles.erase(it->first);
+                live.erase(it);
+            } else if (op < 6 && !live.empty()) {
+                const auto it = pick();
+                it->second = now + rng() % (1ull << 30);
+                wheel.reschedule(handles[it->first], it->second);
+            } else {
+                now += rng() % 8 == 0 ? rng() % (1ull << 36) : rng() % (1ull << 21);
+                wheel.advance(now, [&](const int& key) -> std::optional<std::uint64_t> {
+                    CHECK(live.contains(key) && live[key] <= now);
+                    live.erase(key);
+                    handles.erase(key);
+                    return std::nullopt;
+                });
+            }
+        }
+        now += 1ull << 62;
+        wheel.advance(now, [&](const int& key) -> std::optional<std::uint64_t> {
+            live.erase(key);
+            return std::nullopt;
+        });
+        CHECK(live.empty());
+
+        // Advanced in 262us steps, a timer fires within a few ticks of ~1ms after its deadline
+        std::uint64_t latest = 0;
+        for (int key = 0; key < 1000; ++key) {
+            const auto deadline = now + rng() % (1ull << 33);
+            bool fired = false;
+            wheel.schedule(key, deadline);
+            while (!fired) {
+                now += 1ull << 18;
+                wheel.advance(now, [&](const int&) -> std::optional<std::uint64_t> {
+                    CHECK(deadline <= now);
+                    latest = std::max<std::uint64_t>(latest, now - deadline);
+                    fired = true;
+                    return std::nullopt;
+                });
+            }
+        }
+        CHECK(latest <= (3ull << 20));
+    }
+
+    void after_write() {
+        ThreadSafeCache<int, std::string, NoEviction, NodeStorage, TimerWheelExpiration> cache(nullptr);
+        cache.put(1, "short", Expiry::after_write(50ms));
+        cache.put(2, "forever");
+        CHECK(cache.get(1) && cache.contains(1));
+        std::this_thread::sleep_for(80ms);
+        CHECK(!cache.get(1) && !cache.contains(1) && cache.get(2));
+        CHECK(!cache.with(1, [](const std::string&) {}));
+        cache.put(1, "long", Expiry::after_write(1h));
+        CHECK(cache.get(1) == "long");
+        cache.put(3, "huge", Expiry::after_write(std::chrono::nanoseconds::max()));
+        CHECK(cache.contains(3));
+    }
+
+    void after_access() {
+        ThreadSafeCache<int, int, LruEviction, FlatStorage, TimerWheelExpiration> cache(nullptr, {.shards = 2, .max_entries = 100});
+        cache.put(1, 1, Expiry::after_access(200ms));
+        for (int i = 0; i < 10; ++i) {
+            std::this_thread::sleep_for(40ms);
+            CHECK(cache.get(1));   // each read pushes the deadline out
+        }
+        std::this_thread::sleep_for(300ms);
+        CHECK(!cache.get(1));
+    }
+
+    // Loaded values get CacheOptions::expiry; writes reap what the wheel finds due
+    void loads_expire_and_are_reaped() {
+        std::atomic<int> loads{0};
+        ThreadSafeCache<int, int, NoEviction, ConcurrentStorage, TimerWheelExpiration> cache([&](int key) {
+            ++loads;
+            return key;
+        }, {.shards = 4, .expiry = Expiry::after_write(200ms)});
+        for (int key = 0; key < 5000; ++key) cache.get(key);
+        CHECK(cache.size() == 5000 && loads == 5000);
+        cache.get(5);
+        CHECK(loads == 5000);
+        std::this_thread::sleep_for(250ms);
+        cache.get(5);
+        CHECK(loads == 5001);
+        for (int key = 100'000; key < 100'032; ++key) cache.put(key, 0, Expiry{});   // touches every shard
+        CHECK(cache.size() < 100);
+    }
+
+    // Readers racing puts with tiny TTLs: 0, always put with a zero TTL, is never served
+    void concurrent_readers_never_see_expired() {
+        ThreadSafeCache<int, std::uint64_t, S3FifoEviction, ConcurrentStorage, TimerWheelExpiration> cache(nullptr, {.shards = 4, .max_entries = 500});
+        std::atomic<bool> stop{false};
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < 3; ++t) {
+            threads.emplace_back([&, t] {
+                std::mt19937 rng{t};
+                while (!stop) {
+                    const auto value = cache.get(static_cast<int>(rng() % 1000));
+                    CHECK(!value || *value != 0);
+                }
+            });
+        }
+        std::mt19937 rng{7};
+        for (int i = 0; i < 100'000; ++i) {
+            const auto key = static_cast<int>(rng() % 1000);
+            if (i % 7 == 0) cache.erase(key);
+            if (i % 3 == 0) {
+                cache.put(key, 0, Expiry::after_write(0ns));
+            } else {
+                cache.put(key, 1, Expiry::after_write(std::chrono::microseconds(rng() % 3000)));
+            }
+        }
+        stop = true;
+        for (auto& thread : threads) thread.join();
+    }
+}
+
+int main()
+{
+    wheel_matches_deadlines();
+    after_write();
+    after_access();
+    loads_expire_and_are_reaped();
+    concurrent_readers_never_see_expired();
+    return 0;
+}
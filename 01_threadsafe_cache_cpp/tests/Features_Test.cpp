@@ -0,0 +1,96 @@
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include "../ThreadSafeCache.h"
+#include "Check.h"
+
+// ConfiguredCache and CacheFeatures: the default config is the plain cache, switched-off features
+// cost no space and are gone from the interface, and options that need them are refused
+
+namespace {
+    struct Lean : CacheConfig {
+        static constexpr auto features = CacheFeatures::none();
+    };
+
+    struct LruLean : Lean {
+        using Eviction = LruEviction;
+    };
+
+    struct Weighted : CacheConfig {
+        using Eviction = LruEviction;
+        static constexpr CacheFeatures features = {.removal_listener = false};
+    };
+
+    template<typename Cache>
+    concept CanListen = requires(Cache cache) { cache.set_removal_listener(nullptr); };
+
+    constexpr auto unit_weight = [](const std::uint64_t&, const std::uint64_t&) -> std::size_t { return 1; };
+
+    template<typename Cache>
+    concept TakesWeigher = requires { Cache(nullptr, CacheOptions{}, unit_weight); };
+
+    using Default = ThreadSafeCache<std::uint64_t, std::uint64_t>;
+    using LeanCache = ConfiguredCache<std::uint64_t, std::uint64_t, Lean>;
+
+    static_assert(std::same_as<ConfiguredCache<std::uint64_t, std::uint64_t>, Default>);
+    static_assert(LeanCache::entry_overhead() == 0 && Default::entry_overhead() == 0);
+    static_assert(ConfiguredCache<std::uint64_t, std::uint64_t, LruLean>::entry_overhead() == 8);
+    static_assert(!CanListen<LeanCache> && CanListen<Default>);
+    static_assert(!TakesWeigher<LeanCache> && TakesWeigher<Default>);
+    static_assert(sizeof(LeanCache) < sizeof(Default));
+    static_assert(!std::constructible_from<LeanCache, LeanCache::AsyncLoader> && std::constructible_from<Default, Default::AsyncLoader>);
+    static_assert(!std::constructible_from<LeanCache, std::nullptr_t, LeanCache::BatchLoader> &&
+                  std::constructible_from<Default, std::nullptr_t, Default::BatchLoader>);
+
+    void lean_cache() {
+        LeanCache cache([](std::uint64_t key) { return key * 2; });
+        CHECK(cache.get(3) == 6u);
+        cache.put(4, 1);
+        CHECK(cache.size() == 2 && cache.weight() == 2);
+        const std::uint64_t keys[] = {3, 5};
+        CHECK(cache.get_all(keys)[1] == 10u && sync_wait(cache.get_async(7)) == 14u);   // through the single-key loader
+        cache.erase(5);
+        cache.erase(7);
+        CHECK(cache.erase(4));
+        cache.clear();
+        CHECK(cache.size() == 0);
+
+        // Weights are switched off: there is no weigher parameter (TakesWeigher), and a weight
+        // bound is refused
+        CHECK_THROWS(LeanCache(nullptr, {.max_weight = 10}), std::invalid_argument);
+    }
+
+    // Without a loader the shards keep no single-flight table, and misses stay misses. Unsharded,
+    // the shard count asked for is ignored.
+    void put_only_cache() {
+        ConfiguredCache<std::uint64_t, std::uint64_t, Lean, NoLoader> cache(nullptr, {.shards = 4});
+        CHECK(cache.shard_count() == 1);
+        cache.put(1, 2);
+        const std::uint64_t keys[] = {1, 3};
+        const auto found = cache.get_all(keys);
+        CHECK(cache.get(1) == 2u && !cache.get(3) && found[0] == 2u && !found[1] && !sync_wait(cache.get_async(3)));
+        CHECK(cache.erase(1) && cache.size() == 0);
+    }
+
+    void policies_still_apply() {
+        ConfiguredCache<int, std::string, LruLean> lru(nullptr, {.shards = 1, .max_entries = 3});
+        for (int i = 0; i < 10; ++i) lru.put(i, std::to_string(i));
+        CHECK(lru.size() == 3 && lru.get(9) && !lru.get(0));
+
+        ConfiguredCache<int, std::string, Weighted> weighted(nullptr, {.shards = 1, .max_weight = 10},
+                                                             [](const int&, const std::string& value) { return value.size(); });
+        for (int i = 0; i < 10; ++i) weighted.put(i, "abcd");
+        CHECK(weighted.weight() <= 10 && weighted.size() == 2);
+        static_assert(!CanListen<decltype(weighted)>);
+    }
+}
+
+int main()
+{
+    lean_cache();
+    put_only_cache();
+    policies_still_apply();
+    return 0;
+}
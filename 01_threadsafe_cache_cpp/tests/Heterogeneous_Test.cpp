@@ -0,0 +1,132 @@
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "../ThreadSafeCache.h"
+#include "Check.h"
+
+// Heterogeneous lookup: probes that CacheHash<Key> hashes transparently find, erase and load
+// entries without a Key being built, except the one a loader needs on a miss
+
+namespace {
+    using namespace std::literals;
+
+    // A string key that counts how often it is built from a view
+    struct Name {
+        static inline std::atomic<int> built{0};
+
+        explicit Name(std::string_view text) : text(text) { ++built; }
+        std::string text;
+
+        friend bool operator==(const Name&, const Name&) = default;
+        friend bool operator==(const Name& name, std::string_view probe) { return name.text == probe; }
+    };
+}
+
+template<>
+struct CacheHash<Name> {
+    using is_transparent = void;
+
+    auto operator()(std::string_view key) const noexcept -> std::size_t { return std::hash<std::string_view>{}(key); }
+    auto operator()(const Name& key) const noexcept -> std::size_t { return (*this)(std::string_view(key.text)); }
+};
+
+static_assert(cache_detail::TransparentLookup<std::string_view, std::string>);
+static_assert(cache_detail::TransparentLookup<const char*, std::string>);
+static_assert(cache_detail::TransparentLookup<std::string_view, Name>);
+static_assert(!cache_detail::TransparentLookup<int, long>);
+static_assert(!cache_detail::TransparentLookup<std::string, std::string>);
+
+namespace {
+    // Only a miss builds a key
+    template<typename Storage>
+    void probes_build_no_keys() {
+        ThreadSafeCache<Name, int, LruEviction, Storage> cache([](const Name& key) { return static_cast<int>(key.text.size()); },
+                                                                {.shards = 4, .max_entries = 100});
+        const auto before = Name::built.load();
+        CHECK(cache.get("seven77"sv) == 7 && Name::built == before + 1);
+        for (int i = 0; i < 100; ++i) {
+            CHECK(cache.contains("seven77"sv) && cache.get("seven77"sv) == 7);
+            CHECK(cache.with("seven77"sv, [](int value) { return value; }) == 7);
+            CHECK(!cache.contains("absent"sv));
+        }
+        CHECK(Name::built == before + 1);
+        CHECK(!cache.erase("absent"sv) && cache.erase("seven77"sv) && !cache.contains("seven77"sv));
+        CHECK(Name::built == before + 1);
+    }
+
+    template<typename Eviction, typename Storage>
+    void string_keys() {
+        std::atomic<int> loads{0};
+        ThreadSafeCache<std::string, std::string, Eviction, Storage> cache(
+            [&](const std::string& key) {
+                ++loads;
+                return key + "!";
+            },
+            {.shards = 4, .max_entries = Eviction::bounded ? 1000u : 0u}, [](const std::string& key, const std::string& value) { return key.size() + value.size(); });
+        const std::string long_key = "a-rather-long-key-that-defeats-sso-0001";
+        const std::string_view view = long_key;
+        CHECK(cache.get(view) == long_key + "!" && loads == 1);
+        CHECK(cache.get(long_key) == long_key + "!" && loads == 1);
+        CHECK(cache.contains(view) && cache.contains("a-rather-long-key-that-defeats-sso-0001"));
+
+        // Weights follow puts and erases made through probes
+        const auto weight = cache.weight();
+        cache.put("x"s, "y"s);
+        CHECK(cache.weight() == weight + 2);
+        CHECK(cache.erase("x"sv) && !cache.contains("x"sv) && cache.weight() == weight);
+        CHECK(!cache.erase("nope"sv));
+        CHECK(cache.erase(view) && !cache.contains(long_key) && cache.weight() == 0 && cache.size() == 0);
+
+        for (int i = 0; i < 3000; ++i) cache.get(std::string_view("k" + std::to_string(i)));
+        if constexpr (Eviction::bounded) CHECK(cache.size() <= 1000);
+        for (int i = 0; i < 3000; ++i) cache.erase(std::string_view("k" + std::to_string(i)));
+        CHECK(cache.size() == 0 && cache.weight() == 0);
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < 20000; ++i) {
+                    const auto key = "key" + std::to_string((i * 7 + t) % 500);
+                    const std::string_view probe = key;
+                    if (i % 11 == 0) {
+                        cache.erase(probe);
+                    } else if (i % 3 == 0) {
+                        cache.contains(probe);
+                    } else {
+                        CHECK(cache.get(probe) == key + "!");
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) thread.join();
+    }
+
+    // Convertible probes that are not transparent still work, through a Key
+    void converting_probes() {
+        ThreadSafeCache<long, int> numbers([](long key) { return static_cast<int>(key * 2); });
+        const short small = 4;
+        CHECK(numbers.get(small) == 8 && numbers.contains(4) && numbers.erase(4) && !numbers.contains(small));
+
+        ThreadSafeCache<std::string, int> strings(nullptr);
+        strings.put("a", 1);
+        CHECK(strings.with("a", [](int value) { return value + 1; }) == 2 && strings.get("a") == 1 && !strings.get("b"));
+    }
+}
+
+int main()
+{
+    probes_build_no_keys<NodeStorage>();
+    probes_build_no_keys<FlatStorage>();
+    probes_build_no_keys<ConcurrentStorage>();
+    string_keys<NoEviction, NodeStorage>();
+    string_keys<LruEviction, NodeStorage>();
+    string_keys<S3FifoEviction, FlatStorage>();
+    string_keys<TinyLfuAdmission<LruEviction>, ConcurrentStorage>();
+    string_keys<NoEviction, ConcurrentStorage>();
+    converting_probes();
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "../ThreadSafeCache.h"
+#include "Check.h"
+
+// HotKeys: the top keys from sampled lookups, buffered per thread and handed over when full, when
+// the thread exits, or when it needs the slot for another cache
+
+namespace {
+    template<std::size_t Counters, std::uint32_t SampleEvery, typename Key = int>
+    using HotCache = ThreadSafeCache<Key, int, NoEviction, NodeStorage, NoExpiration, NoStats, NoDiskTier, NoNearCache, HotKeys<Counters, SampleEvery>>;
+
+    void finds_the_hot_key() {
+        HotCache<8, 1> cache([](int key) { return key; });
+        CHECK(cache.hot_keys(3).empty());
+        for (int i = 0; i < 1000; ++i) cache.get(i % 3 == 0 ? 7 : i);
+        const auto hot = cache.hot_keys(1);
+        CHECK(hot.size() == 1 && hot[0].key == 7);
+        CHECK(hot[0].share > 0.25 && hot[0].share < 0.45 && hot[0].per_second > 0);
+        CHECK(cache.hot_keys(0).empty());
+    }
+
+    void concurrent_lookups() {
+        HotCache<32, 4, std::string> cache([](const std::string& key) { return static_cast<int>(key.size()); });
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < 4; ++t) {
+            threads.emplace_back([&, t] {
+                std::mt19937 rng{t};
+                for (int i = 0; i < 50'000; ++i) {
+                    if (rng() % 10 < 3) {
+                        cache.get(std::string_view("hot"));
+                    } else if (i % 2) {
+                        cache.get("k" + std::to_string(rng() % 5000));
+                    } else {
+                        cache.with(std::string("k" + std::to_string(rng() % 5000)), [](const int&) {});
+                    }
+                }
+            });
+        }
+        for (int i = 0; i < 200; ++i) (void)cache.hot_keys(3);
+        for (auto& thread : threads) thread.join();
+        const auto hot = cache.hot_keys(5);
+        CHECK(!hot.empty() && hot[0].key == "hot");
+        CHECK(hot[0].share > 0.2 && hot[0].share < 0.45);
+        for (std::size_t i = 1; i < hot.size(); ++i) CHECK(hot[i].share <= hot[i - 1].share);
+    }
+
+    // Fewer samples than a buffer holds are handed over when the thread exits
+    void exiting_threads_hand_over() {
+        HotCache<8, 1> cache([](int key) { return key; });
+        std::thread([&] {
+            for (int i = 0; i < 10; ++i) cache.get(5);
+        }).join();
+        const auto hot = cache.hot_keys(1);
+        CHECK(hot.size() == 1 && hot[0].key == 5 && hot[0].share == 1.0);
+    }
+
+    // More caches than a thread has slots for: each keeps its own samples, none are lost
+    void many_caches_on_one_thread() {
+        std::vector<std::unique_ptr<HotCache<8, 1>>> caches;
+        for (int c = 0; c < 6; ++c) caches.push_back(std::make_unique<HotCache<8, 1>>([](int key) { return key; }));
+        std::thread([&] {
+            for (int i = 0; i < 100; ++i) {
+                for (int c = 0; c < 6; ++c) caches[c]->get(c * 100 + (i % 4 == 0 ? 0 : i));
+            }
+        }).join();
+        for (int c = 0; c < 6; ++c) {
+            const auto hot = caches[c]->hot_keys(1);
+            CHECK(hot.size() == 1 && hot[0].key == c * 100);
+        }
+    }
+
+    // A thread can outlive a cache it sampled for; its buffer then goes nowhere harmful
+    void cache_dies_before_thread() {
+        auto doomed = std::make_unique<HotCache<8, 1>>([](int key) { return key; });
+        for (int i = 0; i < 10; ++i) doomed->get(1);
+        doomed.reset();
+        HotCache<8, 1> cache([](int key) { return key; });
+        for (int i = 0; i < 10; ++i) cache.get(2);
+        const auto hot = cache.hot_keys(2);
+        CHECK(hot.size() == 1 && hot[0].key == 2);
+    }
+}
+
+int main()
+{
+    finds_the_hot_key();
+    concurrent_lookups();
+    exiting_threads_hand_over();
+    many_caches_on_one_thread();
+    cache_dies_before_thread();
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "../ThreadSafeCache.h"
+#include "Check.h"
+
+// Inline loaders: a cache deduced from a lambda or function pointer stores that callable as is,
+// make_cache does the same for a config, and the std::function form keeps working
+
+namespace {
+    using namespace std::chrono_literals;
+
+    int twice(const int& key) { return 2 * key; }
+
+    struct Refreshing : CacheConfig {
+        using Eviction = LruEviction;
+        using Expiration = TimerWheelExpiration;
+    };
+
+    void deduced_from_a_lambda() {
+        std::atomic<int> calls{0};
+        ThreadSafeCache cache([&](const std::string& key) {
+            ++calls;
+            return key.size();
+        });
+        static_assert(std::same_as<decltype(cache.get("abc")), std::optional<std::size_t>>);
+        CHECK(cache.get(std::string("abcd")) == 4u);
+        CHECK(cache.get(std::string_view("abcd")) == 4u && calls == 1);
+        const std::vector<std::string> keys{"a", "bb", "abcd"};
+        const auto all = cache.get_all(keys);
+        CHECK(all[0] == 1u && all[1] == 2u && all[2] == 4u && calls == 3);
+    }
+
+    // A stateless loader takes no room; a function pointer can be null, for a loader-less cache
+    void stateless_and_pointer_loaders() {
+        ThreadSafeCache cache([](int key) noexcept { return std::to_string(key); }, {.shards = 2});
+        static_assert(sizeof(cache) < sizeof(ThreadSafeCache<int, std::string>));
+        CHECK(cache.get(12) == "12");
+
+        ThreadSafeCache pointer(&twice);
+        CHECK(pointer.get(4) == 8);
+        ThreadSafeCache<int, int, NoEviction, NodeStorage, NoExpiration, NoStats, NoDiskTier, NoNearCache, NoHotKeys, CacheFeatures{}, int (*)(const int&)> empty(nullptr);
+        CHECK(!empty.get(3));
+        empty.put(3, 1);
+        CHECK(empty.get(3) == 1);
+    }
+
+    // Refreshes run the same inline loader from other threads
+    void make_cache_with_refresh() {
+        std::atomic<int> calls{0};
+        auto cache = make_cache<int, std::string, Refreshing>([&](const int& key) {
+            ++calls;
+            return std::string(static_cast<std::size_t>(key), 'x');
+        }, {.shards = 1, .max_entries = 4, .expiry = Expiry::after_write(5s), .refresh_after = 1ms});
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&] {
+                for (int i = 0; i < 2000; ++i) CHECK(cache.get(i % 10)->size() == static_cast<std::size_t>(i % 10));
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        CHECK(sync_wait(cache.get_async(7))->size() == 7);
+        CHECK(calls >= 10);
+    }
+
+    void type_erased_loaders() {
+        ThreadSafeCache<int, int> batch(nullptr, [](std::span<const int> keys) {
+            std::vector<int> values;
+            for (const int key : keys) values.push_back(key + 1);
+            return values;
+        });
+        CHECK(batch.get(1) == 2);
+        ThreadSafeCache<int, int> plain([](const int& key) { return key; });
+        CHECK(plain.get(5) == 5);
+    }
+}
+
+int main()
+{
+    deduced_from_a_lambda();
+    stateless_and_pointer_loaders();
+    make_cache_with_refresh();
+    type_erased_loaders();
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "../ThreadSafeCache.h"
+#include "Check.h"
+
+// NearCache: per-thread copies of hot entries answer repeat lookups, and never outlive a put,
+// erase, clear, eviction or expiry of the shared entry, nor show a value older than one already
+// published
+
+namespace {
+    using namespace std::chrono_literals;
+
+    template<typename Storage, typename Eviction>
+    using Near = ThreadSafeCache<int, long, Eviction, Storage, NoExpiration, CacheStats, NoDiskTier, NearCache<64>>;
+
+    // Two caches on one thread keep their near copies apart
+    template<typename Storage, typename Eviction>
+    void writes_invalidate() {
+        std::atomic<int> loads{0};
+        Near<Storage, Eviction> a([&](int key) {
+            ++loads;
+            return long{key};
+        }, {.shards = 4, .max_entries = Eviction::bounded ? 50u : 0u});
+        Near<Storage, Eviction> b([&](int key) {
+            ++loads;
+            return long{-key};
+        }, {.shards = 4});
+        for (int round = 0; round < 3; ++round) {
+            for (int key = 0; key < 10; ++key) CHECK(a.get(key) == key && b.get(key) == -key);
+        }
+        CHECK(loads == 20 && a.stats().hits > 0);
+        a.put(3, 33L);
+        CHECK(a.get(3) == 33 && b.get(3) == -3);
+        a.erase(3);
+        CHECK(a.get(3) == 3 && loads == 21);
+        a.clear();
+        CHECK(a.get(4) == 4 && loads == 22);
+
+        // A near-held key that was evicted, put back and erased does not come back
+        for (int key = 100; key < 400; ++key) a.put(key, long{key});
+        a.get(5);
+        a.get(5);
+        for (int key = 1000; key < 1200; ++key) a.put(key, long{key});
+        a.put(5, 55L);
+        a.get(5);
+        a.get(5);
+        a.erase(5);
+        CHECK(a.get(5) == 5);
+    }
+
+    // Readers never see a value older than the last one they know was put
+    template<typename Storage, typename Eviction>
+    void readers_see_no_older_values() {
+        Near<Storage, Eviction> cache(nullptr, {.shards = 2});
+        std::atomic<long> published{0};
+        std::atomic<bool> stop{false};
+        std::atomic<bool> stale{false};
+        cache.put(1, 0L);
+        std::thread writer([&] {
+            for (long value = 1; value <= 50'000; ++value) {
+                cache.put(1, value);
+                published.store(value, std::memory_order_release);
+            }
+            stop = true;
+        });
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 3; ++t) {
+            readers.emplace_back([&] {
+                while (!stop) {
+                    const auto seen = published.load(std::memory_order_acquire);
+                    const auto value = cache.get(1);
+                    if (!value || *value < seen) stale = true;
+                    cache.get(2);
+                }
+            });
+        }
+        writer.join();
+        for (auto& reader : readers) reader.join();
+        CHECK(!stale);
+    }
+
+    void expiry_reaches_near_copies() {
+        ThreadSafeCache<int, int, LruEviction, NodeStorage, TimerWheelExpiration, NoStats, NoDiskTier, NearCache<>> cache(nullptr, {.shards = 1});
+        cache.put(1, 1, Expiry::after_write(50ms));
+        cache.put(2, 2, Expiry::after_access(50ms));
+        for (int i = 0; i < 5; ++i) CHECK(cache.get(1) && cache.get(2));
+        std::this_thread::sleep_for(100ms);
+        CHECK(!cache.get(1) && !cache.get(2));
+    }
+
+    void shared_values_and_probes() {
+        ThreadSafeCache<std::string, SharedValue<std::string>, NoEviction, NodeStorage, NoExpiration, NoStats, NoDiskTier, NearCache<>> cache(
+            [](const std::string& key) { return key + "!"; });
+        const std::string_view probe = "abc";
+        const auto first = cache.get(probe);
+        const auto second = cache.get(probe);
+        CHECK(*first == "abc!" && first == second && second == cache.get("abc"));
+        cache.put(std::string("abc"), std::string("x"));
+        CHECK(*cache.get(probe) == "x");
+        cache.erase(probe);
+        CHECK(*cache.get(probe) == "abc!");
+    }
+
+    // Near hits are passed on to the policy, so a key read only through them stays resident
+    void near_hits_keep_keys_hot() {
+        ThreadSafeCache<int, int, LruEviction, NodeStorage, NoExpiration, NoStats, NoDiskTier, NearCache<>> cache(
+            [](int key) { return key; }, {.shards = 1, .max_entries = 10});
+        cache.get(0);
+        for (int key = 1; key < 2000; ++key) {
+            for (int i = 0; i < 70; ++i) cache.get(0);
+            cache.get(key);
+        }
+        CHECK(cache.contains(0));
+    }
+}
+
+int main()
+{
+    writes_invalidate<NodeStorage, NoEviction>();
+    writes_invalidate<FlatStorage, LruEviction>();
+    writes_invalidate<ConcurrentStorage, S3FifoEviction>();
+    readers_see_no_older_values<NodeStorage, NoEviction>();
+    readers_see_no_older_values<FlatStorage, LruEviction>();
+    readers_see_no_older_values<ConcurrentStorage, S3FifoEviction>();
+    expiry_reaches_near_copies();
+    shared_values_and_probes();
+    near_hits_keep_keys_hot();
+    return 0;
+}
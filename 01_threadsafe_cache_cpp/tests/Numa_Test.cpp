@@ -0,0 +1,153 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "../ThreadSafeCache.h"
+#include "Check.h"
+
+// NUMA shard groups and read replicas, on synthetic two- and three-node layouts cut from this
+// host's CPUs: every mode answers like a flat cache, and a replica never serves a value that was
+// overwritten, erased or expired
+
+namespace {
+    using namespace std::chrono_literals;
+
+    struct Grouped : CacheConfig {
+        using Numa = NumaShards<>;
+    };
+
+    struct Replicated : CacheConfig {
+        using Eviction = LruEviction;
+        using Expiration = TimerWheelExpiration;
+        using Allocator = PoolAllocator<std::byte>;
+        using Numa = NumaShards<256>;
+    };
+
+    struct ReplicatedStrings : CacheConfig {
+        using Numa = NumaShards<64>;
+    };
+
+    void topology() {
+        using cache_detail::parse_id_list;
+        CHECK((parse_id_list("0-3,8,10-11\n") == std::vector<unsigned>{0, 1, 2, 3, 8, 10, 11}));
+        CHECK(parse_id_list("").empty());
+        CHECK((parse_id_list("5") == std::vector<unsigned>{5}));
+        CHECK(NumaTopology::detect().size() >= 1);
+        const auto two = NumaTopology::synthetic(2);
+        CHECK(two.size() == 2 && !two.nodes()[0].cpus.empty() && !two.nodes()[1].cpus.empty());
+        CHECK(NumaTopology::synthetic(3).size() == 3);
+    }
+
+    void shard_groups() {
+        const auto two = NumaTopology::synthetic(2);
+        ConfiguredCache<std::uint64_t, std::uint64_t, Grouped> cache(nullptr, {.shards = 16, .numa = two});
+        CHECK(cache.shard_count() == 16);
+        for (std::uint64_t key = 0; key < 10000; ++key) cache.put(key, key * 3);
+        for (std::uint64_t key = 0; key < 10000; ++key) CHECK(cache.get(key) == key * 3);
+        CHECK(cache.size() == 10000);
+        cache.erase(5);
+        CHECK(!cache.get(5));
+        cache.clear();
+        CHECK(cache.size() == 0);
+
+        // Shards are rounded up to a multiple of the node count
+        ConfiguredCache<std::uint64_t, std::uint64_t, Grouped> uneven(nullptr, {.shards = 5, .numa = NumaTopology::synthetic(3)});
+        CHECK(uneven.shard_count() == 6);
+        for (std::uint64_t key = 0; key < 3000; ++key) uneven.put(key, key);
+        for (std::uint64_t key = 0; key < 3000; ++key) CHECK(uneven.get(key) == key);
+
+        ConfiguredCache<std::uint64_t, std::uint64_t, Grouped> detected(nullptr, {.shards = 4});
+        detected.put(1, 2);
+        CHECK(detected.get(1) == 2);
+    }
+
+    void replicas_follow_writes() {
+        const auto two = NumaTopology::synthetic(2);
+        ConfiguredCache<std::uint64_t, std::uint64_t, Replicated> cache(nullptr, {.shards = 8, .max_entries = 1000, .expiry = Expiry::after_write(300ms), .numa = two});
+        for (std::size_t node = 0; node < 2; ++node) {
+            two.bind_current_thread(node);
+            for (std::uint64_t key = 0; key < 200; ++key) {
+                cache.put(key, key);
+                for (int i = 0; i < 100; ++i) CHECK(cache.get(key) == key);
+                cache.put(key, key + 1);
+                for (int i = 0; i < 100; ++i) CHECK(cache.get(key) == key + 1);
+            }
+            // A replica does not outlive the entry's deadline
+            cache.put(7, 8);
+            for (int i = 0; i < 100; ++i) CHECK(cache.get(7) == 8);
+            std::this_thread::sleep_for(400ms);
+            CHECK(!cache.get(7));
+            cache.clear();
+        }
+        CHECK(cache.memory().node_bytes == 0);
+
+        ConfiguredCache<std::string, int, ReplicatedStrings> strings(nullptr, {.shards = 4, .numa = two});
+        two.bind_current_thread(1);
+        for (int key = 0; key < 100; ++key) strings.put(std::to_string(key), key);
+        for (int round = 0; round < 50; ++round) {
+            for (int key = 0; key < 100; ++key) CHECK(strings.get(std::string_view(std::to_string(key))) == key);
+        }
+        strings.erase("3");
+        CHECK(!strings.get("3"));
+    }
+
+    // Readers on both nodes only ever see values written for the key they asked for
+    void concurrent_nodes() {
+        const auto two = NumaTopology::synthetic(2);
+        ConfiguredCache<std::uint64_t, std::uint64_t, Replicated> cache(nullptr, {.shards = 8, .max_entries = 500, .numa = two});
+        std::vector<std::thread> threads;
+        for (std::uint64_t t = 0; t < 4; ++t) {
+            threads.emplace_back([&, t] {
+                two.bind_current_thread(t % 2);
+                for (std::uint64_t i = 0; i < 40000; ++i) {
+                    const auto key = (i * 7 + t) % 600;
+                    if (i % 10 == 0) {
+                        cache.put(key, key * 1000 + i % 1000);
+                    } else if (const auto value = cache.get(key)) {
+                        CHECK(*value / 1000 == key);
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        CHECK(cache.size() <= 500);
+    }
+
+    // The replica table alone: it serves a copy only at the shard version it was filled at
+    void replica_versions() {
+        cache_detail::ShardReplica<std::uint64_t, std::uint64_t, 4> replica;
+        std::uint64_t got = 0;
+        const auto read = [&](std::uint64_t key, std::uint64_t version) {
+            return replica.read(key, key, version, 0, [&](std::uint64_t value) { got = value; });
+        };
+        CHECK(replica.wants(0));
+        replica.fill(1, 1, 0, ~0ull, 10);
+        CHECK(read(1, 0) && got == 10);
+        CHECK(!read(1, 1));
+        for (std::uint32_t i = 1; i < replica.hot_after; ++i) CHECK(!replica.wants(3));
+        CHECK(replica.wants(3));
+        replica.fill(2, 2, 3, ~0ull, 20);
+        CHECK(!read(1, 3) && read(2, 3) && got == 20);
+        replica.fill(5, 5, 2, ~0ull, 50);   // an older copy is dropped
+        CHECK(!read(5, 3) && !read(5, 2));
+        for (std::uint64_t key = 10; key < 20; ++key) replica.fill(key, key, 3, ~0ull, key);
+        int present = 0;
+        for (std::uint64_t key = 10; key < 20; ++key) present += read(key, 3);
+        CHECK(present == 3);   // four slots, one held by key 2
+        replica.fill(9, 9, 3, 100, 9);
+        CHECK(!replica.read(9, 9, 3, 100, [](std::uint64_t) {}));   // at its deadline
+    }
+}
+
+int main()
+{
+    topology();
+    shard_groups();
+    replicas_follow_writes();
+    concurrent_nodes();
+    replica_versions();
+    return 0;
+}
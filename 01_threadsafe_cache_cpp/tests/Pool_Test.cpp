@@ -0,0 +1,78 @@
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../ThreadSafeCache.h"
+#include "Check.h"
+
+// Pooled entries: nodes come from fixed-size slabs that churn reuses instead of growing, memory()
+// accounts for them, and any standard allocator, such as a pmr one, can stand in for the pool
+
+namespace {
+    struct Pooled : CacheConfig {
+        using Eviction = LruEviction;
+        using Allocator = PoolAllocator<std::byte>;
+    };
+
+    struct Pmr : CacheConfig {
+        using Allocator = std::pmr::polymorphic_allocator<std::byte>;
+    };
+
+    void churn_reuses_slabs() {
+        ConfiguredCache<std::uint64_t, std::uint64_t, Pooled> cache(nullptr, {.shards = 4, .max_entries = 10'000});
+        for (std::uint64_t i = 0; i < 10'000; ++i) cache.put(i, i);
+        const auto warm = cache.memory();
+        const auto warm_size = cache.size();
+        CHECK(warm.node_bytes % warm_size == 0 && warm.node_bytes / warm_size <= 64);
+
+        std::vector<std::thread> threads;
+        for (std::uint64_t t = 0; t < 4; ++t) {
+            threads.emplace_back([&, t] {
+                for (std::uint64_t i = 0; i < 50'000; ++i) {
+                    const auto key = 100'000 + t * 1'000'000 + i;
+                    cache.put(key, key);
+                    if (i % 7 == 0) cache.erase(key);
+                    if (i % 5 == 0) (void)cache.get(key - 3);
+                }
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        const auto churned = cache.memory();
+        CHECK(churned.node_bytes / cache.size() == warm.node_bytes / warm_size);
+        // At most one more slab per shard than the warm cache held
+        CHECK(churned.reserved_bytes - churned.table_bytes <= warm.reserved_bytes - warm.table_bytes + 4 * 64 * 1024);
+        cache.clear();
+        CHECK(cache.memory().node_bytes == 0);
+    }
+
+    void variable_size_values() {
+        ConfiguredCache<std::string, std::string, Pooled> strings([](const std::string& key) { return key + key; }, {.shards = 2, .max_entries = 100});
+        for (int i = 0; i < 1000; ++i) CHECK(strings.get(std::to_string(i)) == std::to_string(i) + std::to_string(i));
+        CHECK(strings.size() <= 100 && strings.memory().node_bytes > 0);
+
+        ConfiguredCache<int, SharedValue<std::string>, Pooled> shared(nullptr, {.max_entries = 10});
+        for (int i = 0; i < 100; ++i) shared.put(i, std::string(100, 'x'));
+        CHECK(shared.size() == 10);
+    }
+
+    void pmr_allocator() {
+        std::pmr::monotonic_buffer_resource arena;
+        std::pmr::set_default_resource(&arena);
+        {
+            ConfiguredCache<int, int, Pmr> cache([](const int& key) { return key; });
+            std::pmr::set_default_resource(nullptr);   // the cache keeps the resource it was built with
+            for (int i = 0; i < 1000; ++i) CHECK(cache.get(i) == i);
+            CHECK(cache.erase(5) && !cache.contains(5));
+        }
+    }
+}
+
+int main()
+{
+    churn_reuses_slabs();
+    variable_size_values();
+    pmr_allocator();
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../ThreadSafeCache.h"
+#include "Check.h"
+
+// Epoch-based reclamation under stress: readers hold pointers inside EpochGuards while writers
+// unlink and retire them. A node freed too early shows up as an ASan use-after-free, or as a
+// TSan race with its delete.
+
+namespace {
+    struct Node {
+        std::uint64_t stamp;
+        std::uint64_t check;
+    };
+
+    void guarded_pointers_outlive_their_readers() {
+        constexpr std::size_t slots = 64;
+        std::vector<std::atomic<Node*>> table(slots);
+        for (std::size_t i = 0; i < slots; ++i) table[i].store(new Node{i, ~i});
+        std::atomic<bool> stop{false};
+
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 3; ++t) {
+            readers.emplace_back([&, t] {
+                std::uint64_t i = static_cast<std::uint64_t>(t);
+                while (!stop.load(std::memory_order_relaxed)) {
+                    cache_detail::EpochGuard guard;
+                    const auto* node = table[i++ % slots].load(std::memory_order_acquire);
+                    std::this_thread::yield();   // keep the pointer across a writer's step
+                    CHECK(node->check == ~node->stamp);
+                }
+            });
+        }
+
+        cache_detail::RetireList retired;
+        for (std::uint64_t round = 0; round < 100'000; ++round) {
+            const auto stamp = round + slots;
+            auto* old = table[round % slots].exchange(new Node{stamp, ~stamp}, std::memory_order_acq_rel);
+            retired.retire(old);
+        }
+        stop = true;
+        for (auto& reader : readers) reader.join();
+        for (auto& slot : table) delete slot.load();
+    }
+
+    void concurrent_storage_under_churn() {
+        // Values on the heap, so a freed entry is caught when a reader copies it
+        ThreadSafeCache<std::uint64_t, std::string, NoEviction, ConcurrentStorage> cache(nullptr, {.shards = 2});
+        std::atomic<bool> stop{false};
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 3; ++t) {
+            readers.emplace_back([&, t] {
+                std::uint64_t i = static_cast<std::uint64_t>(t);
+                while (!stop.load(std::memory_order_relaxed)) {
+                    const auto key = i++ % 4096;
+                    if (auto value = cache.get(key)) CHECK(value->starts_with(std::to_string(key) + ":"));
+                }
+            });
+        }
+        // Inserts grow the tables, overwrites and erases retire entries
+        for (std::uint64_t round = 0; round < 60'000; ++round) {
+            const auto key = (round * 2654435761u) % 4096;
+            if (round % 5 == 4) {
+                cache.erase(key);
+            } else {
+                cache.put(key, std::to_string(key) + ":" + std::string(32, 'x'));
+            }
+            if (round % 20'000 == 19'999) cache.clear();
+        }
+        stop = true;
+        for (auto& reader : readers) reader.join();
+    }
+}
+
+int main()
+{
+    guarded_pointers_outlive_their_readers();
+    concurrent_storage_under_churn();
+    return 0;
+}
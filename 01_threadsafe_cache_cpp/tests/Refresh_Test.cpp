@@ -0,0 +1,143 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "../ThreadSafeCache.h"
+#include "Check.h"
+
+// Refresh-ahead and stale-while-revalidate: a due entry is served while one background reload
+// replaces it, and a failed reload keeps the old value only inside its serve-stale window
+
+namespace {
+    using namespace std::chrono_literals;
+    using Clock = std::chrono::steady_clock;
+
+    template<typename Fn>
+    auto timed(Fn fn) {
+        const auto start = Clock::now();
+        auto result = fn();
+        return std::pair{result, Clock::now() - start};
+    }
+
+    void due_entries_refresh_in_the_background() {
+        std::atomic<int> loads{0};
+        ThreadSafeCache<int, int, LruEviction, NodeStorage, TimerWheelExpiration> cache([&](int) {
+            std::this_thread::sleep_for(50ms);
+            return ++loads;
+        }, {.shards = 2, .max_entries = 100, .expiry = Expiry::after_write(1s), .refresh_after = 100ms});
+        CHECK(cache.get(1) == 1);
+        std::this_thread::sleep_for(120ms);
+        const auto [due, waited] = timed([&] { return cache.get(1); });
+        CHECK(due == 1 && waited < 40ms);   // served at once, the reload runs behind it
+        CHECK(cache.get(1) == 1);           // one reload at a time
+        std::this_thread::sleep_for(150ms);
+        CHECK(cache.get(1) == 2 && loads == 2);
+    }
+
+    void failed_refresh_serves_stale_within_the_window() {
+        std::atomic<int> loads{0};
+        ThreadSafeCache<int, int, NoEviction, ConcurrentStorage, TimerWheelExpiration> cache([&](int) {
+            if (loads++ > 0) throw std::runtime_error("backend down");
+            return 7;
+        }, {.shards = 2, .expiry = Expiry::after_write(100ms), .refresh_after = 50ms, .serve_stale_for = 300ms});
+        CHECK(cache.get(1) == 7);
+        std::this_thread::sleep_for(60ms);
+        CHECK(cache.get(1) == 7);   // starts a refresh, which fails
+        std::this_thread::sleep_for(100ms);
+        CHECK(cache.get(1) == 7 && cache.contains(1));   // expired, inside the stale window
+        std::this_thread::sleep_for(350ms);
+        CHECK_THROWS(cache.get(1), std::runtime_error);
+        CHECK(!cache.contains(1));
+    }
+
+    // Waiters of a failed blocking load get the stale value too; without a window, the error
+    void failed_load_serves_stale_to_every_waiter() {
+        std::atomic<int> loads{0};
+        ThreadSafeCache<int, int, NoEviction, NodeStorage, TimerWheelExpiration> cache([&](int) {
+            if (loads++ > 0) {
+                std::this_thread::sleep_for(30ms);
+                throw std::runtime_error("backend down");
+            }
+            return 9;
+        }, {.shards = 1, .expiry = Expiry::after_write(50ms), .serve_stale_for = 500ms});
+        CHECK(cache.get(1) == 9);
+        std::this_thread::sleep_for(70ms);
+        std::atomic<int> stale{0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&] {
+                if (cache.get(1) == 9) ++stale;
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        CHECK(stale == 4);
+
+        ThreadSafeCache<int, int, NoEviction, NodeStorage, TimerWheelExpiration> strict([](int) -> int {
+            throw std::runtime_error("backend down");
+        }, {.expiry = Expiry::after_write(10ms)});
+        strict.put(1, 1);
+        std::this_thread::sleep_for(20ms);
+        CHECK_THROWS(strict.get(1), std::runtime_error);
+    }
+
+    void destroyed_with_refresh_pending() {
+        auto cache = std::make_unique<ThreadSafeCache<int, int, NoEviction, NodeStorage, TimerWheelExpiration>>([](int key) {
+            std::this_thread::sleep_for(100ms);
+            return key;
+        }, CacheOptions{.expiry = Expiry::after_write(1s), .refresh_after = 1ms});
+        cache->put(1, 1);
+        std::this_thread::sleep_for(5ms);
+        CHECK(cache->get(1) == 1);
+        cache.reset();   // waits for the reload, which must not touch freed memory
+    }
+
+    void refreshes_race_writes() {
+        std::atomic<int> loads{0};
+        ThreadSafeCache<int, int, S3FifoEviction, ConcurrentStorage, TimerWheelExpiration> cache([&](int key) {
+            if (++loads % 3 == 0) throw std::runtime_error("flaky");
+            return key;
+        }, {.shards = 4, .max_entries = 300, .expiry = Expiry::after_write(3ms), .refresh_after = 1ms, .serve_stale_for = 2ms});
+        std::atomic<bool> stop{false};
+        std::vector<std::thread> readers;
+        for (unsigned t = 0; t < 3; ++t) {
+            readers.emplace_back([&, t] {
+                std::mt19937 rng{t};
+                while (!stop) {
+                    const auto key = static_cast<int>(rng() % 500);
+                    try {
+                        const auto value = cache.get(key);
+                        CHECK(!value || *value == key);
+                    } catch (const std::runtime_error&) {
+                    }
+                }
+            });
+        }
+        std::mt19937 rng{9};
+        for (int i = 0; i < 20'000; ++i) {
+            const auto key = static_cast<int>(rng() % 500);
+            if (i % 5 == 0) {
+                cache.erase(key);
+            } else if (i % 4000 == 0) {
+                cache.clear();
+            } else {
+                cache.put(key, key);
+            }
+            if (i % 100 == 0) std::this_thread::sleep_for(100us);
+        }
+        stop = true;
+        for (auto& reader : readers) reader.join();
+    }
+}
+
+int main()
+{
+    due_entries_refresh_in_the_background();
+    failed_refresh_serves_stale_within_the_window();
+    failed_load_serves_stale_to_every_waiter();
+    destroyed_with_refresh_pending();
+    refreshes_race_writes();
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include "../ThreadSafeCache.h"
+#include "Check.h"
+
+// Removal listener: every value that leaves the cache is reported once, with its cause, off the
+// writer's thread; a listener may call back into the cache or throw, and the queue is drained
+// when the cache is destroyed
+
+namespace {
+    using namespace std::chrono_literals;
+
+    template<typename Key, typename Value>
+    struct Log {
+        std::mutex mutex;
+        std::vector<std::tuple<Key, Value, RemovalCause>> events;
+
+        void add(const Key& key, const Value& value, RemovalCause cause) {
+            std::lock_guard lock{mutex};
+            events.emplace_back(key, value, cause);
+        }
+        auto count(RemovalCause cause) -> std::size_t {
+            std::lock_guard lock{mutex};
+            std::size_t n = 0;
+            for (const auto& event : events) n += std::get<2>(event) == cause;
+            return n;
+        }
+        auto size() -> std::size_t {
+            std::lock_guard lock{mutex};
+            return events.size();
+        }
+    };
+
+    // Delivery is asynchronous: waits up to two seconds for condition
+    template<typename Condition>
+    bool eventually(Condition condition) {
+        for (int i = 0; i < 2000 && !condition(); ++i) std::this_thread::sleep_for(1ms);
+        return condition();
+    }
+
+    void causes() {
+        Log<int, std::string> log;
+        ThreadSafeCache<int, std::string, LruEviction> cache(nullptr, {.shards = 1, .max_entries = 4});
+        cache.set_removal_listener([&](const int& key, const std::string& value, RemovalCause cause) { log.add(key, value, cause); });
+        CHECK_THROWS(cache.set_removal_listener([](const int&, const std::string&, RemovalCause) {}), std::logic_error);
+
+        for (int i = 0; i < 6; ++i) cache.put(i, "v" + std::to_string(i));
+        CHECK(eventually([&] { return log.count(RemovalCause::evicted) == 2; }));
+        cache.put(5, "new");
+        CHECK(eventually([&] { return log.count(RemovalCause::replaced) == 1; }));
+        {
+            std::lock_guard lock{log.mutex};
+            CHECK(std::get<0>(log.events.back()) == 5 && std::get<1>(log.events.back()) == "v5");
+        }
+        CHECK(cache.erase(4) && !cache.erase(99));
+        CHECK(eventually([&] { return log.count(RemovalCause::erased) == 1; }));
+        cache.clear();
+        CHECK(eventually([&] { return log.count(RemovalCause::erased) == 4; }));
+        CHECK(log.size() == 7);
+    }
+
+    // A listener that reads the cache and throws does not stop later deliveries
+    void reentrant_throwing_listener() {
+        using Expiring = ThreadSafeCache<int, SharedValue<std::string>, NoEviction, NodeStorage, TimerWheelExpiration>;
+        Log<int, std::string> log;
+        Expiring cache(nullptr, {.shards = 1, .expiry = Expiry::after_write(20ms)});
+        cache.set_removal_listener([&](const int& key, const std::string& value, RemovalCause cause) {
+            (void)cache.size();
+            log.add(key, value, cause);
+            if (key == 1) throw std::runtime_error("listener failed");
+        });
+        for (int i = 0; i < 3; ++i) cache.put(i, std::string("x"));
+        std::this_thread::sleep_for(60ms);
+        cache.put(10, std::string("y"));   // drives the wheel
+        CHECK(eventually([&] { return log.count(RemovalCause::expired) == 3; }));
+    }
+
+    // Every value put either is still cached or was reported exactly once
+    template<typename Eviction>
+    void concurrent_writers_account_for_every_value() {
+        constexpr int threads = 4;
+        constexpr int puts = 5000;
+        Log<std::string, int> log;
+        std::size_t resident = 0;
+        {
+            ThreadSafeCache<std::string, int, Eviction> cache(nullptr, {.shards = 4, .max_entries = 64});
+            cache.set_removal_listener([&](const std::string& key, const int& value, RemovalCause cause) { log.add(key, value, cause); });
+            std::vector<std::thread> writers;
+            for (int t = 0; t < threads; ++t) {
+                writers.emplace_back([&, t] {
+                    for (int i = 0; i < puts; ++i) {
+                        cache.put(std::to_string((i * 7 + t) % 500), i);
+                        if (i % 10 == 0) cache.erase(std::string_view(std::to_string(i % 500)));
+                    }
+                });
+            }
+            for (auto& writer : writers) writer.join();
+            resident = cache.size();
+        }
+        CHECK(resident + log.size() == threads * puts);
+        CHECK(log.count(RemovalCause::evicted) > 0 && log.count(RemovalCause::replaced) > 0 && log.count(RemovalCause::erased) > 0);
+    }
+}
+
+int main()
+{
+    causes();
+    reentrant_throwing_listener();
+    concurrent_writers_account_for_every_value<LruEviction>();
+    concurrent_writers_account_for_every_value<TinyLfuAdmission<>>();
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include <string>
+#include <thread>
+#include <vector>
+#include "../ThreadSafeCache.h"
+#include "Check.h"
+
+// Lock-striped shards: the shard count, and get/put/erase/clear from many threads at once
+
+namespace {
+    void shard_count_is_a_power_of_two() {
+        CHECK((ThreadSafeCache<int, int>(nullptr, {.shards = 8}).shard_count() == 8));
+        CHECK((ThreadSafeCache<int, int>(nullptr, {.shards = 5}).shard_count() == 8));
+        CHECK((ThreadSafeCache<int, int>(nullptr, {.shards = 0}).shard_count() == 1));
+    }
+
+    void basic_operations() {
+        ThreadSafeCache<int, std::string> cache(nullptr, {.shards = 4});
+        CHECK(!cache.get(1));
+        cache.put(1, "one");
+        CHECK(cache.contains(1) && cache.size() == 1);
+        CHECK(*cache.get(1) == "one");
+        cache.put(1, "uno");
+        CHECK(*cache.get(1) == "uno" && cache.size() == 1);
+        CHECK(cache.erase(1) && !cache.erase(1));
+        for (int key = 0; key < 1000; ++key) cache.put(key, std::to_string(key));
+        CHECK(cache.size() == 1000);
+        cache.clear();
+        CHECK(cache.size() == 0 && !cache.contains(7));
+    }
+
+    void concurrent_gets_and_erases() {
+        ThreadSafeCache<int, std::string> cache([](int key) { return std::to_string(key); }, {.shards = 8});
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&cache, t] {
+                for (int i = 0; i < 5000; ++i) {
+                    const int key = (i * 31 + t) % 500;
+                    CHECK(*cache.get(key) == std::to_string(key));
+                    if (i % 7 == 0) cache.erase(key);
+                    if (i % 11 == 0) cache.put(key, std::to_string(key));
+                }
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        CHECK(cache.size() <= 500);
+    }
+}
+
+int main()
+{
+    shard_count_is_a_power_of_two();
+    basic_operations();
+    concurrent_gets_and_erases();
+    return 0;
+}
@@ -0,0 +1,54 @@
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../ThreadSafeCache.h"
+#include "Check.h"
+
+// Zero-copy access: SharedValue handles, with() visits in place, and empty handles rejected
+
+namespace {
+    void gets_share_one_value() {
+        ThreadSafeCache<int, SharedValue<std::string>> cache([](int key) { return std::string(100, static_cast<char>('a' + key)); });
+        const auto first = cache.get(1);
+        const auto second = cache.get(1);
+        CHECK(first && first.get() == second.get());
+        CHECK(first->size() == 100 && (*first)[0] == 'b');
+
+        auto handle = std::make_shared<const std::string>("stored");
+        cache.put(2, handle);
+        CHECK(cache.get(2).get() == handle.get());
+        cache.put(3, std::string("by value"));
+        CHECK(*cache.get(3) == "by value");
+    }
+
+    void with_visits_in_place() {
+        ThreadSafeCache<int, std::string> cache(nullptr);
+        cache.put(42, "forty-two");
+        CHECK(cache.with(42, [](const std::string& value) { return value.size(); }) == 9u);
+        CHECK(!cache.with(7, [](const std::string& value) { return value.size(); }));
+        bool seen = false;
+        CHECK(cache.with(42, [&](const std::string&) { seen = true; }) && seen);
+    }
+
+    void empty_handles_are_rejected() {
+        ThreadSafeCache<int, SharedValue<std::string>> cache(nullptr);
+        CHECK_THROWS(cache.put(1, std::shared_ptr<const std::string>{}), std::invalid_argument);
+        CHECK_THROWS(cache.put(1, nullptr), std::invalid_argument);
+        CHECK(!cache.contains(1) && cache.size() == 0);
+
+        std::vector<std::pair<int, std::shared_ptr<const std::string>>> batch{
+            {1, std::make_shared<const std::string>("one")}, {2, nullptr}, {3, std::make_shared<const std::string>("three")}};
+        CHECK_THROWS(cache.put_all(batch), std::invalid_argument);
+        CHECK(cache.size() == 0);   // nothing stored: every value is checked first
+    }
+}
+
+int main()
+{
+    gets_share_one_value();
+    with_visits_in_place();
+    empty_handles_are_rejected();
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../ThreadSafeCache.h"
+#include "Check.h"
+
+// Single-flight loading: concurrent misses of one key share one loader call, its value or its
+// error, and a failed load leaves nothing behind that blocks the next one
+
+namespace {
+    using namespace std::chrono_literals;
+
+    constexpr int threads = 8;
+
+    // Runs body on threads threads released together
+    template<typename Body>
+    void together(Body body) {
+        std::atomic<int> ready{0};
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                ready.fetch_add(1);
+                while (ready.load() < threads) std::this_thread::yield();
+                body(t);
+            });
+        }
+        for (auto& worker : workers) worker.join();
+    }
+
+    void concurrent_misses_share_one_load() {
+        std::atomic<int> loads{0};
+        ThreadSafeCache<int, std::string> cache([&](int key) {
+            ++loads;
+            std::this_thread::sleep_for(20ms);
+            return std::to_string(key);
+        });
+        std::atomic<int> wrong{0};
+        together([&](int) {
+            if (cache.get(42) != "42") wrong.fetch_add(1);
+        });
+        CHECK(wrong == 0 && loads == 1);
+    }
+
+    void waiters_share_the_error_then_retry() {
+        std::atomic<int> loads{0};
+        std::atomic<bool> failing{true};
+        ThreadSafeCache<int, int> cache([&](int key) {
+            ++loads;
+            std::this_thread::sleep_for(20ms);
+            if (failing) throw std::runtime_error("backend down");
+            return key;
+        });
+        std::atomic<int> failed{0};
+        together([&](int) {
+            try {
+                cache.get(7);
+            } catch (const std::runtime_error&) {
+                failed.fetch_add(1);
+            }
+        });
+        CHECK(failed == threads && loads >= 1 && loads < threads);
+        CHECK(!cache.contains(7));
+
+        // The failed flight is gone: the next miss loads again
+        failing = false;
+        const auto before = loads.load();
+        CHECK(cache.get(7) == 7 && loads == before + 1);
+        CHECK(cache.get(7) == 7 && loads == before + 1);
+    }
+
+    // A load that overlaps an erase still answers its waiters, but is not cached
+    void erase_during_load_is_not_undone() {
+        std::atomic<bool> loading{false};
+        ThreadSafeCache<int, int> cache([&](int key) {
+            loading = true;
+            std::this_thread::sleep_for(50ms);
+            return key;
+        });
+        std::thread reader([&] { CHECK(cache.get(3) == 3); });
+        while (!loading) std::this_thread::yield();
+        cache.erase(3);
+        reader.join();
+        CHECK(!cache.contains(3));
+    }
+
+    // Alternating failures and successes from many threads: every get either gets the value or
+    // the error, and no key is left with a flight nobody finishes
+    void failures_and_successes_interleave() {
+        std::atomic<int> calls{0};
+        ThreadSafeCache<int, int> cache([&](int key) {
+            if (calls.fetch_add(1) % 2 == 0) throw std::runtime_error("flaky");
+            return key;
+        });
+        together([&](int t) {
+            for (int i = 0; i < 2000; ++i) {
+                const int key = (i + t) % 16;
+                try {
+                    CHECK(cache.get(key) == key);
+                } catch (const std::runtime_error&) {
+                }
+                if (i % 7 == 0) cache.erase(key);
+            }
+        });
+        for (int key = 0; key < 16; ++key) {
+            std::optional<int> value;
+            for (int attempt = 0; attempt < 4 && !value; ++attempt) {
+                try {
+                    value = cache.get(key);
+                } catch (const std::runtime_error&) {
+                }
+            }
+            CHECK(value == key);
+        }
+    }
+}
+
+int main()
+{
+    concurrent_misses_share_one_load();
+    waiters_share_the_error_then_retry();
+    erase_during_load_is_not_undone();
+    failures_and_successes_interleave();
+    return 0;
+}
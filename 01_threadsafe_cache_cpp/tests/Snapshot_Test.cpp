@@ -0,0 +1,172 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+#include "../ThreadSafeCache.h"
+#include "Check.h"
+
+// Snapshots: save and load round-trip every storage, value codec and expiry kind, refuse files of
+// other types or cut short, and a save taken under concurrent writers loads back consistent
+
+namespace {
+    using namespace std::chrono_literals;
+
+    struct User {
+        std::string name;
+        int age;
+    };
+}
+
+template<>
+struct CacheCodec<User> {
+    static void write(std::string& out, const User& user) {
+        CacheCodec<std::string>::write(out, user.name);
+        CacheCodec<int>::write(out, user.age);
+    }
+    static auto read(std::string_view& in) -> User {
+        auto name = CacheCodec<std::string>::read(in);
+        return User{std::move(name), CacheCodec<int>::read(in)};
+    }
+};
+
+namespace {
+    auto temp_path(const std::string& name) -> std::string {
+        return "/tmp/Snapshot_Test_" + std::to_string(::getpid()) + "_" + name;
+    }
+
+    // A snapshot loads into a cache of another policy and shard count; present keys are kept
+    template<typename Storage>
+    void round_trip() {
+        const auto path = temp_path("ints.bin");
+        ThreadSafeCache<int, long, NoEviction, Storage> saved(nullptr, {.shards = 8});
+        for (int i = 0; i < 10000; ++i) saved.put(i, i * 3L);
+        CHECK(saved.save(path) == 10000);
+
+        ThreadSafeCache<int, long, LruEviction, Storage> loaded(nullptr, {.shards = 4});
+        loaded.put(5, -1L);
+        CHECK(loaded.load(path) == 9999);
+        CHECK(loaded.size() == 10000 && loaded.get(5) == -1 && loaded.get(9999) == 29997);
+
+        ThreadSafeCache<int, long, LruEviction, Storage> small(nullptr, {.shards = 4, .max_entries = 100});
+        small.load(path);
+        CHECK(small.size() <= 100);
+        std::remove(path.c_str());
+    }
+
+    void strings_and_shared_values() {
+        const auto path = temp_path("strings.bin");
+        ThreadSafeCache<std::string, SharedValue<std::string>> saved(nullptr);
+        for (int i = 0; i < 1000; ++i) saved.put("k" + std::to_string(i), std::string(i % 50, 'x'));
+        CHECK(saved.save(path) == 1000);
+        ThreadSafeCache<std::string, std::string> loaded(nullptr);
+        CHECK(loaded.load(path) == 1000);
+        CHECK(loaded.get("k49") == std::string(49, 'x') && loaded.get("k50") == "");
+        std::remove(path.c_str());
+    }
+
+    void bad_files() {
+        const auto path = temp_path("users.bin");
+        ThreadSafeCache<int, User> saved(nullptr);
+        saved.put(1, User{"ann", 30});
+        saved.put(2, User{"bob", 40});
+        saved.save(path);
+        ThreadSafeCache<int, User> loaded(nullptr);
+        CHECK(loaded.load(path) == 2 && loaded.get(2)->name == "bob" && loaded.get(1)->age == 30);
+
+        ThreadSafeCache<int, long> wrong(nullptr);
+        CHECK_THROWS(wrong.load(path), std::runtime_error);
+        CHECK_THROWS(wrong.load(temp_path("missing")), std::system_error);
+
+        const auto truncated = temp_path("truncated.bin");
+        {
+            std::ifstream in(path, std::ios::binary);
+            const std::string bytes{std::istreambuf_iterator<char>(in), {}};
+            std::ofstream(truncated, std::ios::binary).write(bytes.data(), static_cast<std::streamsize>(bytes.size() - 3));
+        }
+        ThreadSafeCache<int, User> target(nullptr);
+        CHECK_THROWS(target.load(truncated), std::runtime_error);
+        const auto empty = temp_path("empty.bin");
+        std::ofstream{empty};
+        CHECK_THROWS(target.load(empty), std::runtime_error);
+        for (const auto& file : {path, truncated, empty}) std::remove(file.c_str());
+    }
+
+    // Remaining lifetimes are saved, so entries that expired in between are not loaded
+    void expiry_ages() {
+        using Expiring = ThreadSafeCache<int, int, NoEviction, NodeStorage, TimerWheelExpiration>;
+        const auto path = temp_path("expiring.bin");
+        Expiring saved(nullptr, {.shards = 2});
+        saved.put(1, 1, Expiry::after_write(50ms));
+        saved.put(2, 2, Expiry::after_write(1h));
+        saved.put(3, 3);
+        saved.put(4, 4, Expiry::after_access(40ms));
+        CHECK(saved.save(path) == 4);
+        std::this_thread::sleep_for(100ms);
+        Expiring loaded(nullptr, {.shards = 2});
+        CHECK(loaded.load(path) == 2);
+        CHECK(!loaded.contains(1) && loaded.contains(2) && loaded.contains(3) && !loaded.contains(4));
+        ThreadSafeCache<int, int> plain(nullptr);
+        CHECK(plain.load(path) == 2);
+
+        // Entries saved without a lifetime take the loading cache's default
+        const auto unbounded = temp_path("unbounded.bin");
+        ThreadSafeCache<int, int> forever(nullptr);
+        forever.put(7, 7);
+        forever.save(unbounded);
+        Expiring expiring(nullptr, {.expiry = Expiry::after_write(50ms)});
+        expiring.load(unbounded);
+        CHECK(expiring.contains(7));
+        std::this_thread::sleep_for(100ms);
+        CHECK(!expiring.contains(7));
+        std::remove(path.c_str());
+        std::remove(unbounded.c_str());
+    }
+
+    void save_under_writers() {
+        const auto path = temp_path("concurrent.bin");
+        ThreadSafeCache<int, int, LruEviction, ConcurrentStorage> cache([](int key) { return key; }, {.shards = 8, .max_entries = 5000});
+        std::atomic<bool> stop{false};
+        std::vector<std::thread> writers;
+        for (int t = 0; t < 3; ++t) {
+            writers.emplace_back([&, t] {
+                for (int i = t; !stop; i += 3) {
+                    cache.put(i % 20000, i % 20000);
+                    cache.get((i * 7) % 20000);
+                    if (i % 5 == 0) cache.erase(i % 20000);
+                }
+            });
+        }
+        for (int round = 0; round < 5; ++round) CHECK(cache.save(path) <= 5000);
+        stop = true;
+        for (auto& writer : writers) writer.join();
+
+        ThreadSafeCache<int, int> loaded(nullptr);
+        const auto count = loaded.load(path);
+        CHECK(count == loaded.size());
+        for (int key = 0; key < 20000; ++key) {
+            if (const auto value = loaded.get(key)) CHECK(*value == key);
+        }
+        std::remove(path.c_str());
+    }
+}
+
+int main()
+{
+    round_trip<NodeStorage>();
+    round_trip<FlatStorage>();
+    round_trip<ConcurrentStorage>();
+    strings_and_shared_values();
+    bad_files();
+    expiry_ages();
+    save_under_writers();
+    return 0;
+}
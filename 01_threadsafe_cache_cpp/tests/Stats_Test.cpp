@@ -0,0 +1,120 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../ThreadSafeCache.h"
+#include "Check.h"
+
+// CacheStats: hits, misses, loads, failures, coalesced waits, evictions and expirations are each
+// counted once whichever path served the call, and the latency histograms bracket what they time
+
+namespace {
+    using namespace std::chrono_literals;
+
+    void histogram_buckets_cover_every_value() {
+        for (std::uint64_t value : {0ull, 1ull, 31ull, 32ull, 33ull, 100ull, 1000ull, 123'456'789ull, (1ull << 40) - 1}) {
+            const auto bucket = LatencySnapshot::index_of(value);
+            CHECK(LatencySnapshot::lowest_of(bucket) <= value);
+            if (bucket + 1 < LatencySnapshot::bucket_count) CHECK(LatencySnapshot::lowest_of(bucket + 1) > value);
+        }
+        for (std::size_t bucket = 1; bucket < LatencySnapshot::bucket_count; ++bucket) {
+            CHECK(LatencySnapshot::lowest_of(bucket) > LatencySnapshot::lowest_of(bucket - 1));
+        }
+    }
+
+    void gets_loads_and_evictions() {
+        ThreadSafeCache<int, std::string, LruEviction, NodeStorage, TimerWheelExpiration, CacheStats> cache([](int key) {
+            std::this_thread::sleep_for(1ms);
+            if (key < 0) throw std::runtime_error("negative");
+            return std::to_string(key);
+        }, {.shards = 4, .max_entries = 40});
+        for (int key = 0; key < 100; ++key) cache.get(key);
+        for (int key = 60; key < 100; ++key) cache.get(key);
+        CHECK_THROWS(cache.get(-1), std::runtime_error);
+        const auto stats = cache.stats();
+        CHECK(stats.hits + stats.misses == 141 && stats.misses >= 101);
+        CHECK(stats.loads == stats.misses - 1 && stats.load_failures == 1);
+        CHECK(stats.evictions >= 60);
+        CHECK(stats.load_latency.count == stats.misses);
+        CHECK(stats.load_latency.percentile(0.5) >= 1ms && stats.load_latency.percentile(0.5) < 200ms);
+        CHECK(stats.get_latency.count > 0);   // sampled
+    }
+
+    void waiters_count_as_coalesced() {
+        ThreadSafeCache<int, std::string, NoEviction, NodeStorage, NoExpiration, CacheStats> cache([](int key) {
+            std::this_thread::sleep_for(50ms);
+            return std::to_string(key);
+        }, {.shards = 2});
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 8; ++t) threads.emplace_back([&] { cache.get(7); });
+        for (auto& thread : threads) thread.join();
+        const auto stats = cache.stats();
+        CHECK(stats.loads == 1 && stats.coalesced_waits + stats.hits == 7);
+    }
+
+    void bulk_async_and_with_count_once() {
+        const std::vector<int> keys{1, 2, 3, 4, 5};
+        ThreadSafeCache<int, int, NoEviction, NodeStorage, NoExpiration, CacheStats> batched(nullptr, [](std::span<const int> batch) {
+            return std::vector<int>(batch.begin(), batch.end());
+        });
+        batched.get_all(keys);
+        batched.get_all(keys);
+        batched.with(1, [](int) {});
+        batched.with(99, [](int) {});
+        auto stats = batched.stats();
+        CHECK(stats.loads == 5 && stats.misses == 6 && stats.hits == 6 && stats.load_latency.count == 1);
+
+        ThreadSafeCache<int, int, NoEviction, NodeStorage, NoExpiration, CacheStats> one_by_one([](int key) { return key; });
+        one_by_one.get_all(keys);
+        one_by_one.get_all(keys);
+        stats = one_by_one.stats();
+        CHECK(stats.loads == 5 && stats.misses == 5 && stats.hits == 5);
+
+        ThreadSafeCache<int, int, NoEviction, NodeStorage, NoExpiration, CacheStats> async([](const int& key) -> CacheTask<int> { co_return key; });
+        sync_wait(async.get_async(3));
+        sync_wait(async.get_async(3));
+        stats = async.stats();
+        CHECK(stats.loads == 1 && stats.hits == 1 && stats.misses == 1);
+    }
+
+    void expirations() {
+        ThreadSafeCache<int, int, NoEviction, NodeStorage, TimerWheelExpiration, CacheStats> cache(nullptr, {.shards = 1, .expiry = Expiry::after_write(5ms)});
+        for (int key = 0; key < 10; ++key) cache.put(key, key);
+        std::this_thread::sleep_for(50ms);
+        cache.put(100, 1);   // the write reaps the ten due entries
+        CHECK(cache.stats().expirations == 10);
+    }
+
+    void counters_add_up_across_threads() {
+        ThreadSafeCache<int, int, LruEviction, NodeStorage, NoExpiration, CacheStats> cache([](int key) { return key; }, {.shards = 8, .max_entries = 100});
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < 20'000; ++i) {
+                    cache.get((i * 7 + t) % 300);
+                    if (i % 1000 == 0) (void)cache.stats();
+                }
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        const auto stats = cache.stats();
+        CHECK(stats.hits + stats.misses == 80'000);
+        CHECK(stats.hit_ratio() >= 0.0 && stats.hit_ratio() <= 1.0);
+    }
+}
+
+int main()
+{
+    static_assert(sizeof(ThreadSafeCache<int, int>) == sizeof(ThreadSafeCache<int, int, NoEviction, NodeStorage, NoExpiration, NoStats>));
+    histogram_buckets_cover_every_value();
+    gets_loads_and_evictions();
+    waiters_count_as_coalesced();
+    bulk_async_and_with_count_once();
+    expirations();
+    counters_add_up_across_threads();
+    return 0;
+}
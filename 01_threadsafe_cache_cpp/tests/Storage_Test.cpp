@@ -0,0 +1,155 @@
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../ThreadSafeCache.h"
+#include "Check.h"
+
+// Storage backends: each table agrees with std::unordered_map over a random mix of inserts,
+// assigns, erases and lookups, and a cache over it stays correct under concurrent use; the
+// lock-free table keeps its entries in place, and findable, while it grows under readers
+
+namespace {
+    struct Clumped {
+        int key;
+        friend bool operator==(const Clumped&, const Clumped&) = default;
+    };
+}
+
+template<>
+struct CacheHash<Clumped> {
+    auto operator()(const Clumped& clumped) const noexcept -> std::size_t { return static_cast<std::size_t>(clumped.key / 200); }
+};
+
+namespace {
+    template<typename Storage>
+    void matches_unordered_map() {
+        typename Storage::template Table<std::string, std::string> table;
+        std::unordered_map<std::string, std::string> reference;
+        std::mt19937 rng{5};
+        for (int i = 0; i < 200'000; ++i) {
+            const auto key = std::to_string(rng() % 5000);
+            const auto hash = std::hash<std::string>{}(key);
+            switch (rng() % 4) {
+            case 0: {
+                const auto [mapped, inserted] = table.try_emplace(key, hash, key + "v");
+                const auto [it, expected] = reference.try_emplace(key, key + "v");
+                CHECK(inserted == expected && *mapped == it->second);
+                break;
+            }
+            case 1:
+                if (table.find(key, hash)) {
+                    CHECK(*table.assign(key, hash, key + "w") == key + "w");
+                    reference[key] = key + "w";
+                }
+                break;
+            case 2:
+                CHECK(table.erase(key, hash) == (reference.erase(key) > 0));
+                break;
+            default: {
+                const auto* mapped = table.find(key, hash);
+                const auto it = reference.find(key);
+                CHECK((mapped != nullptr) == (it != reference.end()));
+                if (mapped) CHECK(*mapped == it->second);
+            }
+            }
+            if (i % 50'000 == 0) {
+                std::size_t visited = 0;
+                table.for_each([&](const std::string& key, const std::string& mapped) {
+                    CHECK(reference.at(key) == mapped);
+                    ++visited;
+                });
+                CHECK(visited == reference.size() && table.size() == visited);
+            }
+        }
+        table.clear();
+        CHECK(table.size() == 0 && !table.find(std::string("1"), std::hash<std::string>{}("1")));
+    }
+
+    template<typename Storage>
+    void concurrent_cache() {
+        ThreadSafeCache<int, std::string, S3FifoEviction, Storage> cache([](int key) { return std::to_string(key); },
+                                                                          {.shards = 4, .max_entries = 300});
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < 4; ++t) {
+            threads.emplace_back([&cache, t] {
+                std::mt19937 rng{t};
+                for (int i = 0; i < 20'000; ++i) {
+                    const int key = static_cast<int>(rng() % 2000);
+                    CHECK(cache.get(key) == std::to_string(key));
+                    if (i % 13 == 0) cache.erase(key);
+                    if (i % 17 == 0) cache.put(key, std::to_string(key));
+                }
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        CHECK(cache.size() <= 300);
+    }
+
+    // Stands in for an entry's access stamp, which lock-free readers update
+    struct Touched {
+        Touched() = default;
+        Touched(Touched&&) noexcept {}
+        mutable std::atomic<int> hits{0};
+    };
+
+    // Growth re-links the nodes it does not copy, so touches made through a pointer held across
+    // a resize all land, and readers racing the resizes always find keys that are present
+    void concurrent_growth_keeps_touches() {
+        ConcurrentStorage::Table<int, Touched> table;
+        constexpr int held = 64;
+        for (int key = 0; key < held; ++key) table.try_emplace(key, CacheHash<int>{}(key), Touched{});
+        std::atomic<bool> stop{false};
+        std::atomic<int> touches{0};
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 3; ++t) {
+            readers.emplace_back([&, t] {
+                for (int i = t; !stop.load(std::memory_order_relaxed); ++i) {
+                    cache_detail::EpochGuard guard;
+                    const auto* entry = table.find(i % held, CacheHash<int>{}(i % held));
+                    CHECK(entry);
+                    std::this_thread::yield();   // keep the pointer across a resize
+                    entry->hits.fetch_add(1, std::memory_order_relaxed);
+                    touches.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+        for (int key = held; key < 200'000; ++key) table.try_emplace(key, CacheHash<int>{}(key), Touched{});
+        stop = true;
+        for (auto& reader : readers) reader.join();
+        int counted = 0;
+        for (int key = 0; key < held; ++key) counted += table.find(key, CacheHash<int>{}(key))->hits.load();
+        CHECK(counted == touches.load() && counted > 0);
+    }
+
+    // Runs of 200 equal hashes: long probe sequences, shifted on every erase, still fit the
+    // byte of probe distance Robin Hood keeps per slot
+    void flat_survives_clustered_hashes() {
+        FlatStorage::Table<Clumped, int> table;
+        const auto hash = [](int key) { return CacheHash<Clumped>{}(Clumped{key}); };
+        for (int key = 0; key < 2000; ++key) CHECK(table.try_emplace(Clumped{key}, hash(key), int{key}).second);
+        for (int key = 0; key < 2000; key += 3) CHECK(table.erase(Clumped{key}, hash(key)));
+        for (int key = 0; key < 2000; ++key) {
+            const auto* mapped = table.find(Clumped{key}, hash(key));
+            CHECK(key % 3 == 0 ? !mapped : mapped && *mapped == key);
+        }
+        CHECK(table.size() == 2000 - 667);
+    }
+}
+
+int main()
+{
+    matches_unordered_map<NodeStorage>();
+    matches_unordered_map<FlatStorage>();
+    matches_unordered_map<ConcurrentStorage>();
+    concurrent_cache<NodeStorage>();
+    concurrent_cache<FlatStorage>();
+    concurrent_cache<ConcurrentStorage>();   // lock-free hits racing evictions, under TSan too
+    flat_survives_clustered_hashes();
+    concurrent_growth_keeps_touches();
+    return 0;
+}
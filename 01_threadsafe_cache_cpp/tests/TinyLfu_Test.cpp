@@ -0,0 +1,91 @@
+#include <cstddef>
+#include <cstdint>
+#include "../ThreadSafeCache.h"
+#include "Check.h"
+
+// W-TinyLFU: the count-min sketch never underestimates until it ages, and admission keeps a hot
+// set that a one-pass scan would flush out of a plain LRU. Aging lets it fade after scans many
+// times the capacity long, so the scan here is five times the capacity.
+
+namespace {
+    void sketch_counts_and_ages() {
+        cache_detail::FrequencySketch sketch;
+        CHECK(sketch.frequency(1) == 0);   // unsized: counts nothing
+        sketch.set_capacity(64);
+        for (int i = 0; i < 5; ++i) sketch.increment(42);
+        CHECK(sketch.frequency(42) >= 5);
+        for (int i = 0; i < 20; ++i) sketch.increment(7);
+        CHECK(sketch.frequency(7) == 15);   // 4-bit counters saturate
+
+        bool aged = false;
+        for (std::uint64_t hash = 1000; !aged; ++hash) aged = sketch.increment(hash);
+        CHECK(sketch.frequency(7) <= 8);   // halved
+        sketch.clear();
+        CHECK(sketch.frequency(42) == 0 && sketch.frequency(7) == 0);
+    }
+
+    void doorkeeper_remembers_first_sightings() {
+        cache_detail::Doorkeeper doorkeeper;
+        doorkeeper.set_capacity(64);
+        CHECK(!doorkeeper.contains(9) && !doorkeeper.put(9));
+        CHECK(doorkeeper.contains(9) && doorkeeper.put(9));
+        doorkeeper.clear();
+        CHECK(!doorkeeper.contains(9));
+    }
+
+    template<typename Eviction>
+    auto hot_keys_after_scan() -> std::size_t {
+        constexpr int hot = 50;
+        ThreadSafeCache<int, int, Eviction> cache(nullptr, {.shards = 1, .max_entries = 200});
+        for (int round = 0; round < 20; ++round) {
+            for (int key = 0; key < hot; ++key) {
+                if (!cache.get(key)) cache.put(key, key);
+            }
+        }
+        for (int key = 1000; key < 2000; ++key) cache.put(key, key);   // each seen once
+        std::size_t kept = 0;
+        for (int key = 0; key < hot; ++key) kept += cache.contains(key);
+        CHECK(cache.size() <= 200);
+        return kept;
+    }
+
+    // Rejected candidates leave the main policy alone: here its CLOCK bits survive a scan, so
+    // once every entry is referenced again the oldest one goes, not the first whose bit a
+    // rejection had cleared
+    void rejections_keep_main_state() {
+        TinyLfuAdmission<ClockEviction>::State<int> policy;
+        policy.set_capacity(100);   // window 1, main 99
+        for (int key = 0; key < 100; ++key) policy.on_insert(key);
+        const auto first = policy.victim();   // fills main, then turns 99 away
+        CHECK(policy.key_of(first) == 99);
+        policy.on_evict(first);
+        std::uint32_t handles[99];
+        for (std::uint32_t handle = 0; handle < 99; ++handle) handles[policy.key_of(handle)] = handle;
+        for (const auto handle : handles) policy.on_access(handle);
+        for (int key = 1000; key < 1050; ++key) {
+            policy.on_insert(key);
+            const auto victim = policy.victim();
+            CHECK(policy.key_of(victim) == key);
+            policy.on_evict(victim);
+        }
+        policy.on_access(handles[0]);
+        const auto strong = policy.on_insert(2000);
+        for (int i = 0; i < 5; ++i) policy.on_access(strong);
+        CHECK(policy.key_of(policy.victim()) == 0);
+    }
+
+    void admission_resists_scans() {
+        CHECK(hot_keys_after_scan<LruEviction>() == 0);
+        CHECK(hot_keys_after_scan<TinyLfuAdmission<LruEviction>>() >= 45);
+        CHECK(hot_keys_after_scan<TinyLfuAdmission<ClockEviction>>() >= 45);
+    }
+}
+
+int main()
+{
+    sketch_counts_and_ages();
+    doorkeeper_remembers_first_sightings();
+    rejections_keep_main_state();
+    admission_resists_scans();
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <list>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+#include <unistd.h>
+#include "../ThreadSafeCache.h"
+#include "../bench/Trace.h"
+#include "../bench/Workload.h"
+#include "Check.h"
+
+// Trace replay: binary and text traces read back the keys written, in order and in bounded
+// chunks, and a one-shard replay gives exactly the hit ratio of a reference LRU
+
+namespace {
+    auto collect(const Trace& trace) -> std::vector<std::uint64_t> {
+        std::vector<std::uint64_t> keys;
+        trace.for_each_chunk([&](std::span<const std::uint64_t> chunk) {
+            CHECK(!chunk.empty() && chunk.size() <= Trace::chunk_keys);
+            keys.insert(keys.end(), chunk.begin(), chunk.end());
+        });
+        return keys;
+    }
+
+    auto temp_path(const std::string& name) -> std::string {
+        return "/tmp/TraceReplay_Test_" + std::to_string(::getpid()) + "_" + name;
+    }
+
+    void text_lines() {
+        const auto keys = collect(Trace::text("# header\n1\n  22 GET\n\nuser:7,read\r\n-5\n18446744073709551615"));
+        const std::vector<std::uint64_t> expected{1, 22, std::hash<std::string_view>{}("user:7"),
+                                                  std::hash<std::string_view>{}("-5"), 18446744073709551615u};
+        CHECK(keys == expected);
+        CHECK(collect(Trace::text("")).empty() && collect(Trace::text("# only\n\n")).empty());
+    }
+
+    void chunks_cover_the_trace() {
+        std::vector<std::uint64_t> keys(Trace::chunk_keys * 2 + 3);
+        for (std::size_t i = 0; i < keys.size(); ++i) keys[i] = i * 3;
+        CHECK(collect(Trace::binary(keys)) == keys);
+
+        std::string text;
+        for (const auto key : keys) text += std::to_string(key) + "\n";
+        CHECK(collect(Trace::text(text)) == keys);
+    }
+
+    void mapped_files() {
+        const auto path = temp_path("keys.bin");
+        const std::vector<std::uint64_t> keys{5, 1, 5, 9};
+        {
+            std::ofstream out(path, std::ios::binary);
+            out.write(reinterpret_cast<const char*>(keys.data()), static_cast<std::streamsize>(keys.size() * sizeof(std::uint64_t)));
+            out.write("xyz", 3);   // a trailing partial key
+        }
+        {
+            MappedFile file(path);
+            const auto bytes = file.bytes();
+            CHECK(bytes.size() == keys.size() * sizeof(std::uint64_t) + 3);
+            const auto read = collect(Trace::binary({reinterpret_cast<const std::uint64_t*>(bytes.data()), bytes.size() / sizeof(std::uint64_t)}));
+            CHECK(read == keys);
+        }
+        std::remove(path.c_str());
+
+        const auto empty = temp_path("empty.txt");
+        std::ofstream{empty};
+        CHECK(MappedFile(empty).bytes().empty());
+        std::remove(empty.c_str());
+        CHECK_THROWS(MappedFile(temp_path("missing")), std::system_error);
+    }
+
+    // The replay loop of TraceReplay_Bench against a textbook LRU
+    void single_shard_lru_is_exact() {
+        constexpr std::size_t capacity = 500;
+        ZipfGenerator zipf{10'000, 0.9};
+        std::mt19937_64 rng{11};
+        std::vector<std::uint64_t> keys(100'000);
+        for (auto& key : keys) key = zipf(rng);
+
+        ThreadSafeCache<std::uint64_t, std::uint8_t, LruEviction, FlatStorage> cache(nullptr, {.shards = 1, .max_entries = capacity});
+        std::uint64_t misses = 0;
+        std::list<std::uint64_t> order;
+        std::unordered_map<std::uint64_t, std::list<std::uint64_t>::iterator> where;
+        std::uint64_t expected = 0;
+        Trace::binary(keys).for_each_chunk([&](std::span<const std::uint64_t> chunk) {
+            for (const auto key : chunk) {
+                if (!cache.with(key, [](std::uint8_t) {})) {
+                    cache.put(key, std::uint8_t{1});
+                    ++misses;
+                }
+                if (const auto it = where.find(key); it != where.end()) {
+                    order.splice(order.begin(), order, it->second);
+                    continue;
+                }
+                ++expected;
+                order.push_front(key);
+                where[key] = order.begin();
+                if (order.size() > capacity) {
+                    where.erase(order.back());
+                    order.pop_back();
+                }
+            }
+        });
+        CHECK(misses == expected && cache.size() == capacity);
+    }
+}
+
+int main()
+{
+    text_lines();
+    chunks_cover_the_trace();
+    mapped_files();
+    single_shard_lru_is_exact();
+    return 0;
+}
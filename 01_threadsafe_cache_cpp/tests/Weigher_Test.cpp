@@ -0,0 +1,99 @@
+#include <chrono>
+#include <cstddef>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../ThreadSafeCache.h"
+#include "Check.h"
+
+// Weighted capacity: the weigher's total stays within max_weight for every policy and backend,
+// an entry heavier than the budget stays alone, and weight() always sums what is cached
+
+namespace {
+    using namespace std::chrono_literals;
+
+    const auto by_length = [](const int&, const std::string& value) { return value.size(); };
+
+    template<typename Eviction, typename Storage>
+    void stays_within_budget() {
+        ThreadSafeCache<int, std::string, Eviction, Storage> cache(nullptr, {.shards = 1, .max_weight = 1000}, by_length);
+        for (int key = 0; key < 100; ++key) cache.put(key, std::string(100, 'a'));
+        CHECK(cache.weight() <= 1000 && cache.size() == 10);
+        cache.put(500, std::string(5000, 'b'));   // heavier than the budget: cached alone
+        CHECK(cache.size() == 1 && cache.weight() == 5000 && cache.contains(500));
+        cache.put(1, std::string(10, 'c'));
+        CHECK(cache.size() == 1 && cache.weight() == 10);
+        for (int key = 0; key < 5; ++key) cache.put(key, std::string(100, 'a'));
+        CHECK(cache.weight() == 500);
+        cache.put(0, std::string(900, 'z'));   // a replacement that grows evicts others, not itself
+        CHECK(cache.get(0) == std::string(900, 'z') && cache.weight() <= 1000);
+        cache.erase(0);
+        CHECK(cache.weight() == cache.size() * 100);
+        cache.clear();
+        CHECK(cache.weight() == 0 && cache.size() == 0);
+    }
+
+    template<typename Eviction, typename Storage>
+    void budgets_combine() {
+        ThreadSafeCache<int, std::string, Eviction, Storage> unweighed(nullptr, {.shards = 2, .max_weight = 50});
+        for (int key = 0; key < 1000; ++key) unweighed.put(key, "x");
+        CHECK(unweighed.weight() == unweighed.size() && unweighed.size() <= 50);   // every entry weighs 1
+
+        ThreadSafeCache<int, std::string, Eviction, Storage> both(nullptr, {.shards = 1, .max_entries = 5, .max_weight = 10'000}, by_length);
+        for (int key = 0; key < 100; ++key) both.put(key, "x");
+        CHECK(both.size() == 5 && both.weight() == 5);
+    }
+
+    template<typename Eviction, typename Storage>
+    void weight_matches_contents_under_concurrency() {
+        ThreadSafeCache<int, std::string, Eviction, Storage> cache([](int key) { return std::string(static_cast<std::size_t>(key % 200), 'l'); },
+                                                                   {.shards = 4, .max_weight = 20'000}, by_length);
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < 4; ++t) {
+            threads.emplace_back([&, t] {
+                std::mt19937 rng{t};
+                for (int i = 0; i < 10'000; ++i) {
+                    const auto key = static_cast<int>(rng() % 2000);
+                    switch (rng() % 4) {
+                    case 0: cache.put(key, std::string(rng() % 300, 'p')); break;
+                    case 1: cache.erase(key); break;
+                    default: cache.get(key);
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        std::size_t total = 0;
+        for (int key = 0; key < 2000; ++key) cache.with(key, [&](const std::string& value) { total += value.size(); });
+        CHECK(total == cache.weight());
+        CHECK(cache.weight() <= 20'000 + 4 * 300);   // each shard may overshoot by one entry it keeps
+    }
+
+    template<typename Eviction, typename Storage>
+    void run() {
+        stays_within_budget<Eviction, Storage>();
+        budgets_combine<Eviction, Storage>();
+        weight_matches_contents_under_concurrency<Eviction, Storage>();
+    }
+
+    void expiry_gives_weight_back() {
+        ThreadSafeCache<int, SharedValue<std::string>, LruEviction, NodeStorage, TimerWheelExpiration> cache(
+            nullptr, {.shards = 1, .max_weight = 1000, .expiry = Expiry::after_write(5ms)}, by_length);
+        cache.put(1, std::string(300, 'a'));
+        CHECK(cache.weight() == 300);
+        std::this_thread::sleep_for(20ms);
+        cache.put(2, std::string(10, 'a'));
+        CHECK(cache.weight() == 10 && cache.size() == 1);
+    }
+}
+
+int main()
+{
+    run<LruEviction, NodeStorage>();
+    run<ClockEviction, FlatStorage>();
+    run<S3FifoEviction, ConcurrentStorage>();
+    run<TinyLfuAdmission<>, NodeStorage>();
+    expiry_gives_weight_back();
+    return 0;
+}
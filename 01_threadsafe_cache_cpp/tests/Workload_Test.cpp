@@ -0,0 +1,90 @@
+#include <cstdint>
+#include <random>
+#include <set>
+#include <vector>
+#include "../bench/Workload.h"
+#include "Check.h"
+
+// The benchmark key generators: every key in range, and each distribution with the shape its
+// name promises, so a benchmark result is about the cache and not about a skewed generator
+
+namespace {
+    constexpr int draws = 200'000;
+
+    // Draw counts of the keys in [0, n); keys outside it count as a failed check
+    template<typename Generator>
+    auto histogram(Generator generator, std::uint64_t n) -> std::vector<int> {
+        std::mt19937_64 rng{7};
+        std::vector<int> counts(n);
+        for (int i = 0; i < draws; ++i) {
+            const auto key = generator(rng);
+            CHECK(key < n);
+            if (key < n) ++counts[key];
+        }
+        return counts;
+    }
+
+    auto share(const std::vector<int>& counts, std::uint64_t begin, std::uint64_t end) -> double {
+        long sum = 0;
+        for (auto key = begin; key < end; ++key) sum += counts[key];
+        return static_cast<double>(sum) / draws;
+    }
+
+    void uniform_is_flat() {
+        const auto counts = histogram(UniformGenerator{100}, 100);
+        for (const auto count : counts) CHECK(count > draws / 100 * 8 / 10 && count < draws / 100 * 12 / 10);
+        CHECK(histogram(UniformGenerator{1}, 1)[0] == draws);
+    }
+
+    // Rank frequencies fall off as 1/rank^theta: rank 0 leads, and rank 0 over rank 9 is ~10^theta
+    void zipf_is_skewed() {
+        const auto counts = histogram(ZipfGenerator{1000, 0.99}, 1000);
+        CHECK(counts[0] > counts[1] && counts[1] > counts[2] && counts[2] > counts[10]);
+        const auto ratio = static_cast<double>(counts[0]) / counts[9];
+        CHECK(ratio > 7 && ratio < 13);
+        CHECK(share(counts, 0, 100) > 0.6 && share(counts, 900, 1000) < 0.03);
+
+        // theta near 0 is close to uniform
+        const auto flat = histogram(ZipfGenerator{100, 0.01}, 100);
+        CHECK(share(flat, 0, 50) > 0.45 && share(flat, 0, 50) < 0.6);
+    }
+
+    void hotspot_shares() {
+        const auto counts = histogram(HotspotGenerator{1000, 0.01, 0.9}, 1000);
+        CHECK(share(counts, 0, 10) > 0.88 && share(counts, 0, 10) < 0.92);
+        for (std::uint64_t key = 10; key < 1000; ++key) CHECK(counts[key] < counts[0]);
+
+        // A hot set of the whole key space, or a hot fraction too small for one key, still works
+        CHECK(share(histogram(HotspotGenerator{10, 1.0, 0.5}, 10), 0, 10) == 1.0);
+        CHECK(share(histogram(HotspotGenerator{1000, 0.0001, 0.5}, 1000), 0, 1) > 0.45);
+    }
+
+    // Scan keys sit above the zipf range, run in order and never repeat
+    void scans_never_repeat() {
+        constexpr std::uint64_t n = 1000;
+        ScanMixGenerator generator{n, 0.99, 50, 0.01};
+        std::mt19937_64 rng{3};
+        std::set<std::uint64_t> scanned;
+        std::uint64_t last = n - 1;
+        int zipf = 0;
+        for (int i = 0; i < draws; ++i) {
+            const auto key = generator(rng);
+            if (key < n) {
+                ++zipf;
+                continue;
+            }
+            CHECK(key == last + 1 && scanned.insert(key).second);
+            last = key;
+        }
+        CHECK(!scanned.empty() && zipf > draws / 2);
+    }
+}
+
+int main()
+{
+    uniform_is_flat();
+    zipf_is_skewed();
+    hotspot_shares();
+    scans_never_repeat();
+    return 0;
+}